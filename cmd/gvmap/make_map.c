@@ -17,6 +17,7 @@
 #include <cgraph/cgraph.h>
 #include "make_map.h"
 #include <sfdpgen/stress_model.h>
+#include <sfdpgen/sparse_solve.h>
 #include "country_graph_coloring.h"
 #include <sparse/colorutil.h>
 #include <neatogen/delaunay.h>
@@ -166,7 +167,7 @@ void improve_contiguity(int n, int dim, int *grouping, SparseMatrix poly_point_m
   }
 
   if (Verbose) fprintf(stderr,"ratio (edges among discontiguous regions vs total edges)=%f\n",((real) nbad)/ia[n]);
-  stress_model(dim, D, D, &x, FALSE, maxit, tol, &flag);
+  stress_model(dim, D, D, &x, FALSE, maxit, tol, SOLVE_METHOD_CG, &flag);
 
   assert(!flag);
 
@@ -106,7 +106,7 @@ userout (agerrlevel_t level, const char *fmt, va_list args)
     free(buf);
 }
 
-static int agerr_va(agerrlevel_t level, const char *fmt, va_list args)
+static int agerr_va_(agerrlevel_t level, const char *fmt, va_list args)
 {
     agerrlevel_t lvl;
 
@@ -147,6 +147,21 @@ static int agerr_va(agerrlevel_t level, const char *fmt, va_list args)
     return 0;
 }
 
+/* agerr_va:
+ * Layouts may report errors from several threads, so the error state
+ * and message file are only used by one at a time.
+ */
+static int agerr_va(agerrlevel_t level, const char *fmt, va_list args)
+{
+    int rv;
+
+#ifdef _OPENMP
+#pragma omp critical(agerr)
+#endif
+    rv = agerr_va_(level, fmt, args);
+    return rv;
+}
+
 int agerr(agerrlevel_t level, const char *fmt, ...)
 {
     va_list args;
@@ -450,6 +450,23 @@ char *agxget(void *obj, Agsym_t * sym)
     return rv;
 }
 
+/* agxgetdouble, agxgetlong:
+ * Typed forms of agxget. Attribute values are shared refstrs, and the
+ * number parsed from each when it is interned is kept with it, so
+ * lookups do not call strtod/strtol again; agxset installs a different refstr,
+ * which invalidates the cache for that object. Return FALSE, leaving
+ * *val alone, if the value does not begin with a number.
+ */
+int agxgetdouble(void *obj, Agsym_t * sym, double *val)
+{
+    return agstrtod(agxget(obj, sym), val);
+}
+
+int agxgetlong(void *obj, Agsym_t * sym, long *val)
+{
+    return agstrtol(agxget(obj, sym), val);
+}
+
 int agset(void *obj, char *name, char *value)
 {
     Agsym_t *sym;
@@ -192,10 +192,12 @@ struct Agdisc_s {		/* user's discipline */
 	/* default resource disciplines */
 
 CGRAPH_API Agmemdisc_t AgMemDisc;
+CGRAPH_API Agmemdisc_t AgArenaMemDisc;	/* bulk free on agclose */
 CGRAPH_API Agiddisc_t AgIdDisc;
 CGRAPH_API Agiodisc_t AgIoDisc;
 
 CGRAPH_API Agdisc_t AgDefaultDisc;
+CGRAPH_API Agdisc_t AgArenaDisc;
 
 struct Agdstate_s {
     void *mem;
@@ -231,6 +233,7 @@ struct Agclos_s {
     unsigned char callbacks_enabled;	/* issue user callbacks or hold them? */
     Dict_t *lookup_by_name[3];
     Dict_t *lookup_by_id[3];
+    uint64_t stamp;		/* bumped on every node or edge set change */
 };
 
 struct Agraph_s {
@@ -351,6 +354,8 @@ CGRAPH_API void agclean(Agraph_t * g, int kind, char *rec_name);
 
 CGRAPH_API char *agget(void *obj, char *name);
 CGRAPH_API char *agxget(void *obj, Agsym_t * sym);
+CGRAPH_API int agxgetdouble(void *obj, Agsym_t * sym, double *val);
+CGRAPH_API int agxgetlong(void *obj, Agsym_t * sym, long *val);
 CGRAPH_API int agset(void *obj, char *name, char *value);
 CGRAPH_API int agxset(void *obj, Agsym_t * sym, char *value);
 CGRAPH_API int agsafeset(void* obj, char* name, char* value, char* def);
@@ -375,6 +380,30 @@ CGRAPH_API void *agrealloc(Agraph_t * g, void *ptr, size_t oldsize,
 		       size_t size);
 CGRAPH_API void agfree(Agraph_t * g, void *ptr);
 
+/* compressed sparse row snapshot of a graph, for read-only traversal.
+ * Node i is nodes[i]; its out-edges are out_edge[out_start[i]] through
+ * out_edge[out_start[i+1]-1], with heads at out_node[] in the same
+ * positions, and likewise for in-edges.  The snapshot is owned by the
+ * graph and is rebuilt by agcsr once any node or edge is inserted or
+ * deleted under the same root. */
+typedef struct Agcsr_s Agcsr_t;
+struct Agcsr_s {
+    Agrec_t h;			/* installed in list of graph recs */
+    uint64_t stamp;		/* root's stamp when taken */
+    int nnodes;
+    int nedges;
+    Agnode_t **nodes;		/* in agfstnode/agnxtnode order */
+    int *out_start, *in_start;	/* nnodes+1 offsets each */
+    int *out_node, *in_node;	/* index of the other endpoint */
+    Agedge_t **out_edge, **in_edge;
+    int *seqmap;		/* AGSEQ(n) -> index, or -1 */
+    uint64_t maxseq;
+};
+
+CGRAPH_API Agcsr_t *agcsr(Agraph_t * g);
+CGRAPH_API void agcsrfree(Agraph_t * g);
+CGRAPH_API int agcsrindex(Agcsr_t * csr, Agnode_t * n);
+
 /* an engineering compromise is a joy forever */
 CGRAPH_API void aginternalmapclearlocalnames(Agraph_t * g);
 
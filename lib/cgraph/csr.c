@@ -0,0 +1,146 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+#include <cgraph/cghdr.h>
+#include <stddef.h>
+
+/*
+ * compressed sparse row snapshots of a graph's adjacency
+ *
+ * A snapshot is a single record attached to the graph. Node and edge
+ * arrays are carved out of the same block, so dropping the record
+ * frees everything. The snapshot remembers the root's mutation stamp
+ * when it was built; any later node or edge set change in the root
+ * or any subgraph makes agcsr rebuild it.
+ */
+
+static char CsrRecName[] = "_AG_csr";
+
+#define ALIGNUP(x,a)	(((x) + (a) - 1) / (a) * (a))
+
+static Agcsr_t *csrbuild(Agraph_t * g)
+{
+    Agcsr_t *csr;
+    Agnode_t *n;
+    Agedge_t *e;
+    int nnodes, nedges, i, ko, ki;
+    uint64_t maxseq;
+    size_t sz, off_nodes, off_oute, off_ine, off_start, off_adj, off_seq;
+    char *base;
+
+    /* pass 1: sizes */
+    nnodes = nedges = 0;
+    maxseq = 0;
+    for (n = agfstnode(g); n; n = agnxtnode(g, n)) {
+	nnodes++;
+	if (AGSEQ(n) > maxseq)
+	    maxseq = AGSEQ(n);
+	for (e = agfstout(g, n); e; e = agnxtout(g, e))
+	    nedges++;
+    }
+
+    /* layout of the block: header, pointer arrays, then int arrays */
+    off_nodes = ALIGNUP(sizeof(Agcsr_t), sizeof(void *));
+    off_oute = off_nodes + nnodes * sizeof(Agnode_t *);
+    off_ine = off_oute + nedges * sizeof(Agedge_t *);
+    off_start = off_ine + nedges * sizeof(Agedge_t *);
+    off_adj = off_start + 2 * (nnodes + 1) * sizeof(int);
+    off_seq = off_adj + 2 * nedges * sizeof(int);
+    sz = off_seq + (maxseq + 1) * sizeof(int);
+
+    csr = agbindrec(g, CsrRecName, (unsigned int) sz, FALSE);
+    base = (char *) csr;
+    csr->stamp = g->clos->stamp;
+    csr->nnodes = nnodes;
+    csr->nedges = nedges;
+    csr->maxseq = maxseq;
+    csr->nodes = (Agnode_t **) (base + off_nodes);
+    csr->out_edge = (Agedge_t **) (base + off_oute);
+    csr->in_edge = (Agedge_t **) (base + off_ine);
+    csr->out_start = (int *) (base + off_start);
+    csr->in_start = csr->out_start + nnodes + 1;
+    csr->out_node = (int *) (base + off_adj);
+    csr->in_node = csr->out_node + nedges;
+    csr->seqmap = (int *) (base + off_seq);
+
+    /* pass 2: node index */
+    for (i = 0; i <= (int) maxseq; i++)
+	csr->seqmap[i] = -1;
+    i = 0;
+    for (n = agfstnode(g); n; n = agnxtnode(g, n)) {
+	csr->nodes[i] = n;
+	csr->seqmap[AGSEQ(n)] = i;
+	i++;
+    }
+    /* pass 3: edge lists, in agfstout/agfstin order */
+    ko = ki = 0;
+    for (i = 0; i < nnodes; i++) {
+	n = csr->nodes[i];
+	csr->out_start[i] = ko;
+	for (e = agfstout(g, n); e; e = agnxtout(g, e)) {
+	    csr->out_edge[ko] = e;
+	    csr->out_node[ko] = csr->seqmap[AGSEQ(aghead(e))];
+	    ko++;
+	}
+	csr->in_start[i] = ki;
+	for (e = agfstin(g, n); e; e = agnxtin(g, e)) {
+	    csr->in_edge[ki] = e;
+	    csr->in_node[ki] = csr->seqmap[AGSEQ(agtail(e))];
+	    ki++;
+	}
+    }
+    csr->out_start[nnodes] = ko;
+    csr->in_start[nnodes] = ki;
+    assert(ko == nedges && ki == nedges);
+    return csr;
+}
+
+/* agcsr:
+ * Return an up-to-date snapshot of g, building it if there is none
+ * or if the root graph has been modified since it was taken.
+ * The snapshot belongs to g and stays valid until the next node or
+ * edge insertion or deletion anywhere under agroot(g).
+ */
+Agcsr_t *agcsr(Agraph_t * g)
+{
+    Agcsr_t *csr;
+
+    csr = (Agcsr_t *) aggetrec(g, CsrRecName, FALSE);
+    if (csr) {
+	if (csr->stamp == g->clos->stamp)
+	    return csr;
+	agdelrec(g, CsrRecName);
+    }
+    return csrbuild(g);
+}
+
+/* agcsrfree:
+ * Release the snapshot of g, if any.
+ */
+void agcsrfree(Agraph_t * g)
+{
+    if (aggetrec(g, CsrRecName, FALSE))
+	agdelrec(g, CsrRecName);
+}
+
+/* agcsrindex:
+ * Index of n in the snapshot, or -1 if n is not in the snapshot's graph.
+ */
+int agcsrindex(Agcsr_t * csr, Agnode_t * n)
+{
+    int i;
+
+    if (AGSEQ(n) > csr->maxseq)
+	return -1;
+    i = csr->seqmap[AGSEQ(n)];
+    if (i < 0 || csr->nodes[i] != n)
+	return -1;
+    return i;
+}
@@ -164,19 +164,19 @@ Agsubnode_t *agsubrep(Agraph_t * g, Agnode_t * n)
     return sn;
 }
 
-static void ins(Dict_t * d, Dtlink_t ** set, Agedge_t * e)
+static void ins(Agraph_t * g, Dict_t * d, Dtlink_t ** set, Agedge_t * e)
 {
     dtrestore(d, *set);
-    dtinsert(d, e);
+    agdtinsert(g, d, e);
     *set = dtextract(d);
 }
 
-static void del(Dict_t * d, Dtlink_t ** set, Agedge_t * e)
+static void del(Agraph_t * g, Dict_t * d, Dtlink_t ** set, Agedge_t * e)
 {
-    void *x;
+    int x;
     NOTUSED(x);
     dtrestore(d, *set);
-    x = dtdelete(d, e);
+    x = agdtdelete(g, d, e);
     assert(x);
     *set = dtextract(d);
 }
@@ -191,14 +191,15 @@ static void installedge(Agraph_t * g, Agedge_t * e)
     in = AGMKIN(e);
     t = agtail(e);
     h = aghead(e);
+    g->clos->stamp++;
     while (g) {
 	if (agfindedge_by_key(g, t, h, AGTAG(e))) break;
 	sn = agsubrep(g, t);
-	ins(g->e_seq, &sn->out_seq, out);
-	ins(g->e_id, &sn->out_id, out);
+	ins(g, g->e_seq, &sn->out_seq, out);
+	ins(g, g->e_id, &sn->out_id, out);
 	sn = agsubrep(g, h);
-	ins(g->e_seq, &sn->in_seq, in);
-	ins(g->e_id, &sn->in_id, in);
+	ins(g, g->e_seq, &sn->in_seq, in);
+	ins(g, g->e_id, &sn->in_id, in);
 	g = agparent(g);
     }
 }
@@ -339,12 +340,13 @@ void agdeledgeimage(Agraph_t * g, Agedge_t * e, void *ignored)
     }
     t = in->node;
     h = out->node;
+    g->clos->stamp++;
     sn = agsubrep(g, t);
-    del(g->e_seq, &sn->out_seq, out);
-    del(g->e_id, &sn->out_id, out);
+    del(g, g->e_seq, &sn->out_seq, out);
+    del(g, g->e_id, &sn->out_id, out);
     sn = agsubrep(g, h);
-    del(g->e_seq, &sn->in_seq, in);
-    del(g->e_id, &sn->in_id, in);
+    del(g, g->e_seq, &sn->in_seq, in);
+    del(g, g->e_id, &sn->in_id, in);
 #ifdef DEBUG
     for (e = agfstin(g,h); e; e = agnxtin(g,e))
 	assert(e != in);
@@ -197,13 +197,13 @@ void aginternalmapclearlocalnames(Agraph_t * g)
     }
 }
 
-static void closeit(Dict_t ** d)
+static void closeit(Agraph_t * g, Dict_t ** d)
 {
     int i;
 
     for (i = 0; i < 3; i++) {
 	if (d[i]) {
-	    dtclose(d[i]);
+	    agdtclose(g, d[i]);
 	    d[i] = NULL;
 	}
     }
@@ -212,6 +212,6 @@ static void closeit(Dict_t ** d)
 void aginternalmapclose(Agraph_t * g)
 {
     Ag_G_global = g;
-    closeit(g->clos->lookup_by_name);
-    closeit(g->clos->lookup_by_id);
+    closeit(g, g->clos->lookup_by_name);
+    closeit(g, g->clos->lookup_by_id);
 }
@@ -58,6 +58,138 @@ static void memclose(void *heap)
 Agmemdisc_t AgMemDisc =
     { memopen, memalloc, memresize, memfree, memclose };
 
+/* Arena discipline.
+ * Objects are carved in sequence from large zeroed slabs, so a node and
+ * the edges created right after it tend to share cache lines.  Freeing
+ * an individual object is a no-op; all slabs are returned together when
+ * the root graph is closed, and because the discipline has a close
+ * function agclose skips the per-object teardown entirely.  This suits
+ * graphs that are read, laid out and discarded, not long-lived graphs
+ * with heavy insert/delete churn.
+ */
+typedef union {
+    long double ld;
+    double d;
+    void *p;
+    uint64_t u;
+} arena_align_t;
+
+#define ARENA_ALIGN	sizeof(arena_align_t)
+#define ARENA_ROUND(n)	(((n) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+#define ARENA_MINSLAB	((size_t)16 * 1024)
+#define ARENA_MAXSLAB	((size_t)1024 * 1024)
+
+typedef struct arena_slab_s arena_slab_t;
+struct arena_slab_s {
+    arena_slab_t *next;
+    char *cur, *end;		/* unused part of the slab */
+};
+
+typedef struct {
+    arena_slab_t *slabs;	/* the first slab is the one being carved */
+    size_t slabsize;		/* size of the next ordinary slab */
+} arena_t;
+
+static arena_slab_t *arenaslab(size_t size)
+{
+    arena_slab_t *s;
+    size_t hdr = ARENA_ROUND(sizeof(arena_slab_t));
+
+    s = calloc(1, hdr + size);
+    if (s) {
+	s->cur = (char *) s + hdr;
+	s->end = s->cur + size;
+    }
+    return s;
+}
+
+static void *arenaopen(Agdisc_t* disc)
+{
+    arena_t *a;
+
+    (void)disc; /* unused */
+    a = calloc(1, sizeof(arena_t));
+    if (a)
+	a->slabsize = ARENA_MINSLAB;
+    return a;
+}
+
+static void *arenaalloc(void *heap, size_t request)
+{
+    arena_t *a = heap;
+    arena_slab_t *s;
+    void *rv;
+
+    request = ARENA_ROUND(request ? request : 1);
+    s = a->slabs;
+    if (s == NULL || (size_t) (s->end - s->cur) < request) {
+	if (request > a->slabsize / 4) {
+	    /* large block: give it a slab of its own, behind the current one */
+	    if (!(s = arenaslab(request)))
+		return NULL;
+	    if (a->slabs) {
+		s->next = a->slabs->next;
+		a->slabs->next = s;
+	    } else
+		a->slabs = s;
+	} else {
+	    if (!(s = arenaslab(a->slabsize)))
+		return NULL;
+	    s->next = a->slabs;
+	    a->slabs = s;
+	    if (a->slabsize < ARENA_MAXSLAB)
+		a->slabsize *= 2;
+	}
+    }
+    rv = s->cur;
+    s->cur += request;
+    return rv;
+}
+
+static void *arenaresize(void *heap, void *ptr, size_t oldsize,
+			 size_t request)
+{
+    arena_t *a = heap;
+    arena_slab_t *s = a->slabs;
+    char *p = ptr;
+    void *rv;
+
+    if (request <= oldsize)
+	return ptr;
+    /* the most recent object can grow in place */
+    if (s && p + ARENA_ROUND(oldsize) == s->cur
+	&& (size_t) (s->end - p) >= ARENA_ROUND(request)) {
+	s->cur = p + ARENA_ROUND(request);
+	memset(p + oldsize, 0, request - oldsize);
+	return ptr;
+    }
+    rv = arenaalloc(heap, request);
+    if (rv)
+	memcpy(rv, ptr, oldsize);
+    return rv;
+}
+
+static void arenafree(void *heap, void *ptr)
+{
+    NOTUSED(heap);
+    NOTUSED(ptr);
+}
+
+static void arenaclose(void *heap)
+{
+    arena_t *a = heap;
+    arena_slab_t *s, *next;
+
+    for (s = a->slabs; s; s = next) {
+	next = s->next;
+	free(s);
+    }
+    free(a);
+}
+
+Agmemdisc_t AgArenaMemDisc =
+    { arenaopen, arenaalloc, arenaresize, arenafree, arenaclose };
+
 void *agalloc(Agraph_t * g, size_t size)
 {
     void *mem;
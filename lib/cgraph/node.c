@@ -93,6 +93,7 @@ static void installnode(Agraph_t * g, Agnode_t * n)
     if (g == agroot(g)) sn = &(n->mainsub);
     else sn = agalloc(g, sizeof(Agsubnode_t));
     sn->node = n;
+    g->clos->stamp++;
     dtinsert(g->n_id, sn);
     dtinsert(g->n_seq, sn);
     assert(dtsize(g->n_id) == dtsize(g->n_seq));
@@ -177,6 +178,7 @@ void agdelnodeimage(Agraph_t * g, Agnode_t * n, void *ignored)
     template.node = n;
 
     NOTUSED(ignored);
+    g->clos->stamp++;
     for (e = agfstedge(g, n); e; e = f) {
 	f = agnxtedge(g, e, n);
 	agdeledgeimage(g, e, 0);
@@ -362,6 +364,7 @@ int agnodebefore(Agnode_t *fst, Agnode_t *snd)
 
 	g = agroot(fst);
 	if (AGSEQ(fst) > AGSEQ(snd)) return SUCCESS;
+	g->clos->stamp++;
 
 	/* move snd out of the way somewhere */
 	n = snd;
@@ -22,6 +22,9 @@ typedef struct refstr_t {
     Dtlink_t link;
     uint64_t refcnt;
     char *s;
+    unsigned char ok_d, ok_l;	/* s begins with a number */
+    double dval;		/* strtod(s) */
+    long lval;			/* strtol(s, 10) */
     char store[1];		/* this is actually a dynamic array */
 } refstr_t;
 
@@ -88,6 +91,21 @@ char *agstrbind(Agraph_t * g, char *s)
     return refstrbind(refdict(g), s);
 }
 
+/* refstrparse:
+ * Parse the new refstr r as a double and as a long. This is done before r
+ * is published, so the values never change while others may be reading
+ * them, possibly from several threads.
+ */
+static void refstrparse(refstr_t * r)
+{
+    char *endp;
+
+    r->dval = strtod(r->s, &endp);
+    r->ok_d = endp != r->s;
+    r->lval = strtol(r->s, &endp, 10);
+    r->ok_l = endp != r->s;
+}
+
 char *agstrdup(Agraph_t * g, char *s)
 {
     refstr_t *r;
@@ -109,6 +127,7 @@ char *agstrdup(Agraph_t * g, char *s)
 	r->refcnt = 1;
 	strcpy(r->store, s);
 	r->s = r->store;
+	refstrparse(r);
 	dtinsert(strdict, r);
     }
     return r->s;
@@ -135,6 +154,7 @@ char *agstrdup_html(Agraph_t * g, char *s)
 	r->refcnt = 1 | HTML_BIT;
 	strcpy(r->store, s);
 	r->s = r->store;
+	refstrparse(r);
 	dtinsert(strdict, r);
     }
     return r->s;
@@ -189,6 +209,35 @@ void agmarkhtmlstr(char *s)
     key->refcnt |= HTML_BIT;
 }
 
+/* agstrtod, agstrtol:
+ * Numeric value of a refstr, as given by strtod or strtol. The result
+ * is computed when the string is interned and kept with it, so every
+ * object sharing the value shares the parse, and lookups only read.
+ * Return FALSE if s does not begin with a number. Like aghtmlstr, this
+ * assumes s is the store of a refstr.
+ */
+int agstrtod(char *s, double *val)
+{
+    refstr_t *key;
+
+    key = (refstr_t *) (s - offsetof(refstr_t, store[0]));
+    if (!key->ok_d)
+	return FALSE;
+    *val = key->dval;
+    return TRUE;
+}
+
+int agstrtol(char *s, long *val)
+{
+    refstr_t *key;
+
+    key = (refstr_t *) (s - offsetof(refstr_t, store[0]));
+    if (!key->ok_l)
+	return FALSE;
+    *val = key->lval;
+    return TRUE;
+}
+
 #ifdef DEBUG
 static int refstrprint(Dict_t * dict, void *ptr, void *user)
 {
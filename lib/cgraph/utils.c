@@ -48,24 +48,58 @@ void agdictobjfree(Dict_t * dict, void * p, Dtdisc_t * disc)
 	free(p);
 }
 
+/* asking for DT_MEMORYF on open makes cdt take the dictionary handle
+ * from agdictobjmem too, so nothing of a graph lives outside its heap
+ */
+static int agdictopenevent(Dict_t * dict, int type, void *data,
+			   Dtdisc_t * disc)
+{
+    NOTUSED(dict);
+    NOTUSED(data);
+    NOTUSED(disc);
+    return type == DT_OPEN;
+}
+
 Dict_t *agdtopen(Agraph_t * g, Dtdisc_t * disc, Dtmethod_t * method)
 {
     Dtmemory_f memf;
+    Dtevent_f eventf;
     Dict_t *d;
 
     memf = disc->memoryf;
+    eventf = disc->eventf;
     disc->memoryf = agdictobjmem;
+    disc->eventf = eventf ? eventf : agdictopenevent;
     Ag_dictop_G = g;
     d = dtopen(disc, method);
     disc->memoryf = memf;
+    disc->eventf = eventf;
     Ag_dictop_G = NULL;
     return d;
 }
 
+/* agdtinsert, agdtdelete:
+ * Holder objects of dictionaries with external links come from g's
+ * heap, so they must be allocated and freed with g current.
+ */
+void *agdtinsert(Agraph_t * g, Dict_t * dict, void *obj)
+{
+    void *rv;
+
+    Ag_dictop_G = g;
+    rv = dtinsert(dict, obj);
+    Ag_dictop_G = NULL;
+    return rv;
+}
+
 int agdtdelete(Agraph_t * g, Dict_t * dict, void *obj)
 {
+    void *rv;
+
     Ag_dictop_G = g;
-    return dtdelete(dict, obj) != NULL;
+    rv = dtdelete(dict, obj);
+    Ag_dictop_G = NULL;
+    return rv != NULL;
 }
 
 int agdtclose(Agraph_t * g, Dict_t * dict)
@@ -192,6 +192,27 @@ static void arrow_match_name(char *name, int *flag)
     }
 }
 
+/* The arrowhead and arrowtail attributes of ArrowGraph, set by
+ * arrow_flags_attrs for a caller about to run arrow_flags on the edges of
+ * that graph in several threads. Every search of the attribute dictionary
+ * reorganizes it, so the threads must not look the attributes up.
+ */
+static Agraph_t *ArrowGraph;
+static Agsym_t *ArrowHead, *ArrowTail;
+
+/* arrow_flags_attrs:
+ * Look up the arrowhead and arrowtail attributes of root graph g once
+ * for arrow_flags. A NULL g forgets them again.
+ */
+void arrow_flags_attrs(Agraph_t * g)
+{
+    ArrowGraph = g;
+    if (g) {
+	ArrowHead = agfindedgeattr(g, "arrowhead");
+	ArrowTail = agfindedgeattr(g, "arrowtail");
+    }
+}
+
 void arrow_flags(Agedge_t * e, int *sflag, int *eflag)
 {
     char *attr;
@@ -213,13 +234,15 @@ void arrow_flags(Agedge_t * e, int *sflag, int *eflag)
 	 * which edge attributes appear and are thus parsed into a dictionary mean
 	 * E_arrowhead->id potentially points at a stale attribute value entry
 	 */
-	Agsym_t *arrowhead = agfindedgeattr(agraphof(e), "arrowhead");
+	Agsym_t *arrowhead = agraphof(e) == ArrowGraph ? ArrowHead
+	    : agfindedgeattr(agraphof(e), "arrowhead");
 	if (arrowhead != NULL && ((attr = agxget(e, arrowhead)))[0])
 		arrow_match_name(attr, eflag);
     }
     if (*sflag == ARR_TYPE_NORM) {
 	/* similar to above, we cannot use E_arrowtail here */
-	Agsym_t *arrowtail = agfindedgeattr(agraphof(e), "arrowtail");
+	Agsym_t *arrowtail = agraphof(e) == ArrowGraph ? ArrowTail
+	    : agfindedgeattr(agraphof(e), "arrowtail");
 	if (arrowtail != NULL && ((attr = agxget(e, arrowtail)))[0])
 		arrow_match_name(attr, sflag);
     }
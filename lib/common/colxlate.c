@@ -129,6 +129,21 @@ static int colorcmpf(const void *p0, const void *p1)
     return strcasecmp(((const hsvrgbacolor_t *) p0)->name, ((const hsvrgbacolor_t *) p1)->name);
 }
 
+/* Small direct-mapped cache of recent color name lookups, indexed by
+ * a hash of the canonical name. Graphs typically use a handful of
+ * colors over and over, so this saves most of the bsearch calls.
+ */
+#define COLORCACHESIZE 64
+
+static unsigned int colorhash(const char *s)
+{
+    unsigned int h = 0;
+
+    while (*s)
+	h = h * 31 + (unsigned char) *s++;
+    return h & (COLORCACHESIZE - 1);
+}
+
 char *canontoken(char *str)
 {
     static unsigned char *canon;
@@ -240,7 +255,9 @@ static char* resolveColor (char* str)
 
 int colorxlate(char *str, gvcolor_t * color, color_type_t target_type)
 {
-    static hsvrgbacolor_t *last;
+    static hsvrgbacolor_t *cache[COLORCACHESIZE];
+    hsvrgbacolor_t *last;
+    unsigned int h;
     static unsigned char *canon;
     static size_t allocated;
     unsigned char *p, *q;
@@ -384,6 +401,8 @@ int colorxlate(char *str, gvcolor_t * color, color_type_t target_type)
     fake.name = resolveColor(str);
     if (!fake.name)
 	return COLOR_MALLOC_FAIL;
+    h = colorhash(fake.name);
+    last = cache[h];
     if ((last == NULL)
 	|| (last->name[0] != fake.name[0])
 	|| (strcmp(last->name, fake.name))) {
@@ -392,6 +411,8 @@ int colorxlate(char *str, gvcolor_t * color, color_type_t target_type)
 				      sizeof(color_lib) /
 				      sizeof(hsvrgbacolor_t), sizeof(fake),
 				      colorcmpf);
+	if (last)
+	    cache[h] = last;
     }
     if (last != NULL) {
 	switch (target_type) {
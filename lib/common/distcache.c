@@ -0,0 +1,293 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+/* Cache of data a layout derives from the structure of a graph alone,
+ * such as the all-pairs distance matrix of neato, so that laying out
+ * the same graph again, with other node sizes, pins or attributes,
+ * can skip computing it.
+ *
+ * Entries are found by a key, a byte string built by the layout from
+ * everything the data depends on, and a kind, naming the layout step.
+ * Keys are compared in full, never only by their hash.
+ *
+ * The cache is enabled by the root graph attribute distcache. If it is
+ * true, entries are kept in the GVC_t of the graph until gvFreeContext,
+ * up to DISTCACHE_MAXSIZE bytes of data, dropping the least recently used.
+ * Any other value, apart from false, names a directory in which entries
+ * are also written, to the file <hash>.<kind>, where hash is the 64 bit
+ * FNV-1a hash of the key in hex, so that later processes can use them.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <common/render.h>
+
+struct distcache_s {
+    struct distcache_s *next;
+    char *kind;
+    unsigned long long hash;
+    void *key;
+    size_t keylen;
+    void *data;
+    size_t size;
+};
+
+#define DISTCACHE_MAGIC "gvdcache1\n"
+
+/* bound on the data kept in memory, so that long-lived contexts laying
+ * out many graphs do not keep every matrix */
+#define DISTCACHE_MAXSIZE ((size_t) 256 << 20)
+
+static unsigned long long
+keyhash(const char *kind, const void *key, size_t keylen)
+{
+    unsigned long long h = 14695981039346656037ULL;
+    const unsigned char *p;
+    size_t i;
+
+    for (p = (const unsigned char *) kind; *p; p++) {
+	h ^= *p;
+	h *= 1099511628211ULL;
+    }
+    for (p = key, i = 0; i < keylen; i++) {
+	h ^= p[i];
+	h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/* cachedir:
+ * Return NULL if g does not use the cache, "" if it is kept in memory
+ * only, and the directory of the cache files otherwise.
+ */
+static char *cachedir(graph_t * g)
+{
+    char *s = agget(agroot(g), "distcache");
+
+    if (!s || !*s || !mapBool(s, TRUE))
+	return NULL;
+    if (mapbool(s))
+	return "";
+    return s;
+}
+
+static char *cachefile(char *dir, const char *kind, unsigned long long h)
+{
+    size_t len = strlen(dir) + strlen(kind) + 32;
+    char *path = N_GNEW(len, char);
+
+    snprintf(path, len, "%s%s%016llx.%s", dir, DIRSEP, h, kind);
+    return path;
+}
+
+/* readfile:
+ * Return the data stored for kind and key in the cache file, or NULL
+ * if it is missing, unreadable or for another key.
+ */
+static void *readfile(char *dir, const char *kind, unsigned long long h,
+		      const void *key, size_t keylen, size_t * size)
+{
+    char *path = cachefile(dir, kind, h);
+    FILE *fp = fopen(path, "rb");
+    char magic[sizeof(DISTCACHE_MAGIC) - 1];
+    size_t len[2];
+    void *fkey = NULL;
+    void *data = NULL;
+
+    free(path);
+    if (!fp)
+	return NULL;
+    if (fread(magic, sizeof(magic), 1, fp) == 1
+	&& !memcmp(magic, DISTCACHE_MAGIC, sizeof(magic))
+	&& fread(len, sizeof(len), 1, fp) == 1 && len[0] == keylen) {
+	fkey = N_GNEW(keylen + 1, char);
+	data = N_GNEW(len[1] + 1, char);
+	if (fread(fkey, 1, keylen, fp) != keylen
+	    || memcmp(fkey, key, keylen)
+	    || fread(data, 1, len[1], fp) != len[1]) {
+	    free(data);
+	    data = NULL;
+	} else
+	    *size = len[1];
+    }
+    free(fkey);
+    fclose(fp);
+    return data;
+}
+
+static void writefile(char *dir, const char *kind, unsigned long long h,
+		      const void *key, size_t keylen, const void *data,
+		      size_t size)
+{
+    char *path = cachefile(dir, kind, h);
+    FILE *fp = fopen(path, "wb");
+    size_t len[2];
+
+    if (!fp) {
+	agerr(AGWARN, "cannot write distance cache file %s\n", path);
+	free(path);
+	return;
+    }
+    len[0] = keylen;
+    len[1] = size;
+    if (fwrite(DISTCACHE_MAGIC, sizeof(DISTCACHE_MAGIC) - 1, 1, fp) != 1
+	|| fwrite(len, sizeof(len), 1, fp) != 1
+	|| fwrite(key, 1, keylen, fp) != keylen
+	|| fwrite(data, 1, size, fp) != size) {
+	agerr(AGWARN, "cannot write distance cache file %s\n", path);
+    }
+    fclose(fp);
+    free(path);
+}
+
+static void freeentry(struct distcache_s *e)
+{
+    free(e->kind);
+    free(e->key);
+    free(e->data);
+    free(e);
+}
+
+/* findentry:
+ * Return the entry for kind and key, moved to the front of the list of
+ * gvc, which is kept with the most recently used entries first.
+ */
+static struct distcache_s *findentry(GVC_t * gvc, const char *kind,
+				     unsigned long long h,
+				     const void *key, size_t keylen)
+{
+    struct distcache_s *e, **ep;
+
+    for (ep = &gvc->distcache; (e = *ep); ep = &e->next) {
+	if (e->hash == h && e->keylen == keylen && !strcmp(e->kind, kind)
+	    && !memcmp(e->key, key, keylen)) {
+	    *ep = e->next;
+	    e->next = gvc->distcache;
+	    gvc->distcache = e;
+	    return e;
+	}
+    }
+    return NULL;
+}
+
+static void addentry(GVC_t * gvc, const char *kind, unsigned long long h,
+		     const void *key, size_t keylen, const void *data,
+		     size_t size)
+{
+    struct distcache_s *e, **ep;
+    size_t total;
+
+    if (size > DISTCACHE_MAXSIZE)
+	return;
+    e = NEW(struct distcache_s);
+    e->kind = strdup(kind);
+    e->hash = h;
+    e->key = N_GNEW(keylen + 1, char);
+    memcpy(e->key, key, keylen);
+    e->keylen = keylen;
+    e->data = N_GNEW(size + 1, char);
+    memcpy(e->data, data, size);
+    e->size = size;
+    e->next = gvc->distcache;
+    gvc->distcache = e;
+
+    /* drop the least recently used entries beyond the bound */
+    total = 0;
+    for (ep = &gvc->distcache; (e = *ep); ep = &e->next) {
+	total += e->size;
+	if (total > DISTCACHE_MAXSIZE)
+	    break;
+    }
+    while ((e = *ep)) {
+	*ep = e->next;
+	freeentry(e);
+    }
+}
+
+/* distcache_enabled:
+ * Return true if g uses the cache, so that callers need not build keys
+ * otherwise.
+ */
+boolean distcache_enabled(graph_t * g)
+{
+    return cachedir(g) != NULL;
+}
+
+/* distcache_get:
+ * Return a copy, to be freed by the caller, of the data cached for kind
+ * and key in the cache of g, setting *size to its length in bytes.
+ * Return NULL if g does not use the cache or there is no such entry.
+ */
+void *distcache_get(graph_t * g, const char *kind, const void *key,
+		    size_t keylen, size_t * size)
+{
+    char *dir = cachedir(g);
+    GVC_t *gvc = GD_gvc(agroot(g));
+    unsigned long long h;
+    struct distcache_s *e;
+    void *data;
+
+    if (!dir)
+	return NULL;
+    h = keyhash(kind, key, keylen);
+    if (gvc && (e = findentry(gvc, kind, h, key, keylen))) {
+	data = N_GNEW(e->size + 1, char);
+	memcpy(data, e->data, e->size);
+	*size = e->size;
+	if (Verbose)
+	    fprintf(stderr, "distcache: using %s data %016llx\n", kind, h);
+	return data;
+    }
+    if (*dir && (data = readfile(dir, kind, h, key, keylen, size))) {
+	if (gvc)
+	    addentry(gvc, kind, h, key, keylen, data, *size);
+	if (Verbose)
+	    fprintf(stderr, "distcache: read %s data %016llx\n", kind, h);
+	return data;
+    }
+    return NULL;
+}
+
+/* distcache_put:
+ * Store size bytes of data for kind and key in the cache of g,
+ * if g uses the cache.
+ */
+void distcache_put(graph_t * g, const char *kind, const void *key,
+		   size_t keylen, const void *data, size_t size)
+{
+    char *dir = cachedir(g);
+    GVC_t *gvc = GD_gvc(agroot(g));
+    unsigned long long h;
+
+    if (!dir)
+	return;
+    h = keyhash(kind, key, keylen);
+    if (gvc && !findentry(gvc, kind, h, key, keylen))
+	addentry(gvc, kind, h, key, keylen, data, size);
+    if (*dir)
+	writefile(dir, kind, h, key, keylen, data, size);
+}
+
+/* distcache_close:
+ * Release the entries kept in gvc.
+ */
+void distcache_close(GVC_t * gvc)
+{
+    struct distcache_s *e, *next;
+
+    for (e = gvc->distcache; e; e = next) {
+	next = e->next;
+	freeentry(e);
+    }
+    gvc->distcache = NULL;
+}
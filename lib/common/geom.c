@@ -207,6 +207,9 @@ static pointf rotatepf(pointf p, int cwrot)
 {
     static double sina, cosa;
     static int last_cwrot;
+#ifdef _OPENMP
+#pragma omp threadprivate(sina, cosa, last_cwrot)
+#endif
     pointf P;
 
     /* cosa is initially wrong for a cwrot of 0
@@ -27,16 +27,24 @@ static void check_cycles(graph_t * g);
 #define SEQ(a,b,c)		((a) <= (b) && (b) <= (c))
 #define TREE_EDGE(e)	(ED_tree_index(e) >= 0)
 
-static graph_t *G;
-static int N_nodes, N_edges;
-static int Minrank, Maxrank;
-static int S_i;			/* search index for enter_edge */
-static int Search_size;
 #define SEARCHSIZE 30
-static nlist_t Tree_node;
-static elist Tree_edge;
 
-static int add_tree_edge(edge_t * e)
+/* all state of a network simplex solve, so that solves of different graphs
+ * can run concurrently */
+struct ns_solver_s {
+    graph_t *g;
+    int n_nodes, n_edges;
+    int minrank, maxrank;
+    int s_i;			/* search index for leave_edge */
+    int search_size;
+    nlist_t tree_node;
+    elist tree_edge;
+    int warm;			/* start from the previous ranks and tree */
+    edge_t *enter;		/* search state of enter_edge */
+    int low, lim, slack;
+};
+
+static int add_tree_edge(ns_solver_t * ns, edge_t * e)
 {
     node_t *n;
     //fprintf(stderr,"add tree edge %p %s ", (void*)e, agnameof(agtail(e))) ; fprintf(stderr,"%s\n", agnameof(aghead(e))) ;
@@ -44,12 +52,12 @@ static int add_tree_edge(edge_t * e)
 	agerr(AGERR, "add_tree_edge: missing tree edge\n");
 	return -1;
     }
-    ED_tree_index(e) = Tree_edge.size;
-    Tree_edge.list[Tree_edge.size++] = e;
+    ED_tree_index(e) = ns->tree_edge.size;
+    ns->tree_edge.list[ns->tree_edge.size++] = e;
     if (!ND_mark(agtail(e)))
-	Tree_node.list[Tree_node.size++] = agtail(e);
+	ns->tree_node.list[ns->tree_node.size++] = agtail(e);
     if (!ND_mark(aghead(e)))
-	Tree_node.list[Tree_node.size++] = aghead(e);
+	ns->tree_node.list[ns->tree_node.size++] = aghead(e);
     n = agtail(e);
     ND_mark(n) = TRUE;
     ND_tree_out(n).list[ND_tree_out(n).size++] = e;
@@ -69,13 +77,13 @@ static int add_tree_edge(edge_t * e)
     return 0;
 }
 
-static void exchange_tree_edges(edge_t * e, edge_t * f)
+static void exchange_tree_edges(ns_solver_t * ns, edge_t * e, edge_t * f)
 {
     int i, j;
     node_t *n;
 
     ED_tree_index(f) = ED_tree_index(e);
-    Tree_edge.list[ED_tree_index(e)] = f;
+    ns->tree_edge.list[ED_tree_index(e)] = f;
     ED_tree_index(e) = -1;
 
     n = agtail(e);
@@ -102,23 +110,24 @@ static void exchange_tree_edges(edge_t * e, edge_t * f)
 }
 
 static
-void init_rank(void)
+void init_rank(ns_solver_t * ns)
 {
     int i, ctr;
     nodequeue *Q;
     node_t *v;
     edge_t *e;
 
-    Q = new_queue(N_nodes);
+    Q = new_queue(ns->n_nodes);
     ctr = 0;
 
-    for (v = GD_nlist(G); v; v = ND_next(v)) {
+    for (v = GD_nlist(ns->g); v; v = ND_next(v)) {
 	if (ND_priority(v) == 0)
 	    enqueue(Q, v);
     }
 
     while ((v = dequeue(Q))) {
-	ND_rank(v) = 0;
+	if (!ns->warm)
+	    ND_rank(v) = 0;
 	ctr++;
 	for (i = 0; (e = ND_in(v).list[i]); i++)
 	    ND_rank(v) = MAX(ND_rank(v), ND_rank(agtail(e)) + ED_minlen(e));
@@ -127,99 +136,96 @@ void init_rank(void)
 		enqueue(Q, aghead(e));
 	}
     }
-    if (ctr != N_nodes) {
+    if (ctr != ns->n_nodes) {
 	agerr(AGERR, "trouble in init_rank\n");
-	for (v = GD_nlist(G); v; v = ND_next(v))
+	for (v = GD_nlist(ns->g); v; v = ND_next(v))
 	    if (ND_priority(v))
 		agerr(AGPREV, "\t%s %d\n", agnameof(v), ND_priority(v));
     }
     free_queue(Q);
 }
 
-static edge_t *leave_edge(void)
+static edge_t *leave_edge(ns_solver_t * ns)
 {
     edge_t *f, *rv = NULL;
     int j, cnt = 0;
 
-    j = S_i;
-    while (S_i < Tree_edge.size) {
-	if (ED_cutvalue(f = Tree_edge.list[S_i]) < 0) {
+    j = ns->s_i;
+    while (ns->s_i < ns->tree_edge.size) {
+	if (ED_cutvalue(f = ns->tree_edge.list[ns->s_i]) < 0) {
 	    if (rv) {
 		if (ED_cutvalue(rv) > ED_cutvalue(f))
 		    rv = f;
 	    } else
-		rv = Tree_edge.list[S_i];
-	    if (++cnt >= Search_size)
+		rv = ns->tree_edge.list[ns->s_i];
+	    if (++cnt >= ns->search_size)
 		return rv;
 	}
-	S_i++;
+	ns->s_i++;
     }
     if (j > 0) {
-	S_i = 0;
-	while (S_i < j) {
-	    if (ED_cutvalue(f = Tree_edge.list[S_i]) < 0) {
+	ns->s_i = 0;
+	while (ns->s_i < j) {
+	    if (ED_cutvalue(f = ns->tree_edge.list[ns->s_i]) < 0) {
 		if (rv) {
 		    if (ED_cutvalue(rv) > ED_cutvalue(f))
 			rv = f;
 		} else
-		    rv = Tree_edge.list[S_i];
-		if (++cnt >= Search_size)
+		    rv = ns->tree_edge.list[ns->s_i];
+		if (++cnt >= ns->search_size)
 		    return rv;
 	    }
-	    S_i++;
+	    ns->s_i++;
 	}
     }
     return rv;
 }
 
-static edge_t *Enter;
-static int Low, Lim, Slack;
-
-static void dfs_enter_outedge(node_t * v)
+static void dfs_enter_outedge(ns_solver_t * ns, node_t * v)
 {
     int i, slack;
     edge_t *e;
 
     for (i = 0; (e = ND_out(v).list[i]); i++) {
 	if (!TREE_EDGE(e)) {
-	    if (!SEQ(Low, ND_lim(aghead(e)), Lim)) {
+	    if (!SEQ(ns->low, ND_lim(aghead(e)), ns->lim)) {
 		slack = SLACK(e);
-		if (slack < Slack || Enter == NULL) {
-		    Enter = e;
-		    Slack = slack;
+		if (slack < ns->slack || ns->enter == NULL) {
+		    ns->enter = e;
+		    ns->slack = slack;
 		}
 	    }
 	} else if (ND_lim(aghead(e)) < ND_lim(v))
-	    dfs_enter_outedge(aghead(e));
+	    dfs_enter_outedge(ns, aghead(e));
     }
-    for (i = 0; (e = ND_tree_in(v).list[i]) && (Slack > 0); i++)
+    for (i = 0; (e = ND_tree_in(v).list[i]) && (ns->slack > 0); i++)
 	if (ND_lim(agtail(e)) < ND_lim(v))
-	    dfs_enter_outedge(agtail(e));
+	    dfs_enter_outedge(ns, agtail(e));
 }
 
-static void dfs_enter_inedge(node_t * v)
+static void dfs_enter_inedge(ns_solver_t * ns, node_t * v)
 {
     int i, slack;
     edge_t *e;
 
     for (i = 0; (e = ND_in(v).list[i]); i++) {
 	if (!TREE_EDGE(e)) {
-	    if (!SEQ(Low, ND_lim(agtail(e)), Lim)) {
+	    if (!SEQ(ns->low, ND_lim(agtail(e)), ns->lim)) {
 		slack = SLACK(e);
-		if (slack < Slack || Enter == NULL) {
-		    Enter = e;
-		    Slack = slack;
+		if (slack < ns->slack || ns->enter == NULL) {
+		    ns->enter = e;
+		    ns->slack = slack;
 		}
 	    }
 	} else if (ND_lim(agtail(e)) < ND_lim(v))
-	    dfs_enter_inedge(agtail(e));
+	    dfs_enter_inedge(ns, agtail(e));
     }
-    for (i = 0; (e = ND_tree_out(v).list[i]) && Slack > 0; i++)
+    for (i = 0; (e = ND_tree_out(v).list[i]) && ns->slack > 0; i++)
 	if (ND_lim(aghead(e)) < ND_lim(v))
-	    dfs_enter_inedge(aghead(e));
+	    dfs_enter_inedge(ns, aghead(e));
 }
 
-static edge_t *enter_edge(edge_t * e)
+static edge_t *enter_edge(ns_solver_t * ns, edge_t * e)
 {
     node_t *v;
     int outsearch;
@@ -232,27 +238,30 @@ static edge_t *enter_edge(edge_t * e)
 	v = aghead(e);
 	outsearch = TRUE;
     }
-    Enter = NULL;
-    Slack = INT_MAX;
-    Low = ND_low(v);
-    Lim = ND_lim(v);
+    ns->enter = NULL;
+    ns->slack = INT_MAX;
+    ns->low = ND_low(v);
+    ns->lim = ND_lim(v);
     if (outsearch)
-	dfs_enter_outedge(v);
+	dfs_enter_outedge(ns, v);
     else
-	dfs_enter_inedge(v);
-    return Enter;
+	dfs_enter_inedge(ns, v);
+    return ns->enter;
 }
 
-static void init_cutvalues(void)
+static void init_cutvalues(ns_solver_t * ns)
 {
-    dfs_range(GD_nlist(G), NULL, 1);
-    dfs_cutval(GD_nlist(G), NULL);
+    dfs_range(GD_nlist(ns->g), NULL, 1);
+    dfs_cutval(GD_nlist(ns->g), NULL);
 }
 
 /* functions for initial tight tree construction */
 // borrow field from network simplex - overwritten in init_cutvalues() forgive me
 #define ND_subtree(n) (subtree_t*)ND_par(n)
 #define ND_subtree_set(n,value) (ND_par(n) = (edge_t*)value)
+/* on a warm start, marks the edges of the previous tree until feasible_tree()
+ * is done with them; init_cutvalues() overwrites it on the new tree edges */
+#define ED_prev_tree(e) ED_cutvalue(e)
 
 typedef struct subtree_s {
         node_t *rep;            /* some node in the tree */
@@ -261,8 +270,12 @@ typedef struct subtree_s {
         struct subtree_s *par;  /* union find */
 } subtree_t;
 
-/* find initial tight subtrees */
-static int tight_subtree_search(Agnode_t *v, subtree_t *st)
+/* find initial tight subtrees
+ * On a warm start, only edges of the previous tree are followed, so the
+ * subtrees are the parts of that tree which are still tight; merging them
+ * restores the rest of the tree.
+ */
+static int tight_subtree_search(ns_solver_t * ns, Agnode_t *v, subtree_t *st)
 {
     Agedge_t *e;
     int     i;
@@ -272,31 +285,33 @@ static int tight_subtree_search(Agnode_t *v, subtree_t *st)
     ND_subtree_set(v,st);
     for (i = 0; (e = ND_in(v).list[i]); i++) {
         if (TREE_EDGE(e)) continue;
+        if (ns->warm && !ED_prev_tree(e)) continue;
         if (ND_subtree(agtail(e)) == 0 && SLACK(e) == 0) {
-               if (add_tree_edge(e) != 0) {
+               if (add_tree_edge(ns, e) != 0) {
                    return -1;
                }
-               rv += tight_subtree_search(agtail(e),st);
+               rv += tight_subtree_search(ns, agtail(e),st);
         }
     }
     for (i = 0; (e = ND_out(v).list[i]); i++) {
         if (TREE_EDGE(e)) continue;
+        if (ns->warm && !ED_prev_tree(e)) continue;
         if (ND_subtree(aghead(e)) == 0 && SLACK(e) == 0) {
-               if (add_tree_edge(e) != 0) {
+               if (add_tree_edge(ns, e) != 0) {
                    return -1;
                }
-               rv += tight_subtree_search(aghead(e),st);
+               rv += tight_subtree_search(ns, aghead(e),st);
         }
     }
     return rv;
 }
 
-static subtree_t *find_tight_subtree(Agnode_t *v)
+static subtree_t *find_tight_subtree(ns_solver_t * ns, Agnode_t *v)
 {
     subtree_t       *rv;
     rv = NEW(subtree_t);
     rv->rep = v;
-    rv->size = tight_subtree_search(v,rv);
+    rv->size = tight_subtree_search(ns, v,rv);
     if (rv->size < 0) {
         free(rv);
         return NULL;
@@ -456,7 +471,7 @@ void tree_adjust(Agnode_t *v, Agnode_t *from, int delta)
 }
 
 static
-subtree_t *merge_trees(Agedge_t *e)   /* entering tree edge */
+subtree_t *merge_trees(ns_solver_t * ns, Agedge_t *e)   /* entering tree edge */
 {
   int       delta;
   subtree_t *t0, *t1, *rv;
@@ -466,7 +481,7 @@ subtree_t *merge_trees(Agedge_t *e)   /* entering tree edge */
   t0 = STsetFind(agtail(e));
   t1 = STsetFind(aghead(e));
 
-  //fprintf(stderr,"merge trees of %d %d of %d, delta %d\n",t0->size,t1->size,N_nodes,delta);
+  //fprintf(stderr,"merge trees of %d %d of %d, delta %d\n",t0->size,t1->size,ns->n_nodes,delta);
 
   if (t0->heap_index == -1) {   // move t0
     delta = SLACK(e);
@@ -476,7 +491,7 @@ subtree_t *merge_trees(Agedge_t *e)   /* entering tree edge */
     delta = -SLACK(e);
     tree_adjust(t1->rep,NULL,delta);
   }
-  if (add_tree_edge(e) != 0) {
+  if (add_tree_edge(ns, e) != 0) {
     return NULL;
   }
   rv = STsetUnion(t0,t1);
@@ -490,7 +505,7 @@ subtree_t *merge_trees(Agedge_t *e)   /* entering tree edge */
  * Return 1 if input graph is not connected; 0 on success.
  */
 static
-int feasible_tree(void)
+int feasible_tree(ns_solver_t * ns)
 {
   Agnode_t *n;
   Agedge_t *ee;
@@ -500,15 +515,15 @@ int feasible_tree(void)
   int error = 0;
 
   /* initialization */
-  for (n = GD_nlist(G); n; n = ND_next(n)) {
+  for (n = GD_nlist(ns->g); n; n = ND_next(n)) {
       ND_subtree_set(n,0);
   }
 
-  tree = N_NEW(N_nodes,subtree_t*);
+  tree = N_NEW(ns->n_nodes,subtree_t*);
   /* given init_rank, find all tight subtrees */
-  for (n = GD_nlist(G); n; n = ND_next(n)) {
+  for (n = GD_nlist(ns->g); n; n = ND_next(n)) {
         if (ND_subtree(n) == 0) {
-                tree[subtree_count] = find_tight_subtree(n);
+                tree[subtree_count] = find_tight_subtree(ns, n);
                 if (tree[subtree_count] == NULL) {
                     error = 2;
                     goto end;
@@ -525,7 +540,7 @@ int feasible_tree(void)
       error = 1;
       break;
     }
-    tree1 = merge_trees(ee);
+    tree1 = merge_trees(ns, ee);
     if (tree1 == NULL) {
       error = 2;
       break;
@@ -537,9 +552,14 @@ end:
   free(heap);
   for (i = 0; i < subtree_count; i++) free(tree[i]);
   free(tree);
+  if (ns->warm) {
+    for (n = GD_nlist(ns->g); n; n = ND_next(n))
+      for (i = 0; (ee = ND_out(n).list[i]); i++)
+        ED_prev_tree(ee) = 0;
+  }
   if (error) return error;
-  assert(Tree_edge.size == N_nodes - 1);
-  init_cutvalues();
+  assert(ns->tree_edge.size == ns->n_nodes - 1);
+  init_cutvalues(ns);
   return 0;
 }
 
@@ -585,7 +605,7 @@ static void rerank(Agnode_t * v, int delta)
  * is entering.  compute new cut values, ranks, and exchange e and f.
  */
 static int
-update(edge_t * e, edge_t * f)
+update(ns_solver_t * ns, edge_t * e, edge_t * f)
 {
     int cutvalue, delta;
     Agnode_t *lca;
@@ -618,28 +638,28 @@ update(edge_t * e, edge_t * f)
     }
     ED_cutvalue(f) = -cutvalue;
     ED_cutvalue(e) = 0;
-    exchange_tree_edges(e, f);
+    exchange_tree_edges(ns, e, f);
     dfs_range(lca, ND_par(lca), ND_low(lca));
     return 0;
 }
 
-static void scan_and_normalize(void)
+static void scan_and_normalize(ns_solver_t * ns)
 {
     node_t *n;
 
-    Minrank = INT_MAX;
-    Maxrank = -INT_MAX;
-    for (n = GD_nlist(G); n; n = ND_next(n)) {
+    ns->minrank = INT_MAX;
+    ns->maxrank = -INT_MAX;
+    for (n = GD_nlist(ns->g); n; n = ND_next(n)) {
 	if (ND_node_type(n) == NORMAL) {
-	    Minrank = MIN(Minrank, ND_rank(n));
-	    Maxrank = MAX(Maxrank, ND_rank(n));
+	    ns->minrank = MIN(ns->minrank, ND_rank(n));
+	    ns->maxrank = MAX(ns->maxrank, ND_rank(n));
 	}
     }
-    if (Minrank != 0) {
-	for (n = GD_nlist(G); n; n = ND_next(n))
-	    ND_rank(n) -= Minrank;
-	Maxrank -= Minrank;
-	Minrank = 0;
+    if (ns->minrank != 0) {
+	for (n = GD_nlist(ns->g); n; n = ND_next(n))
+	    ND_rank(n) -= ns->minrank;
+	ns->maxrank -= ns->minrank;
+	ns->minrank = 0;
     }
 }
 
@@ -647,22 +667,22 @@ static void
 freeTreeList (graph_t* g)
 {
     node_t *n;
-    for (n = GD_nlist(G); n; n = ND_next(n)) {
+    for (n = GD_nlist(g); n; n = ND_next(n)) {
 	free_list(ND_tree_in(n));
 	free_list(ND_tree_out(n));
 	ND_mark(n) = FALSE;
     }
 }
 
-static void LR_balance(void)
+static void LR_balance(ns_solver_t * ns)
 {
     int i, delta;
     edge_t *e, *f;
 
-    for (i = 0; i < Tree_edge.size; i++) {
-	e = Tree_edge.list[i];
+    for (i = 0; i < ns->tree_edge.size; i++) {
+	e = ns->tree_edge.list[i];
 	if (ED_cutvalue(e) == 0) {
-	    f = enter_edge(e);
+	    f = enter_edge(ns, e);
 	    if (f == NULL)
 		continue;
 	    delta = SLACK(f);
@@ -674,7 +694,7 @@ static void LR_balance(void)
 		rerank(aghead(e), -delta / 2);
 	}
     }
-    freeTreeList (G);
+    freeTreeList (ns->g);
 }
 
 static int decreasingrankcmpf(node_t **n0, node_t **n1) {
@@ -685,7 +705,7 @@ static int increasingrankcmpf(node_t **n0, node_t **n1) {
   return ND_rank(*n0) - ND_rank(*n1);
 }
 
-static void TB_balance(void)
+static void TB_balance(ns_solver_t * ns)
 {
     node_t *n;
     edge_t *e;
@@ -694,39 +714,39 @@ static void TB_balance(void)
     int adj = 0;
     char *s;
 
-    scan_and_normalize();
+    scan_and_normalize(ns);
 
     /* find nodes that are not tight and move to less populated ranks */
-    nrank = N_NEW(Maxrank + 1, int);
-    for (i = 0; i <= Maxrank; i++)
+    nrank = N_NEW(ns->maxrank + 1, int);
+    for (i = 0; i <= ns->maxrank; i++)
 	nrank[i] = 0;
-    if ( (s = agget(G,"TBbalance")) ) {
+    if ( (s = agget(ns->g,"TBbalance")) ) {
          if (streq(s,"min")) adj = 1;
          else if (streq(s,"max")) adj = 2;
-         if (adj) for (n = GD_nlist(G); n; n = ND_next(n))
+         if (adj) for (n = GD_nlist(ns->g); n; n = ND_next(n))
               if (ND_node_type(n) == NORMAL)
                 if (ND_out(n).size == 0)
-                   ND_rank(n) = ((adj == 1)? Minrank : Maxrank);
+                   ND_rank(n) = ((adj == 1)? ns->minrank : ns->maxrank);
     }
-    for (ii = 0, n = GD_nlist(G); n; ii++, n = ND_next(n)) {
-      Tree_node.list[ii] = n;
+    for (ii = 0, n = GD_nlist(ns->g); n; ii++, n = ND_next(n)) {
+      ns->tree_node.list[ii] = n;
     }
-    Tree_node.size = ii;
-    qsort(Tree_node.list, Tree_node.size, sizeof(Tree_node.list[0]),
+    ns->tree_node.size = ii;
+    qsort(ns->tree_node.list, ns->tree_node.size, sizeof(ns->tree_node.list[0]),
         adj > 1? (int(*)(const void*,const void*))decreasingrankcmpf
                : (int(*)(const void*,const void*))increasingrankcmpf);
-    for (i = 0; i < Tree_node.size; i++) {
-        n = Tree_node.list[i];
+    for (i = 0; i < ns->tree_node.size; i++) {
+        n = ns->tree_node.list[i];
         if (ND_node_type(n) == NORMAL)
           nrank[ND_rank(n)]++;
     }
-    for (ii = 0; ii < Tree_node.size; ii++) {
-      n = Tree_node.list[ii];
+    for (ii = 0; ii < ns->tree_node.size; ii++) {
+      n = ns->tree_node.list[ii];
       if (ND_node_type(n) != NORMAL)
         continue;
       inweight = outweight = 0;
       low = 0;
-      high = Maxrank;
+      high = ns->maxrank;
       for (i = 0; (e = ND_in(n).list[i]); i++) {
         inweight += ED_weight(e);
         low = MAX(low, ND_rank(agtail(e)) + ED_minlen(e));
@@ -759,25 +779,25 @@ static void TB_balance(void)
     free(nrank);
 }
 
-static int init_graph(graph_t * g)
+static int init_graph(ns_solver_t * ns, graph_t * g)
 {
     int i, feasible;
     node_t *n;
     edge_t *e;
 
-    G = g;
-    N_nodes = N_edges = S_i = 0;
+    ns->g = g;
+    ns->n_nodes = ns->n_edges = ns->s_i = 0;
     for (n = GD_nlist(g); n; n = ND_next(n)) {
 	ND_mark(n) = FALSE;
-	N_nodes++;
+	ns->n_nodes++;
 	for (i = 0; (e = ND_out(n).list[i]); i++)
-	    N_edges++;
+	    ns->n_edges++;
     }
 
-    Tree_node.list = ALLOC(N_nodes, Tree_node.list, node_t *);
-    Tree_node.size = 0;
-    Tree_edge.list = ALLOC(N_nodes, Tree_edge.list, edge_t *);
-    Tree_edge.size = 0;
+    ns->tree_node.list = ALLOC(ns->n_nodes, ns->tree_node.list, node_t *);
+    ns->tree_node.size = 0;
+    ns->tree_edge.list = ALLOC(ns->n_nodes, ns->tree_edge.list, edge_t *);
+    ns->tree_edge.size = 0;
 
     feasible = TRUE;
     for (n = GD_nlist(g); n; n = ND_next(n)) {
@@ -785,6 +805,8 @@ static int init_graph(graph_t * g)
 	for (i = 0; (e = ND_in(n).list[i]); i++) {
 	    ND_priority(n)++;
 	    ED_cutvalue(e) = 0;
+	    if (ns->warm)
+		ED_prev_tree(e) = TREE_EDGE(e);
 	    ED_tree_index(e) = -1;
 	    if (feasible
 		&& ND_rank(aghead(e)) - ND_rank(agtail(e)) < ED_minlen(e))
@@ -820,7 +842,7 @@ graphSize (graph_t * g, int* nn, int* ne)
     *ne = nedges;
 }
 
-/* rank:
+/* ns_solver_rank:
  * Apply network simplex to rank the nodes in a graph.
  * Uses ED_minlen as the internode constraint: if a->b with minlen=ml,
  * rank b - rank a >= ml.
@@ -831,11 +853,17 @@ graphSize (graph_t * g, int* nn, int* ne)
  * The node rank values are stored in ND_rank.
  * Returns 0 if successful; returns 1 if the graph was not connected;
  * returns 2 if something seriously wrong;
+ * The edges of the final spanning tree are left with ED_tree_index >= 0,
+ * and all other edges with ED_tree_index < 0, for use by rank_warm.
+ * If warm is set, starts from the previous solution as rank_warm does.
+ * All working state lives in ns, which can be reused for further solves but
+ * not shared by concurrent ones; rank, rank2 and rank_warm each use their own.
  */
-int rank2(graph_t * g, int balance, int maxiter, int search_size)
+int ns_solver_rank(ns_solver_t * ns, graph_t * g, int balance, int maxiter,
+		   int search_size, int warm)
 {
     int iter = 0, feasible;
-    char *ns = "network simplex: ";
+    char *msg = "network simplex: ";
     edge_t *e, *f;
 
 #ifdef DEBUG
@@ -844,34 +872,35 @@ int rank2(graph_t * g, int balance, int maxiter, int search_size)
     if (Verbose) {
 	int nn, ne;
 	graphSize (g, &nn, &ne);
-	fprintf(stderr, "%s %d nodes %d edges maxiter=%d balance=%d\n", ns,
-	    nn, ne, maxiter, balance);
+	fprintf(stderr, "%s %d nodes %d edges maxiter=%d balance=%d%s\n", msg,
+	    nn, ne, maxiter, balance, (warm ? " warm" : ""));
 	start_timer();
     }
-    feasible = init_graph(g);
+    ns->warm = warm;
+    feasible = init_graph(ns, g);
     if (!feasible)
-	init_rank();
+	init_rank(ns);
     if (maxiter <= 0) {
 	freeTreeList (g);
 	return 0;
     }
 
     if (search_size >= 0)
-	Search_size = search_size;
+	ns->search_size = search_size;
     else
-	Search_size = SEARCHSIZE;
+	ns->search_size = SEARCHSIZE;
 
     {
-	int err = feasible_tree();
+	int err = feasible_tree(ns);
 	if (err != 0) {
 	    freeTreeList (g);
 	    return err;
 	}
     }
-    while ((e = leave_edge())) {
+    while ((e = leave_edge(ns))) {
 	int err;
-	f = enter_edge(e);
-	err = update(e, f);
+	f = enter_edge(ns, e);
+	err = update(ns, e, f);
 	if (err != 0) {
 	    freeTreeList (g);
 	    return err;
@@ -879,7 +908,7 @@ int rank2(graph_t * g, int balance, int maxiter, int search_size)
 	iter++;
 	if (Verbose && iter % 100 == 0) {
 	    if (iter % 1000 == 100)
-		fputs(ns, stderr);
+		fputs(msg, stderr);
 	    fprintf(stderr, "%d ", iter);
 	    if (iter % 1000 == 0)
 		fputc('\n', stderr);
@@ -889,36 +918,80 @@ int rank2(graph_t * g, int balance, int maxiter, int search_size)
     }
     switch (balance) {
     case 1:
-	TB_balance();
+	TB_balance(ns);
 	break;
     case 2:
-	LR_balance();
+	LR_balance(ns);
 	break;
     default:
-	scan_and_normalize();
-	freeTreeList (G);
+	scan_and_normalize(ns);
+	freeTreeList (ns->g);
 	break;
     }
     if (Verbose) {
 	if (iter >= 100)
 	    fputc('\n', stderr);
 	fprintf(stderr, "%s%d nodes %d edges %d iter %.2f sec\n",
-		ns, N_nodes, N_edges, iter, elapsed_sec());
+		msg, ns->n_nodes, ns->n_edges, iter, elapsed_sec());
     }
     return 0;
 }
 
-int rank(graph_t * g, int balance, int maxiter)
+ns_solver_t *ns_solver_new(void)
+{
+    return NEW(ns_solver_t);
+}
+
+void ns_solver_free(ns_solver_t * ns)
+{
+    if (!ns)
+	return;
+    free(ns->tree_node.list);
+    free(ns->tree_edge.list);
+    free(ns);
+}
+
+int rank2(graph_t * g, int balance, int maxiter, int search_size)
+{
+    ns_solver_t *ns = ns_solver_new();
+    int rv = ns_solver_rank(ns, g, balance, maxiter, search_size, FALSE);
+
+    ns_solver_free(ns);
+    return rv;
+}
+
+static int searchsize(graph_t * g)
 {
     char *s;
-    int search_size;
 
     if ((s = agget(g, "searchsize")))
-	search_size = atoi(s);
+	return atoi(s);
     else
-	search_size = SEARCHSIZE;
+	return SEARCHSIZE;
+}
+
+int rank(graph_t * g, int balance, int maxiter)
+{
+    return rank2 (g, balance, maxiter, searchsize(g));
+}
 
-    return rank2 (g, balance, maxiter, search_size);
+/* rank_warm:
+ * As rank, but starts from the current ND_rank values and from the spanning
+ * tree of a previous solution, as left in ED_tree_index, instead of from
+ * scratch. This is meant for solving again after small changes to a graph
+ * that was already ranked: ranks violating a constraint are raised just
+ * enough to make them feasible, the parts of the old tree that are still
+ * tight are kept, and the usual tree merging and pivoting repair the rest.
+ * Edges added since then whose ED_tree_index is >= 0, as it is for zeroed
+ * edge data, are taken to be old tree edges; that only costs some pivots.
+ */
+int rank_warm(graph_t * g, int balance, int maxiter)
+{
+    ns_solver_t *ns = ns_solver_new();
+    int rv = ns_solver_rank(ns, g, balance, maxiter, searchsize(g), TRUE);
+
+    ns_solver_free(ns);
+    return rv;
 }
 
 /* set cut value of f, assuming values of edges on one side were already set */
@@ -1017,7 +1090,7 @@ static int dfs_range(node_t * v, edge_t * par, int low)
 }
 
 #ifdef DEBUG
-void tchk(void)
+void tchk(ns_solver_t * ns)
 {
     int i, n_cnt, e_cnt;
     node_t *n;
@@ -1025,7 +1098,7 @@ void tchk(void)
 
     n_cnt = 0;
     e_cnt = 0;
-    for (n = agfstnode(G); n; n = agnxtnode(G, n)) {
+    for (n = agfstnode(ns->g); n; n = agnxtnode(ns->g, n)) {
 	n_cnt++;
 	for (i = 0; (e = ND_tree_out(n).list[i]); i++) {
 	    e_cnt++;
@@ -1033,17 +1106,17 @@ void tchk(void)
 		fprintf(stderr, "not a tight tree %p", e);
 	}
     }
-    if (n_cnt != Tree_node.size || e_cnt != Tree_edge.size)
+    if (n_cnt != ns->tree_node.size || e_cnt != ns->tree_edge.size)
 	fprintf(stderr, "something missing\n");
 }
 
-void check_cutvalues(void)
+void check_cutvalues(ns_solver_t * ns)
 {
     node_t *v;
     edge_t *e;
     int i, save;
 
-    for (v = agfstnode(G); v; v = agnxtnode(G, v)) {
+    for (v = agfstnode(ns->g); v; v = agnxtnode(ns->g, v)) {
 	for (i = 0; (e = ND_tree_out(v).list[i]); i++) {
 	    save = ED_cutvalue(e);
 	    x_cutval(e);
@@ -1053,14 +1126,14 @@ void check_cutvalues(void)
     }
 }
 
-int check_ranks(void)
+int check_ranks(ns_solver_t * ns)
 {
     int cost = 0;
     node_t *n;
     edge_t *e;
 
-    for (n = agfstnode(G); n; n = agnxtnode(G, n)) {
-	for (e = agfstout(G, n); e; e = agnxtout(G, e)) {
+    for (n = agfstnode(ns->g); n; n = agnxtnode(ns->g, n)) {
+	for (e = agfstout(ns->g, n); e; e = agnxtout(ns->g, e)) {
 	    cost += (ED_weight(e)) * abs(LENGTH(e));
 	    if (ND_rank(aghead(e)) - ND_rank(agtail(e)) - ED_minlen(e) < 0)
 		abort();
@@ -1070,13 +1143,13 @@ int check_ranks(void)
     return cost;
 }
 
-void checktree(void)
+void checktree(ns_solver_t * ns)
 {
     int i, n = 0, m = 0;
     node_t *v;
     edge_t *e;
 
-    for (v = agfstnode(G); v; v = agnxtnode(G, v)) {
+    for (v = agfstnode(ns->g); v; v = agnxtnode(ns->g, v)) {
 	for (i = 0; (e = ND_tree_out(v).list[i]); i++)
 	    n++;
 	if (i != ND_tree_out(v).size)
@@ -1086,7 +1159,7 @@ void checktree(void)
 	if (i != ND_tree_in(v).size)
 	    abort();
     }
-    fprintf(stderr, "%d %d %d\n", Tree_edge.size, n, m);
+    fprintf(stderr, "%d %d %d\n", ns->tree_edge.size, n, m);
 }
 
 void check_fast_node(node_t * n)
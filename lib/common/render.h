@@ -54,6 +54,9 @@ extern "C" {
 	point offset;
     } epsf_t;
 
+    /* network simplex solver state, see ns.c */
+    typedef struct ns_solver_s ns_solver_t;
+
 /*visual studio*/
 #ifdef _WIN32
 #ifndef GVC_EXPORTS
@@ -64,6 +67,7 @@ extern "C" {
 
 	extern void add_box(path *, boxf);
     extern void arrow_flags(Agedge_t * e, int *sflag, int *eflag);
+    extern void arrow_flags_attrs(Agraph_t * g);
     extern boxf arrow_bb(pointf p, pointf u, double arrowsize, int flag);
     extern void arrow_gen(GVJ_t * job, emit_state_t emit_state, pointf p, pointf u,
 			  double arrowsize, double penwidth, int flag);
@@ -83,6 +87,13 @@ extern "C" {
 	pointf * ps, int pn, splineInfo * info);
     extern char* charsetToStr (int c);
     extern pointf coord(node_t * n);
+    extern boolean distcache_enabled(graph_t * g);
+    extern void *distcache_get(graph_t * g, const char *kind,
+			       const void *key, size_t keylen, size_t * size);
+    extern void distcache_put(graph_t * g, const char *kind,
+			      const void *key, size_t keylen,
+			      const void *data, size_t size);
+    extern void distcache_close(GVC_t * gvc);
     extern void do_graph_label(graph_t * sg);
     extern void graph_init(graph_t * g, boolean use_rankdir);
     extern void graph_cleanup(graph_t * g);
@@ -132,6 +143,11 @@ extern "C" {
     extern void pop_obj_state(GVJ_t *job);
     extern obj_state_t* push_obj_state(GVJ_t *job);
     extern int rank(graph_t * g, int balance, int maxiter);
+    extern int rank_warm(graph_t * g, int balance, int maxiter);
+    extern ns_solver_t *ns_solver_new(void);
+    extern void ns_solver_free(ns_solver_t * ns);
+    extern int ns_solver_rank(ns_solver_t * ns, graph_t * g, int balance,
+			      int maxiter, int search_size, int warm);
     extern port resolvePort(node_t*  n, node_t* other, port* oldport);
     extern void resolvePorts (edge_t* e);
     extern void round_corners(GVJ_t * job, pointf * AF, int sides, int style, int filled);
@@ -144,6 +160,7 @@ extern "C" {
     extern void setup_graph(GVC_t * gvc, graph_t * g);
     extern shape_kind shapeOf(node_t *);
     extern void shape_clip(node_t * n, pointf curve[4]);
+    extern void gv_initShapes(void);
     extern void make_simple_label (GVC_t * gvc, textlabel_t* rv);
     extern int stripedBox (GVJ_t * job, pointf* AF, char* clrs, int rotate);
     extern stroke_t* taper (bezier*, double (*radfunc_t)(double,double,double), double initwid, int linejoin, int linecap);
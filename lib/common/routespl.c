@@ -32,6 +32,12 @@ static Ppoint_t *polypoints;  /* vertices of polygon defined by boxes */
 static int polypointn;        /* size of polypoints[] */
 static Pedge_t *edges;        /* polygon edges passed to Proutespline */
 static int edgen;             /* size of edges[] */
+#ifdef _OPENMP
+/* dot routes independent edges concurrently, each thread with its own
+ * buffers; ps is allocated on first use by threads other than the master.
+ */
+#pragma omp threadprivate(ps, maxpn, polypoints, polypointn, edges, edgen)
+#endif
 
 static int checkpath(int, boxf*, path*);
 static int mkspacep(int size);
@@ -395,7 +401,13 @@ static pointf *_routesplines(path * pp, int *npoints, int polyline)
     boolean unbounded;
 
     *npoints = 0;
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
     nedges++;
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
     nboxes += pp->nbox;
 
     for (realedge = (edge_t *) pp->data;
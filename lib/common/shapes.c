@@ -2264,6 +2264,10 @@ static boolean poly_inside(inside_t * inside_context, pointf p)
     static pointf O;		/* point (0,0) */
     static pointf *vertex;
     static double xsize, ysize, scalex, scaley, box_URx, box_URy;
+#ifdef _OPENMP
+#pragma omp threadprivate(lastn, poly, last, outp, sides, O, vertex, \
+			  xsize, ysize, scalex, scaley, box_URx, box_URy)
+#endif
 
     int i, i1, j, s;
     pointf P, Q, R;
@@ -3057,6 +3061,9 @@ static boolean point_inside(inside_t * inside_context, pointf p)
 {
     static node_t *lastn;	/* last node argument */
     static double radius;
+#ifdef _OPENMP
+#pragma omp threadprivate(lastn, radius)
+#endif
     pointf P;
     node_t *n;
 
@@ -3961,6 +3968,9 @@ static boolean star_inside(inside_t * inside_context, pointf p)
     static int outp, sides;
     static pointf *vertex;
     static pointf O;		/* point (0,0) */
+#ifdef _OPENMP
+#pragma omp threadprivate(lastn, poly, outp, sides, vertex, O)
+#endif
 
     if (!inside_context) {
 	lastn = NULL;
@@ -159,10 +159,8 @@ shape_clip0(inside_t * inside_context, node_t * n, pointf curve[4],
 	    boolean left_inside)
 {
     int i;
-    double save_real_size;
     pointf c[4];
 
-    save_real_size = ND_rw(n);
     for (i = 0; i < 4; i++) {
 	c[i].x = curve[i].x - ND_coord(n).x;
 	c[i].y = curve[i].y - ND_coord(n).y;
@@ -175,7 +173,6 @@ shape_clip0(inside_t * inside_context, node_t * n, pointf curve[4],
 	curve[i].x = c[i].x + ND_coord(n).x;
 	curve[i].y = c[i].y + ND_coord(n).y;
     }
-    ND_rw(n) = save_real_size;
 }
 
 /* shape_clip:
@@ -320,7 +317,8 @@ clip_and_install(edge_t * fe, node_t * hn, pointf * ps, int pn,
 	cp[2] = ps[i];
 	i++;
 	cp[3] = ps[i];
-	update_bb_bz(&GD_bb(g), cp);
+	if (!info->ignoreBB)
+	    update_bb_bz(&GD_bb(g), cp);
     }
     newspl->size = end - start + 4;
 }
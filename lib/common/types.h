@@ -84,6 +84,7 @@ extern "C" {
 	boolean(*splineMerge) (node_t * n);	/* Is n a node in the middle of an edge? */
 	boolean ignoreSwap;                     /* Test for swapped edges if false */
 	boolean isOrtho;                        /* Orthogonal routing used */
+	boolean ignoreBB;                       /* Caller updates the graph bbox */
     } splineInfo;
 
     typedef struct pathend_t {
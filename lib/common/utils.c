@@ -69,33 +69,26 @@ node_t *dequeue(nodequeue * q)
 
 int late_int(void *obj, attrsym_t * attr, int def, int low)
 {
-    char *p;
-    char *endp;
+    long v;
     int rv;
     if (attr == NULL)
 	return def;
-    p = ag_xget(obj, attr);
-    if (!p || p[0] == '\0')
-	return def;
-    rv = strtol (p, &endp, 10);
-    if (p == endp) return def;  /* invalid int format */
+    /* the parsed value is cached with the attribute string */
+    if (!agxgetlong(obj, attr, &v))
+	return def;  /* empty or invalid int format */
+    rv = v;
     if (rv < low) return low;
     else return rv;
 }
 
 double late_double(void *obj, attrsym_t * attr, double def, double low)
 {
-    char *p;
-    char *endp;
     double rv;
 
     if (!attr || !obj)
 	return def;
-    p = ag_xget(obj, attr);
-    if (!p || p[0] == '\0')
-	return def;
-    rv = strtod (p, &endp);
-    if (p == endp) return def;  /* invalid double format */
+    if (!agxgetdouble(obj, attr, &rv))
+	return def;  /* empty or invalid double format */
     if (rv < low) return low;
     else return rv;
 }
@@ -16,6 +16,9 @@
 #include <dotgen/dot.h>
 #include <math.h>
 #include <stddef.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #ifdef ORTHO
 #include <ortho/ortho.h>
@@ -24,6 +27,9 @@
 #define	NSUB	9		/* number of subdivisions, re-aiming splines */
 #define	CHUNK	128		/* in building list of edges */
 
+/* the ends of a regular path are not refined by the neighboring splines */
+#define DONT_WANT_ANY_ENDPOINT_PATH_REFINEMENT
+
 #define MINW 16			/* minimum width of a box in the edge path */
 #define HALFMINW 8
 
@@ -51,13 +57,27 @@
 }
 
 static boxf boxes[1000];
+#ifdef _OPENMP
+/* regular edges are routed concurrently, each thread with its own boxes */
+#pragma omp threadprivate(boxes)
+#endif
 typedef struct {
     int LeftBound, RightBound, Splinesep, Multisep;
     boxf* Rank_box;
+    splineInfo* Sinfo;	/* passed to clip_and_install by make_regular_edge */
 } spline_info_t;
 
+/* a group of equivalent edges, edges[ind] to edges[ind+cnt-1] */
+typedef struct {
+    int ind, cnt;
+    int level;
+} edgegroup_t;
+
 static void adjustregularpath(path *, int, int);
+#ifndef DONT_WANT_ANY_ENDPOINT_PATH_REFINEMENT
 static Agedge_t *bot_bound(Agedge_t *, int);
+static Agedge_t *top_bound(Agedge_t *, int);
+#endif
 static boolean pathscross(Agnode_t *, Agnode_t *, Agedge_t *, Agedge_t *);
 static Agraph_t *cl_bound(graph_t*, Agnode_t *, Agnode_t *);
 static int cl_vninside(Agraph_t *, Agnode_t *);
@@ -76,7 +96,6 @@ static void resize_vn(Agnode_t *, int, int, int);
 static void setflags(Agedge_t *, int, int, int);
 static int straight_len(Agnode_t *);
 static Agedge_t *straight_path(Agedge_t *, int, pointf *, int *);
-static Agedge_t *top_bound(Agedge_t *, int);
 
 #define GROWEDGES (edges = ALLOC (n_edges + CHUNK, edges, edge_t*))
 
@@ -111,6 +130,8 @@ static boolean swap_ends_p(edge_t * e)
 }
 
 static splineInfo sinfo = { swap_ends_p, spline_merge };
+/* used while routing regular edges concurrently */
+static splineInfo bbsinfo = { swap_ends_p, spline_merge, FALSE, FALSE, TRUE };
 
 int portcmp(port p0, port p1)
 {
@@ -243,6 +264,170 @@ setEdgeLabelPos (graph_t * g)
     }
 }
 
+/* group_level:
+ * Return the level of the group of regular edges starting with e, that is,
+ * one more than the levels of the earlier groups it must follow, and record
+ * in lastw and lastr the nodes the group writes and reads.
+ * A group moves the virtual nodes of its path in recover_slack, and reads
+ * the positions of the nodes next to its path in maximal_bbox. The path is
+ * walked as in make_regular_edge, and the neighbors are found with the edges
+ * maximal_bbox is given. Node n has index base[ND_rank(n)] + ND_order(n);
+ * rd and wr are work space of three entries per rank.
+ */
+static int
+group_level(graph_t * g, edge_t * e, int *base, int *lastw, int *lastr,
+	    int *rd, int *wr)
+{
+    Agedgepair_t fwdedge;
+    edge_t *le, *ie, *oe;
+    node_t *tn, *hn, *vn, *nb;
+    int i, dir, nrd, nwr, level;
+
+    tn = (ED_tree_index(e) & BWDEDGE) ? aghead(e) : agtail(e);
+    if (abs(ND_rank(agtail(e)) - ND_rank(aghead(e))) > 1) {
+	le = getmainedge(e);
+	while (ED_to_virt(le))
+	    le = ED_to_virt(le);
+	hn = aghead(le);
+    } else
+	hn = (ED_tree_index(e) & BWDEDGE) ? agtail(e) : aghead(e);
+    /* pathscross only looks at the ends of the first edge */
+    fwdedge.out = *e;
+    fwdedge.in = *AGOUT2IN(e);
+    agtail(&fwdedge.out) = tn;
+    aghead(&fwdedge.out) = hn;
+
+    nrd = nwr = 0;
+    vn = tn;
+    ie = NULL;
+    oe = &fwdedge.out;
+    for (;;) {
+	for (dir = -1; dir <= 1; dir += 2) {
+	    nb = neighbor(g, vn, ie, oe, dir);
+	    if (nb && ND_node_type(nb) == VIRTUAL)
+		rd[nrd++] = base[ND_rank(nb)] + ND_order(nb);
+	}
+	if (ND_node_type(vn) == VIRTUAL) {
+	    if (vn == tn || !oe)
+		rd[nrd++] = base[ND_rank(vn)] + ND_order(vn);
+	    else
+		wr[nwr++] = base[ND_rank(vn)] + ND_order(vn);
+	}
+	if (!oe)
+	    break;
+	vn = aghead(oe);
+	ie = oe;
+	if (ND_node_type(vn) == VIRTUAL && !sinfo.splineMerge(vn))
+	    oe = ND_out(vn).list[0];
+	else
+	    oe = NULL;
+    }
+
+    level = 0;
+    for (i = 0; i < nrd; i++)
+	level = MAX(level, lastw[rd[i]]);
+    for (i = 0; i < nwr; i++)
+	level = MAX(level, MAX(lastw[wr[i]], lastr[wr[i]]));
+    level++;
+    for (i = 0; i < nrd; i++)
+	lastr[rd[i]] = MAX(lastr[rd[i]], level);
+    for (i = 0; i < nwr; i++)
+	lastw[wr[i]] = level;
+    return level;
+}
+
+/* route_regular_groups:
+ * Route the groups of regular edges in grp, by level, the groups of a
+ * level in parallel, so that each group sees the virtual nodes as it would
+ * if the groups were routed in order, whatever the number of threads.
+ * The growth of the graph's bounding box by a spline depends on the splines
+ * before it, so it is left to after the routing and done in order.
+ * cdt dictionaries reorganize themselves on every search, so the threads
+ * must not search any. They only read attribute values, with agxget and
+ * late_double, whose records are locked in place and whose numbers are
+ * parsed when interned. arrow_flags is given its attributes here, and
+ * agfindedge is only reached with concentrate=true, which is routed serially.
+ */
+static void
+route_regular_groups(graph_t * g, spline_info_t * sp, edge_t ** edges,
+		     edgegroup_t * grp, int ngrp, int et, int *base,
+		     int n_nodes)
+{
+    spline_info_t sd = *sp;
+    edgegroup_t *lgrp;
+    int *lastw, *lastr, *rd, *wr, *start;
+    int i, j, k, l, nlevels;
+    edge_t *e;
+    bezier *bz;
+
+    lastw = N_NEW(n_nodes, int);
+    lastr = N_NEW(n_nodes, int);
+    rd = N_NEW(3 * (GD_maxrank(g) - GD_minrank(g) + 2), int);
+    wr = N_NEW(3 * (GD_maxrank(g) - GD_minrank(g) + 2), int);
+    nlevels = 0;
+    for (i = 0; i < ngrp; i++) {
+	grp[i].level = group_level(g, edges[grp[i].ind], base, lastw, lastr,
+				   rd, wr);
+	nlevels = MAX(nlevels, grp[i].level);
+    }
+
+    /* sort the groups by level, keeping their order within a level;
+     * the groups of level l end up in lgrp[start[l-1]..start[l]-1]
+     */
+    start = N_NEW(nlevels + 1, int);
+    for (i = 0; i < ngrp; i++)
+	start[grp[i].level]++;
+    for (l = 1; l <= nlevels; l++)
+	start[l] += start[l - 1];
+    for (l = nlevels; l > 0; l--)
+	start[l] = start[l - 1];
+    lgrp = N_NEW(ngrp, edgegroup_t);
+    for (i = 0; i < ngrp; i++)
+	lgrp[start[grp[i].level]++] = grp[i];
+
+    sd.Sinfo = &bbsinfo;
+    arrow_flags_attrs(agroot(g));
+#ifdef _OPENMP
+#pragma omp parallel private(i, l)
+#endif
+    {
+	path *P = NEW(path);
+
+	P->boxes = N_NEW(n_nodes + 20 * 2 * NSUB, boxf);
+	/* the shape caches of a thread may refer to nodes of other graphs */
+	gv_initShapes();
+	for (l = 1; l <= nlevels; l++) {
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+	    for (i = start[l - 1]; i < start[l]; i++)
+		make_regular_edge(g, &sd, P, edges, lgrp[i].ind, lgrp[i].cnt, et);
+	}
+	free(P->boxes);
+	free(P);
+    }
+    arrow_flags_attrs(NULL);
+
+    for (i = 0; i < ngrp; i++) {
+	for (j = 0; j < grp[i].cnt; j++) {
+	    for (e = edges[grp[i].ind + j]; ED_edge_type(e) != NORMAL;
+		 e = ED_to_orig(e));
+	    if (!ED_spl(e))
+		continue;
+	    bz = &ED_spl(e)->list[ED_spl(e)->size - 1];
+	    for (k = 0; k + 3 < bz->size; k += 3)
+		update_bb_bz(&GD_bb(agraphof(agtail(e))), bz->list + k);
+	}
+    }
+
+    free(lgrp);
+    free(start);
+    free(rd);
+    free(wr);
+    free(lastr);
+    free(lastw);
+}
+
 /* _dot_splines:
  * Main spline routing code.
  * The normalize parameter allows this function to be called by the
@@ -252,13 +437,15 @@ setEdgeLabelPos (graph_t * g)
  */
 static void _dot_splines(graph_t * g, int normalize)
 {
-    int i, j, k, n_nodes, n_edges, ind, cnt;
+    int i, j, k, n_nodes, n_edges, ind, cnt, ngrp;
     node_t *n;
     Agedgeinfo_t fwdedgeai, fwdedgebi;
     Agedgepair_t fwdedgea, fwdedgeb;
     edge_t *e, *e0, *e1, *ea, *eb, *le0, *le1, **edges = NULL;
     path *P = NULL;
     spline_info_t sd;
+    edgegroup_t *grp = NULL;
+    int *base = NULL;
     int et = EDGE_TYPE(g);
     fwdedgea.out.base.data = (Agrec_t*)&fwdedgeai;
     fwdedgeb.out.base.data = (Agrec_t*)&fwdedgebi;
@@ -289,6 +476,7 @@ static void _dot_splines(graph_t * g, int normalize)
     /* FlatHeight = 2 * GD_nodesep(g); */
     sd.Splinesep = GD_nodesep(g) / 4;
     sd.Multisep = GD_nodesep(g);
+    sd.Sinfo = &sinfo;
     edges = N_NEW(CHUNK, edge_t *);
 
     /* compute boundaries and list of splines */
@@ -367,6 +555,24 @@ static void _dot_splines(graph_t * g, int normalize)
     P->boxes = N_NEW(n_nodes + 20 * 2 * NSUB, boxf);
     sd.Rank_box = N_NEW(i, boxf);
 
+#ifdef _OPENMP
+    /* Regular edges are routed concurrently unless they may be merged,
+     * when the groups of a merged edge add to the same spline.
+     */
+    if (omp_get_max_threads() > 1 && et != ET_CURVED && !Concentrate) {
+	grp = N_NEW(n_edges, edgegroup_t);
+	base = N_NEW(GD_maxrank(g) + 1, int);
+	for (i = GD_minrank(g), j = 0; i <= GD_maxrank(g); i++) {
+	    base[i] = j;
+	    j += GD_rank(g)[i].n;
+	    /* fill the cache of rank boxes before it is shared */
+	    if (i < GD_maxrank(g))
+		rank_box(&sd, g, i);
+	}
+    }
+#endif
+    ngrp = 0;
+
     if (et == ET_LINE) {
     /* place regular edge labels */
 	for (n = GD_nlist(g); n; n = ND_next(n)) {
@@ -412,6 +618,17 @@ static void _dot_splines(graph_t * g, int normalize)
 		break;
 	}
 
+	if (grp && agtail(e0) != aghead(e0)
+	    && ND_rank(agtail(e0)) != ND_rank(aghead(e0))) {
+	    grp[ngrp].ind = ind;
+	    grp[ngrp++].cnt = cnt;
+	    continue;
+	}
+	if (ngrp > 0) {
+	    route_regular_groups(g, &sd, edges, grp, ngrp, et, base, n_nodes);
+	    ngrp = 0;
+	}
+
 	if (et == ET_CURVED) {
 	    int ii;
 	    edge_t* e0;
@@ -458,6 +675,10 @@ static void _dot_splines(graph_t * g, int normalize)
 	else
 	    make_regular_edge(g, &sd, P, edges, ind, cnt, et);
     }
+    if (ngrp > 0)
+	route_regular_groups(g, &sd, edges, grp, ngrp, et, base, n_nodes);
+    free(grp);
+    free(base);
 
     /* place regular edge labels */
     for (n = GD_nlist(g); n; n = ND_next(n)) {
@@ -1741,6 +1962,9 @@ make_regular_edge(graph_t* g, spline_info_t* sp, path * P, edge_t ** edges, int
     static pointf* pointfs2;
     static int numpts;
     static int numpts2;
+#ifdef _OPENMP
+#pragma omp threadprivate(pointfs, pointfs2, numpts, numpts2)
+#endif
     int pointn;
 
     fwdedgea.out.base.data = (Agrec_t*)&fwdedgeai;
@@ -1911,7 +2135,7 @@ make_regular_edge(graph_t* g, spline_info_t* sp, path * P, edge_t ** edges, int
     /* make copies of the spline points, one per multi-edge */
 
     if (cnt == 1) {
-	clip_and_install(fe, hn, pointfs, pointn, &sinfo);
+	clip_and_install(fe, hn, pointfs, pointn, sp->Sinfo);
 	return;
     }
     dx = sp->Multisep * (cnt - 1) / 2;
@@ -1924,7 +2148,7 @@ make_regular_edge(graph_t* g, spline_info_t* sp, path * P, edge_t ** edges, int
     }
     for (i = 0; i < pointn; i++)
 	pointfs2[i] = pointfs[i];
-    clip_and_install(fe, hn, pointfs2, pointn, &sinfo);
+    clip_and_install(fe, hn, pointfs2, pointn, sp->Sinfo);
     for (j = 1; j < cnt; j++) {
 	e = edges[ind + j];
 	if (ED_tree_index(e) & BWDEDGE) {
@@ -1935,40 +2159,25 @@ make_regular_edge(graph_t* g, spline_info_t* sp, path * P, edge_t ** edges, int
 	    pointfs[i].x += sp->Multisep;
 	for (i = 0; i < pointn; i++)
 	    pointfs2[i] = pointfs[i];
-	clip_and_install(e, aghead(e), pointfs2, pointn, &sinfo);
+	clip_and_install(e, aghead(e), pointfs2, pointn, sp->Sinfo);
     }
 }
 
 /* regular edges */
 
-#define DONT_WANT_ANY_ENDPOINT_PATH_REFINEMENT
 #ifdef DONT_WANT_ANY_ENDPOINT_PATH_REFINEMENT
+/* completeregularpath:
+ * The splines of the neighboring edges of the same tail and head are not
+ * looked at: they were only checked to exist, which top_bound and bot_bound
+ * already ensure, and other threads may be routing them.
+ */
 static void
 completeregularpath(path * P, edge_t * first, edge_t * last,
 		    pathend_t * tendp, pathend_t * hendp, boxf * boxes,
 		    int boxn, int flag)
 {
-    edge_t *uleft, *uright, *lleft, *lright;
     int i, fb, lb;
-    splines *spl;
 
-    fb = lb = -1;
-    uleft = uright = NULL;
-    uleft = top_bound(first, -1), uright = top_bound(first, 1);
-    if (uleft) {
-	if (!(spl = getsplinepoints(uleft))) return;
-    }
-    if (uright) {
-	if (!(spl = getsplinepoints(uright))) return;
-    }
-    lleft = lright = NULL;
-    lleft = bot_bound(last, -1), lright = bot_bound(last, 1);
-    if (lleft) {
-	if (!(spl = getsplinepoints(lleft))) return;
-    }
-    if (lright) {
-	if (!(spl = getsplinepoints(lright))) return;
-    }
     for (i = 0; i < tendp->boxn; i++)
 	add_box(P, tendp->boxes[i]);
     fb = P->nbox + 1;
@@ -2298,6 +2507,7 @@ static void resize_vn(node_t *vn, int lx, int cx, int rx)
     ND_lw(vn) = cx - lx, ND_rw(vn) = rx - cx;
 }
 
+#ifndef DONT_WANT_ANY_ENDPOINT_PATH_REFINEMENT
 /* side > 0 means right. side < 0 means left */
 static edge_t *top_bound(edge_t * e, int side)
 {
@@ -2334,6 +2544,7 @@ static edge_t *bot_bound(edge_t * e, int side)
     }
     return ans;
 }
+#endif
 
 /* common routines */
 
@@ -263,7 +263,12 @@ void flat_edge(graph_t * g, edge_t * e)
 {
     elist_append(e, ND_flat_out(agtail(e)));
     elist_append(e, ND_flat_in(aghead(e)));
-    GD_has_flat_edges(dot_root(g)) = GD_has_flat_edges(g) = TRUE;
+    GD_has_flat_edges(g) = TRUE;
+    /* a component view of mincross_components is a copy of the root, so it
+     * is neither a root nor has a parent; views may be ordered concurrently,
+     * so merge_mccomp passes their flag on to the root instead */
+    if (agparent(g) || agroot(g) == g)
+	GD_has_flat_edges(dot_root(g)) = TRUE;
 }
 
 void delete_flat_edge(edge_t * e)
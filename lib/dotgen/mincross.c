@@ -37,7 +37,7 @@ static void flat_reorder(graph_t * g);
 static void flat_search(graph_t * g, node_t * v);
 static void init_mincross(graph_t * g);
 static void merge2(graph_t * g);
-static void init_mccomp(graph_t * g, int c);
+static int mincross_components(graph_t * g, int doBalance);
 static void cleanup2(graph_t * g, int nc);
 static int mincross_clust(graph_t * g, int);
 static int mincross(graph_t * g, int startpass, int endpass, int);
@@ -71,6 +71,14 @@ static int GlobalMinRank, GlobalMaxRank;
 static edge_t **TE_list;
 static int *TI_list;
 static boolean ReMincross;
+static int *Count, C;		/* work space of rcross */
+#ifdef _OPENMP
+/* connected components are ordered concurrently, each by its own thread */
+#pragma omp threadprivate(Root, TI_list, Count, C)
+#endif
+
+/* components are ordered in batches of at most this many ranks */
+#define MC_BATCH_RANKS (1 << 16)
 
 #if defined(DEBUG) && DEBUG > 1
 static void indent(graph_t* g)
@@ -355,10 +363,7 @@ void dot_mincross(graph_t * g, int doBalance)
 
     init_mincross(g);
 
-    for (nc = c = 0; c < GD_comp(g).size; c++) {
-	init_mccomp(g, c);
-	nc += mincross(g, 0, 2, doBalance);
-    }
+    nc = mincross_components(g, doBalance);
 
     merge2(g);
 
@@ -402,17 +407,129 @@ static void free_matrix(adjmatrix_t * p)
 
 #define ELT(M,i,j)		(M->data[((i)*M->ncols)+(j)])
 
-static void init_mccomp(graph_t * g, int c)
+/* A view of the root graph for ordering one of its connected components:
+ * copies of the graph and its Agraphinfo_t, whose rank arrays cover just
+ * the component's slice of the ranks of the root.  The components of a
+ * graph share no nodes or edges, so their views can be ordered concurrently.
+ *
+ * The copy of the Agraph_t shares the dictionaries, closure and records of
+ * the root, and cdt dictionaries reorganize themselves even on searches, so
+ * mincross on a view may only make these cgraph calls:
+ *  - agcontains, through contains, which serializes it
+ *  - agerr, which serializes itself
+ *  - agparent, agraphof, agroot, agtail and aghead, which only read fields
+ * Everything else goes through the ND_, ED_ and GD_ fields. A view is not
+ * a root and has no parent, which flat_edge uses to leave the root's flag
+ * to merge_mccomp.
+ */
+typedef struct {
+    Agraph_t graph;
+    Agraphinfo_t info;
+} mccomp_t;
+
+/* init_mccomp:
+ * Set up the view of the component nlist of g. Its slice of rank r starts
+ * at offset[r], which is advanced past it for the next component.
+ */
+static void init_mccomp(graph_t * g, mccomp_t * mc, node_t * nlist, int *offset)
 {
     int r;
+    node_t *n;
+    rank_t *rank;
 
-    GD_nlist(g) = GD_comp(g).list[c];
-    if (c > 0) {
-	for (r = GD_minrank(g); r <= GD_maxrank(g); r++) {
-	    GD_rank(g)[r].v = GD_rank(g)[r].v + GD_rank(g)[r].n;
-	    GD_rank(g)[r].n = 0;
+    rank = N_NEW(GD_maxrank(g) + 2, rank_t);
+    memcpy(rank, GD_rank(g), (GD_maxrank(g) + 2) * sizeof(rank_t));
+    for (r = GD_minrank(g); r <= GD_maxrank(g); r++) {
+	rank[r].v = rank[r].av + offset[r];
+	rank[r].n = 0;
+	rank[r].valid = FALSE;
+	rank[r].flat = NULL;
+    }
+    mc->graph = *g;
+    mc->info = *(Agraphinfo_t *) AGDATA(g);
+    AGDATA(&mc->graph) = (Agrec_t *) & mc->info;
+    GD_rank(&mc->graph) = rank;
+    GD_nlist(&mc->graph) = nlist;
+    for (n = nlist; n; n = ND_next(n))
+	offset[ND_rank(n)]++;
+}
+
+/* merge_mccomp:
+ * Carry the rank state of a component's view over to g, as if the component
+ * had been ordered in g itself, and free the view.
+ */
+static void merge_mccomp(graph_t * g, mccomp_t * mc)
+{
+    int r;
+    rank_t *rank = GD_rank(&mc->graph);
+
+    for (r = GD_minrank(g); r <= GD_maxrank(g); r++) {
+	assert(rank[r].v + rank[r].n <= rank[r].av + rank[r].an);
+	if (rank[r].flat) {
+	    free_matrix(GD_rank(g)[r].flat);
+	    GD_rank(g)[r].flat = rank[r].flat;
+	}
+	GD_rank(g)[r].candidate = rank[r].candidate;
+	GD_rank(g)[r].valid = rank[r].valid;
+	GD_rank(g)[r].cache_nc = rank[r].cache_nc;
+    }
+    if (GD_has_flat_edges(&mc->graph))
+	GD_has_flat_edges(g) = TRUE;
+    free(rank);
+}
+
+/* mincross_components:
+ * Run mincross on each connected component of g, returning the total
+ * number of crossings. With OpenMP, the components of a batch are ordered
+ * in parallel; the result does not depend on the number of threads.
+ */
+static int mincross_components(graph_t * g, int doBalance)
+{
+    int c, c0, c1, batch, nc = 0;
+    int ncomp = GD_comp(g).size;
+    int tsize = agnedges(dot_root(g)) + 1;
+    int *offset;
+    mccomp_t *mc;
+
+    batch = MAX(1, MC_BATCH_RANKS / (GD_maxrank(g) + 2));
+    batch = MIN(batch, ncomp);
+    mc = N_NEW(batch, mccomp_t);
+    offset = N_NEW(GD_maxrank(g) + 2, int);
+    for (c0 = 0; c0 < ncomp; c0 += batch) {
+	c1 = MIN(ncomp, c0 + batch);
+	for (c = c0; c < c1; c++)
+	    init_mccomp(g, &mc[c - c0], GD_comp(g).list[c], offset);
+#ifdef _OPENMP
+#pragma omp parallel if (c1 - c0 > 1) reduction(+:nc)
+#endif
+	{
+	    /* threads other than the initial one need work space of their own */
+	    boolean own = (TI_list == NULL);
+
+	    if (own)
+		TI_list = N_NEW(tsize, int);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+	    for (c = c0; c < c1; c++) {
+		Root = &mc[c - c0].graph;
+		nc += mincross(Root, 0, 2, doBalance);
+	    }
+	    if (own) {
+		free(TI_list);
+		TI_list = NULL;
+		free(Count);
+		Count = NULL;
+		C = 0;
+	    }
 	}
+	for (c = c0; c < c1; c++)
+	    merge_mccomp(g, &mc[c - c0]);
     }
+    Root = g;
+    free(offset);
+    free(mc);
+    return nc;
 }
 
 static int betweenclust(edge_t * e)
@@ -576,11 +693,76 @@ static int left2right(graph_t * g, node_t * v, node_t * w)
     return rv;
 }
 
+/* Crossings between the edges of two neighboring nodes are counted pair by
+ * pair when that is cheap; for nodes of high degree, by sorting the other
+ * ends of their edges and merging, in O(d log d) instead of O(d^2).
+ */
+#define MERGE_CROSS(n1, n2)	((n1) * (n2) > 16 * ((n1) + (n2)))
+
+typedef struct {
+    int order;			/* of the node at the other end */
+    double x;			/* of the port at the other end */
+    int xpenalty;
+} endpoint_t;
+
+static int endpointcmpf(const void *p0, const void *p1)
+{
+    const endpoint_t *a = p0, *b = p1;
+
+    if (a->order != b->order)
+	return a->order < b->order ? -1 : 1;
+    if (a->x != b->x)
+	return a->x < b->x ? -1 : 1;
+    return 0;
+}
+
+/* endpoints:
+ * The other ends of the edges in list, in left to right order.
+ */
+static endpoint_t *endpoints(edge_t ** list, int n, boolean in)
+{
+    endpoint_t *ep = N_NEW(n, endpoint_t);
+    int i;
+
+    for (i = 0; i < n; i++) {
+	edge_t *e = list[i];
+	ep[i].order = ND_order(in ? agtail(e) : aghead(e));
+	ep[i].x = (in ? ED_tail_port(e) : ED_head_port(e)).p.x;
+	ep[i].xpenalty = ED_xpenalty(e);
+    }
+    qsort(ep, n, sizeof(endpoint_t), endpointcmpf);
+    return ep;
+}
+
+/* merge_cross:
+ * The number of crossings, weighted by xpenalty, of the edges of v with
+ * those of w when v is left of w: the pairs of edges whose other end is
+ * further right for v than for w.
+ */
+static int merge_cross(edge_t ** lv, int nv, edge_t ** lw, int nw, boolean in)
+{
+    endpoint_t *a = endpoints(lv, nv, in);
+    endpoint_t *b = endpoints(lw, nw, in);
+    int i, j = 0, wsum = 0, cross = 0;
+
+    for (i = 0; i < nv; i++) {
+	while (j < nw && endpointcmpf(&b[j], &a[i]) < 0)
+	    wsum += b[j++].xpenalty;
+	cross += a[i].xpenalty * wsum;
+    }
+    free(a);
+    free(b);
+    return cross;
+}
+
 static int in_cross(node_t * v, node_t * w)
 {
     edge_t **e1, **e2;
     int inv, cross = 0, t;
 
+    if (MERGE_CROSS(ND_in(v).size, ND_in(w).size))
+	return merge_cross(ND_in(v).list, ND_in(v).size,
+			   ND_in(w).list, ND_in(w).size, TRUE);
     for (e2 = ND_in(w).list; *e2; e2++) {
 	int cnt = ED_xpenalty(*e2);		
 		
@@ -600,6 +782,9 @@ static int out_cross(node_t * v, node_t * w)
     edge_t **e1, **e2;
     int inv, cross = 0, t;
 
+    if (MERGE_CROSS(ND_out(v).size, ND_out(w).size))
+	return merge_cross(ND_out(v).list, ND_out(v).size,
+			   ND_out(w).list, ND_out(w).size, FALSE);
     for (e2 = ND_out(w).list; *e2; e2++) {
 	int cnt = ED_xpenalty(*e2);
 	inv = ND_order(aghead(*e2));
@@ -831,7 +1016,7 @@ static int mincross(graph_t * g, int startpass, int endpass, int doBalance)
     for (pass = startpass; pass <= endpass; pass++) {
 	if (pass <= 1) {
 	    maxthispass = MIN(4, MaxIter);
-	    if (g == dot_root(g))
+	    if (g == Root)
 		build_ranks(g, pass);
 	    if (pass == 0)
 		flat_breakcycles(g);
@@ -1024,9 +1209,23 @@ assert((rv == 0) || (ND_order(rv)-ND_order(v))*dir > 0);
     return rv;
 }
 
+/* agcontains looks obj up in dictionaries that reorganize themselves on
+ * search, so threads ordering different components must take turns.
+ */
+static int contains(graph_t * g, void *obj)
+{
+    int rv;
+
+#ifdef _OPENMP
+#pragma omp critical(mincross_contains)
+#endif
+    rv = agcontains(g, obj);
+    return rv;
+}
+
 static int is_a_normal_node_of(graph_t * g, node_t * v)
 {
-    return ND_node_type(v) == NORMAL && agcontains(g, v);
+    return ND_node_type(v) == NORMAL && contains(g, v);
 }
 
 static int is_a_vnode_of_an_edge_of(graph_t * g, node_t * v)
@@ -1036,7 +1235,7 @@ static int is_a_vnode_of_an_edge_of(graph_t * g, node_t * v)
 	edge_t *e = ND_out(v).list[0];
 	while (ED_edge_type(e) != NORMAL)
 	    e = ED_to_orig(e);
-	if (agcontains(g, e))
+	if (contains(g, e))
 	    return TRUE;
     }
     return FALSE;
@@ -1231,7 +1430,7 @@ static void flat_search(graph_t * g, node_t * v)
     if (ND_flat_out(v).list)
 	for (i = 0; (e = ND_flat_out(v).list[i]); i++) {
 	    if (hascl
-		&& NOT(agcontains(g, agtail(e)) && agcontains(g, aghead(e))))
+		&& NOT(contains(g, agtail(e)) && contains(g, aghead(e))))
 		continue;
 	    if (ED_weight(e) == 0)
 		continue;
@@ -1421,7 +1620,7 @@ void build_ranks(graph_t * g, int pass)
 	}
     }
 
-    if (g == dot_root(g) && ncross(g) > 0)
+    if (g == Root && ncross(g) > 0)
 	transpose(g, FALSE);
     free_queue(q);
 }
@@ -1672,37 +1871,47 @@ static int local_cross(elist l, int dir)
     return cross;
 }
 
+/* rcross:
+ * Crossings between ranks r and r+1, weighted by xpenalty. Going through
+ * the top nodes from left to right, each edge crosses the edges of the
+ * nodes already seen whose heads are further right. Those are counted with
+ * an accumulator (Fenwick) tree over the positions of rank r+1, as in
+ * Barth, Juenger and Mutzel's bilayer cross counting, so this takes
+ * O(E log V) instead of O(E V).
+ */
 static int rcross(graph_t * g, int r)
 {
-    static int *Count, C;
-    int top, bot, cross, max, i, k;
+    int top, bot, cross, total, i, k, n;
     node_t **rtop, *v;
 
     cross = 0;
-    max = 0;
+    total = 0;
     rtop = GD_rank(g)[r].v;
+    n = GD_rank(g)[r + 1].n;
 
     if (C <= GD_rank(Root)[r + 1].n) {
 	C = GD_rank(Root)[r + 1].n + 1;
 	Count = ALLOC(C, Count, int);
     }
 
-    for (i = 0; i < GD_rank(g)[r + 1].n; i++)
+    /* Count[k] sums the xpenalty of the heads at positions k-(k&-k)..k-1 */
+    for (i = 0; i <= n; i++)
 	Count[i] = 0;
 
     for (top = 0; top < GD_rank(g)[r].n; top++) {
 	edge_t *e;
-	if (max > 0) {
+	if (total > 0) {
 	    for (i = 0; (e = ND_out(rtop[top]).list[i]); i++) {
-		for (k = ND_order(aghead(e)) + 1; k <= max; k++)
-		    cross += Count[k] * ED_xpenalty(e);
+		int left = 0;
+		for (k = ND_order(aghead(e)) + 1; k > 0; k -= k & -k)
+		    left += Count[k];
+		cross += (total - left) * ED_xpenalty(e);
 	    }
 	}
 	for (i = 0; (e = ND_out(rtop[top]).list[i]); i++) {
-	    int inv = ND_order(aghead(e));
-	    if (inv > max)
-		max = inv;
-	    Count[inv] += ED_xpenalty(e);
+	    for (k = ND_order(aghead(e)) + 1; k <= n; k += k & -k)
+		Count[k] += ED_xpenalty(e);
+	    total += ED_xpenalty(e);
 	}
     }
     for (top = 0; top < GD_rank(g)[r].n; top++) {
@@ -128,7 +128,8 @@ void dot_position(graph_t * g, aspect_t* asp)
     create_aux_edges(g);
     if (rank(g, 2, nsiter2(g))) { /* LR balance == 2 */
 	connectGraph (g);
-	const int rank_result = rank(g, 2, nsiter2(g));
+	/* keep the ranks and partial tree of the failed attempt */
+	const int rank_result = rank_warm(g, 2, nsiter2(g));
 	assert(rank_result == 0);
     }
     set_xcoords(g);
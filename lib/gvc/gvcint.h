@@ -93,6 +93,9 @@ extern "C" {
 	Dtdisc_t textfont_disc;
 	Dt_t *textfont_dt;
 	gvplugin_active_textlayout_t textlayout; /* always use best avail for all jobs */
+
+	/* layout data kept by distcache_put */
+	struct distcache_s *distcache;
 //	void (*free_layout) (void *layout);   /* function for freeing layouts (mostly used by pango) */
 	
 /* FIXME - everything below should probably move to GVG_t */
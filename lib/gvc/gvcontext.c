@@ -34,6 +34,9 @@ extern void *zmalloc(size_t);
 /* from common/textspan.c */
 extern void textfont_dict_close(GVC_t *gvc);
 
+/* from common/distcache.c */
+extern void distcache_close(GVC_t *gvc);
+
 /* from common/emit.c */
 extern void emit_once_reset(void);
 
@@ -95,6 +98,7 @@ int gvFreeContext(GVC_t * gvc)
     free(gvc->config_path);
     free(gvc->input_filenames);
     textfont_dict_close(gvc);
+    distcache_close(gvc);
     for (i = 0; i != num_apis; ++i) {
 	for (api = gvc->apis[i]; api != NULL; api = api_next) {
 	    api_next = api->next;
@@ -121,6 +125,7 @@ GVC_t* gvCloneGVC (GVC_t * gvc0)
 void gvFreeCloneGVC (GVC_t * gvc)
 {
     gvjobs_delete(gvc);
+    distcache_close(gvc);
     free(gvc);
 }
 
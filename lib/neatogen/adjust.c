@@ -701,7 +701,7 @@ double *getSizes(Agraph_t * g, pointf pad, int* n_elabels, int** elabels)
 SparseMatrix makeMatrix(Agraph_t* g, int dim, SparseMatrix *D)
 {
     SparseMatrix A = 0;
-    Agnode_t *n;
+    Agcsr_t *csr;
     Agedge_t *e;
     Agsym_t *sym;
     int nnodes;
@@ -717,13 +717,13 @@ SparseMatrix makeMatrix(Agraph_t* g, int dim, SparseMatrix *D)
 
     if (!g)
 	return NULL;
-    nnodes = agnnodes(g);
-    nedges = agnedges(g);
+    csr = agcsr(g);
+    nnodes = csr->nnodes;
+    nedges = csr->nedges;
 
     /* Assign node ids */
-    i = 0;
-    for (n = agfstnode(g); n; n = agnxtnode(g, n))
-	ND_id(n) = i++;
+    for (i = 0; i < nnodes; i++)
+	ND_id(csr->nodes[i]) = i;
 
     I = N_GNEW(nedges, int);
     J = N_GNEW(nedges, int);
@@ -735,12 +735,11 @@ SparseMatrix makeMatrix(Agraph_t* g, int dim, SparseMatrix *D)
 	valD = N_NEW(nedges, real);
     }
 
-    i = 0;
-    for (n = agfstnode(g); n; n = agnxtnode(g, n)) {
-	row = ND_id(n);
-	for (e = agfstout(g, n); e; e = agnxtout(g, e)) {
+    for (row = 0; row < nnodes; row++) {
+	for (i = csr->out_start[row]; i < csr->out_start[row+1]; i++) {
+	    e = csr->out_edge[i];
 	    I[i] = row;
-	    J[i] = ND_id(aghead(e));
+	    J[i] = csr->out_node[i];
 	    if (!sym || (sscanf(agxget(e, sym), "%lf", &v) != 1))
 		v = 1;
 	    val[i] = v;
@@ -749,7 +748,6 @@ SparseMatrix makeMatrix(Agraph_t* g, int dim, SparseMatrix *D)
 		if (sscanf (agxget (e, symD), "%lf", &v) != 1) v = 1;
 		valD[i] = v;
 	    }
-	    i++;
 	}
     }
 
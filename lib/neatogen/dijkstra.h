@@ -18,25 +18,30 @@ extern "C" {
 #define _DIJKSTRA_H_
 
 #include <neatogen/defs.h>
+#include <neatogen/bfs.h>
+#include <neatogen/pqueue.h>
 #include <neatogen/sgd.h>
 
 #ifdef __cplusplus
-    void dijkstra(int vertex, vtx_data * graph, int n, DistType * dist);
+    void dijkstra(int vertex, vtx_data * graph, int n, DistType * dist,
+		  PQueue * pq);
 
 /* Dijkstra bounded to nodes in *unweighted* radius */
     void dijkstra_bounded(int vertex, vtx_data * graph, int n,
-			  DistType * dist, int bound, int *visited_nodes,
-			  int &num_visited_nodes);
+			  DistType * dist, Queue & Q, PQueue * pq, int bound,
+			  int *visited_nodes, int &num_visited_nodes);
 
 #else
-    extern void dijkstra(int, vtx_data *, int, DistType *);
-    extern void dijkstra_f(int, vtx_data *, int, float *);
+    /* The PQueue is made with mkPQueue(pq, n) and reused for every source */
+    extern void dijkstra(int, vtx_data *, int, DistType *, PQueue *);
+    extern void dijkstra_f(int, vtx_data *, int, float *, PQueue *);
 
     /* Dijkstra bounded to nodes in *unweighted* radius */
-    extern int dijkstra_bounded(int, vtx_data *, int, DistType *, int,
-				int *);
+    extern int dijkstra_bounded(int, vtx_data *, int, DistType *, Queue *,
+				PQueue *, int, int *);
 #endif
-    extern int dijkstra_sgd(graph_sgd *, int, term_sgd *);
+    extern int dijkstra_sgd(graph_sgd *, int, term_sgd *, float *, PQueue *);
+    extern void dijkstra_sgd_dist(graph_sgd *, int, float *, PQueue *);
 
 #endif
 
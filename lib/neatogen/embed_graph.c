@@ -43,6 +43,7 @@ void embed_graph(vtx_data * graph, int n, int dim, DistType *** Coords,
 						   each nodes to the selected "pivots" */
     float *old_weights = graph[0].ewgts;
     Queue Q;
+    PQueue pq;
     DistType max_dist = 0;
 
     if (coords != NULL) {
@@ -63,8 +64,9 @@ void embed_graph(vtx_data * graph, int n, int dim, DistType *** Coords,
     node = rand() % n;
 
     mkQueue(&Q, n);
+    mkPQueue(&pq, n);
     if (reweight_graph) {
-	dijkstra(node, graph, n, coords[0]);
+	dijkstra(node, graph, n, coords[0], &pq);
     } else {
 	bfs(node, graph, n, coords[0], &Q);
     }
@@ -80,7 +82,7 @@ void embed_graph(vtx_data * graph, int n, int dim, DistType *** Coords,
     /* select other dim-1 nodes as pivots */
     for (i = 1; i < dim; i++) {
 	if (reweight_graph) {
-	    dijkstra(node, graph, n, coords[i]);
+	    dijkstra(node, graph, n, coords[i], &pq);
 	} else {
 	    bfs(node, graph, n, coords[i], &Q);
 	}
@@ -96,6 +98,7 @@ void embed_graph(vtx_data * graph, int n, int dim, DistType *** Coords,
     }
 
     free(dist);
+    freePQueue(&pq);
 
     if (reweight_graph) {
 	restore_old_weights(graph, n, old_weights);
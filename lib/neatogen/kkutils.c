@@ -58,15 +58,18 @@ static DistType **compute_apsp_dijkstra(vtx_data * graph, int n)
     int i;
     DistType *storage;
     DistType **dij;
+    PQueue pq;
 
     storage = N_GNEW(n * n, DistType);
     dij = N_GNEW(n, DistType *);
     for (i = 0; i < n; i++)
 	dij[i] = storage + i * n;
 
+    mkPQueue(&pq, n);
     for (i = 0; i < n; i++) {
-	dijkstra(i, graph, n, dij[i]);
+	dijkstra(i, graph, n, dij[i], &pq);
     }
+    freePQueue(&pq);
     return dij;
 }
 
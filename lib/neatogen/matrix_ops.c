@@ -14,6 +14,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 static double p_iteration_threshold = 1e-3;
 
@@ -504,29 +507,139 @@ void orthog1f(int n, float *vec)
     }
 }
 
-/* inline */
-void right_mult_with_vector_ff
-    (float *packed_matrix, int n, float *vector, float *result) {
-    /* packed matrix is the upper-triangular part of a symmetric matrix arranged in a vector row-wise */
-    int i, j, index;
-    float vector_i;
+/* Below this order, packed matrix-vector products are computed serially. */
+#define MV_PARALLEL_SIZE 1000
+
+/* packed_mv_rows:
+ * Set result[lo..hi-1] to the same entries of packed_matrix*vector,
+ * where packed_matrix is the upper-triangular part of a symmetric matrix
+ * arranged in a vector row-wise.
+ * Every entry gets the same terms, added in the same order, as in a
+ * single pass over all rows, so the product does not depend on how the
+ * rows are split. Rows above lo only contribute their entries in columns
+ * lo..hi-1. The rows from lo are done four at a time, which gives four
+ * independent running sums instead of one.
+ */
+static void
+packed_mv_rows(float *packed_matrix, int n, float *vector, float *result,
+	       int lo, int hi)
+{
+    float *row = packed_matrix;	/* diagonal entry of row i */
+    float *a0, *a1, *a2, *a3;
+    float x0, x1, x2, x3, xj;
+    float res0, res1, res2, res3;
+    int i, j;
 
-    float res;
-    for (i = 0; i < n; i++) {
+    for (i = lo; i < hi; i++) {
 	result[i] = 0;
     }
-    for (index = 0, i = 0; i < n; i++) {
-	res = 0;
-	vector_i = vector[i];
-	/* deal with main diag */
-	res += packed_matrix[index++] * vector_i;
-	/* deal with off diag */
-	for (j = i + 1; j < n; j++, index++) {
-	    res += packed_matrix[index] * vector[j];
-	    result[j] += packed_matrix[index] * vector_i;
+
+    /* rows above the block: the entry of row i in column j is row[j - i] */
+    for (i = 0; i < lo; row += n - i, i++) {
+	x0 = vector[i];
+	for (j = lo; j < hi; j++) {
+	    result[j] += row[j - i] * x0;
 	}
-	result[i] += res;
     }
+
+    /* rows of the block, four at a time */
+    for (; i + 4 <= hi; i += 4) {
+	/* ak[j] is the entry of row i+k in column j */
+	a0 = row - i;
+	a1 = a0 + (n - i) - 1;
+	a2 = a1 + (n - i - 1) - 1;
+	a3 = a2 + (n - i - 2) - 1;
+	row = a3 + (n - i - 3) + i + 3;
+	x0 = vector[i];
+	x1 = vector[i + 1];
+	x2 = vector[i + 2];
+	x3 = vector[i + 3];
+
+	/* the 4x4 triangle on the diagonal */
+	res0 = 0;
+	res0 += a0[i] * x0;
+	res0 += a0[i + 1] * x1;
+	result[i + 1] += a0[i + 1] * x0;
+	res1 = 0;
+	res1 += a1[i + 1] * x1;
+	res0 += a0[i + 2] * x2;
+	result[i + 2] += a0[i + 2] * x0;
+	res1 += a1[i + 2] * x2;
+	result[i + 2] += a1[i + 2] * x1;
+	res2 = 0;
+	res2 += a2[i + 2] * x2;
+	res0 += a0[i + 3] * x3;
+	result[i + 3] += a0[i + 3] * x0;
+	res1 += a1[i + 3] * x3;
+	result[i + 3] += a1[i + 3] * x1;
+	res2 += a2[i + 3] * x3;
+	result[i + 3] += a2[i + 3] * x2;
+	res3 = 0;
+	res3 += a3[i + 3] * x3;
+
+	/* columns to the right of the triangle */
+	for (j = i + 4; j < hi; j++) {
+	    xj = vector[j];
+	    res0 += a0[j] * xj;
+	    res1 += a1[j] * xj;
+	    res2 += a2[j] * xj;
+	    res3 += a3[j] * xj;
+	    result[j] += a0[j] * x0;
+	    result[j] += a1[j] * x1;
+	    result[j] += a2[j] * x2;
+	    result[j] += a3[j] * x3;
+	}
+	for (; j < n; j++) {
+	    xj = vector[j];
+	    res0 += a0[j] * xj;
+	    res1 += a1[j] * xj;
+	    res2 += a2[j] * xj;
+	    res3 += a3[j] * xj;
+	}
+	result[i] += res0;
+	result[i + 1] += res1;
+	result[i + 2] += res2;
+	result[i + 3] += res3;
+    }
+
+    /* remaining rows of the block */
+    for (; i < hi; row += n - i, i++) {
+	a0 = row - i;
+	x0 = vector[i];
+	res0 = 0;
+	res0 += a0[i] * x0;
+	for (j = i + 1; j < hi; j++) {
+	    res0 += a0[j] * vector[j];
+	    result[j] += a0[j] * x0;
+	}
+	for (; j < n; j++) {
+	    res0 += a0[j] * vector[j];
+	}
+	result[i] += res0;
+    }
+}
+
+/* right_mult_with_vector_ff:
+ * With OpenMP and a large matrix, each thread computes a contiguous
+ * block of the result. Entries off the diagonal blocks are then read by
+ * two threads, but no thread writes to another's block, and the result
+ * is the same as when computed serially.
+ */
+void right_mult_with_vector_ff
+    (float *packed_matrix, int n, float *vector, float *result) {
+    /* packed matrix is the upper-triangular part of a symmetric matrix arranged in a vector row-wise */
+#ifdef _OPENMP
+#pragma omp parallel if (n >= MV_PARALLEL_SIZE)
+    {
+	int nblocks = omp_get_num_threads();
+	int b = omp_get_thread_num();
+	packed_mv_rows(packed_matrix, n, vector, result,
+		       (int) ((double) n * b / nblocks),
+		       (int) ((double) n * (b + 1) / nblocks));
+    }
+#else
+    packed_mv_rows(packed_matrix, n, vector, result, 0, n);
+#endif
 }
 
 /* inline */
@@ -663,6 +663,8 @@ static int neatoMode(graph_t * g)
 	    mode = MODE_MAJOR;
 	else if (streq(str, "sgd"))
 		mode = MODE_SGD;
+	else if (streq(str, "sparsesgd"))
+		mode = MODE_SPARSE_SGD;
 #ifdef DIGCOLA
 	else if (streq(str, "hier"))
 	    mode = MODE_HIER;
@@ -769,6 +771,8 @@ acyclic (vtx_data* graph, int nv, int mode, node_t* nodes[])
  * of the first one encountered is used. Finally, a pass is made to guarantee
  * the graph is acyclic.
  *
+ * The adjacency is read from the graph's agcsr snapshot, which lists
+ * the same edges in the same order as agfstedge/agnxtedge.
  */
 static vtx_data *makeGraphData(graph_t * g, int nv, int *nedges, int mode, int model, node_t*** nodedata)
 {
@@ -787,7 +791,8 @@ static vtx_data *makeGraphData(graph_t * g, int nv, int *nedges, int mode, int m
     int haveWt;
     int haveDir;
     PointMap *ps = newPM();
-    int i, i_nedges, idx;
+    Agcsr_t *csr = agcsr(g);
+    int i, i_nedges, idx, k, nout, deg;
 
     /* lengths and weights unused in reweight model */
     if (model == MODEL_SUBSET) {
@@ -814,10 +819,11 @@ static vtx_data *makeGraphData(graph_t * g, int nv, int *nedges, int mode, int m
 	edists = N_GNEW(2*ne+nv,float);
 #endif
 
-    i = 0;
+    assert(csr->nnodes == nv);
     ne = 0;
-    for (np = agfstnode(g); np; np = agnxtnode(g, np)) {
+    for (i = 0; i < nv; i++) {
 	int j = 1;		/* index of neighbors */
+	np = csr->nodes[i];
 	clearPM(ps);
 	assert(ND_id(np) == i);
 	nodes[i] = np;
@@ -839,7 +845,14 @@ static vtx_data *makeGraphData(graph_t * g, int nv, int *nedges, int mode, int m
 #endif
 	i_nedges = 1;		/* one for the self */
 
-	for (ep = agfstedge(g, np); ep; ep = agnxtedge(g, ep, np)) {
+	/* out-edges, then in-edges, as agfstedge/agnxtedge would */
+	nout = csr->out_start[i+1] - csr->out_start[i];
+	deg = nout + csr->in_start[i+1] - csr->in_start[i];
+	for (k = 0; k < deg; k++) {
+	    if (k < nout)
+		ep = csr->out_edge[csr->out_start[i] + k];
+	    else
+		ep = csr->in_edge[csr->in_start[i] + k - nout];
 	    if (aghead(ep) == agtail(ep))
 		continue;	/* ignore loops */
 	    idx = checkEdge(ps, ep, j);
@@ -881,7 +894,6 @@ static vtx_data *makeGraphData(graph_t * g, int nv, int *nedges, int mode, int m
 #ifdef USE_STYLES
 	graph[i].styles = NULL;
 #endif
-	i++;
     }
 #ifdef DIGCOLA
     if (haveDir) {
@@ -1117,6 +1129,32 @@ void dumpOpts (ipsep_options* opp, int nv)
 }
 #endif
 
+/* majorFinish:
+ * Store the result of majorization back in the nodes and free
+ * the working data.
+ */
+static void
+majorFinish(graph_t * g, int rv, double **coords, vtx_data * gp,
+	    node_t ** nodes)
+{
+    node_t *v;
+
+    if (rv < 0) {
+	agerr(AGPREV, "layout aborted\n");
+    }
+    else for (v = agfstnode(g); v; v = agnxtnode(g, v)) { /* store positions back in nodes */
+	int idx = ND_id(v);
+	int i;
+	for (i = 0; i < Ndim; i++) {
+	    ND_pos(v)[i] = coords[i][idx];
+	}
+    }
+    freeGraphData(gp);
+    free(coords[0]);
+    free(coords);
+    free(nodes);
+}
+
 /* majorization:
  * Solve stress using majorization.
  * Old neato attributes to incorporate:
@@ -1129,11 +1167,11 @@ majorization(graph_t *mg, graph_t * g, int nv, int mode, int model, int dim, int
     double **coords;
     int ne;
     int i, rv = 0;
-    node_t *v;
     vtx_data *gp;
     node_t** nodes;
 #ifdef DIGCOLA
 #ifdef IPSEPCOLA
+    node_t *v;
     expand_t margin;
 #endif
 #endif
@@ -1246,20 +1284,7 @@ majorization(graph_t *mg, graph_t * g, int nv, int mode, int model, int dim, int
 #endif
 	rv = stress_majorization_kD_mkernel(gp, nv, ne, coords, nodes, Ndim, opts, model, MaxIter);
 
-    if (rv < 0) {
-	agerr(AGPREV, "layout aborted\n");
-    }
-    else for (v = agfstnode(g); v; v = agnxtnode(g, v)) { /* store positions back in nodes */
-	int idx = ND_id(v);
-	int i;
-	for (i = 0; i < Ndim; i++) {
-	    ND_pos(v)[i] = coords[i][idx];
-	}
-    }
-    freeGraphData(gp);
-    free(coords[0]);
-    free(coords);
-    free(nodes);
+    majorFinish(g, rv, coords, gp, nodes);
 }
 
 static void subset_model(Agraph_t * G, int nG)
@@ -1349,7 +1374,7 @@ neatoLayout(Agraph_t * mg, Agraph_t * g, int layoutMode, int layoutModel,
 	MaxIter = atoi(str);
     else if (layoutMode == MODE_MAJOR)
 	MaxIter = DFLT_ITERATIONS;
-    else if (layoutMode == MODE_SGD)
+    else if (layoutMode == MODE_SGD || layoutMode == MODE_SPARSE_SGD)
 	MaxIter = 30;
     else
 	MaxIter = 100 * agnnodes(g);
@@ -1359,8 +1384,8 @@ neatoLayout(Agraph_t * mg, Agraph_t * g, int layoutMode, int layoutModel,
 	return;
     if (layoutMode == MODE_KK)
 	kkNeato(g, nG, layoutModel);
-    else if (layoutMode == MODE_SGD)
-	sgd(g, layoutModel);
+    else if (layoutMode == MODE_SGD || layoutMode == MODE_SPARSE_SGD)
+	sgd(g, layoutModel, layoutMode == MODE_SPARSE_SGD);
     else
 	majorization(mg, g, nG, layoutMode, layoutModel, Ndim, MaxIter, am);
 }
@@ -1407,6 +1432,107 @@ static void doEdges(Agraph_t* g)
     spline_edges0(g, TRUE);
 }
 
+/* Laying out components concurrently.
+ * With the default stress majorization, nearly all the time for a
+ * component goes into the iterations of stress_kD_solve, which only
+ * touch arrays private to the component. Components are therefore
+ * processed in batches: everything that reads the graph or global
+ * state (attributes, the random start, the distance matrix) is done
+ * serially in stress_kD_setup; the solves of the batch then run in
+ * parallel when built with OpenMP; finally positions are stored and
+ * overlaps and edges handled serially, in component order.
+ * checkStart reseeds the random number generator for each component,
+ * and batches do not depend on the number of threads, so the layout
+ * is the same however many threads are used.
+ */
+#define CC_BATCH 64		/* max components in a batch */
+#define CC_BATCH_NODES2 (1 << 26)	/* max sum of squared sizes in a batch */
+
+typedef struct {
+    graph_t *g;			/* component */
+    int rv;			/* < 0 error, 0 done, > 0 needs solving */
+    vtx_data *gp;
+    node_t **nodes;
+    double **coords;
+    stress_kD_t sd;
+} cc_job_t;
+
+/* ccSetup:
+ * The serial part of neatoLayout and majorization for one component,
+ * up to the point where only the stress iterations remain.
+ */
+static void ccSetup(graph_t * g, int model, cc_job_t * jp)
+{
+    int nG, ne, i, init, opts;
+    char *str;
+
+    jp->g = g;
+    jp->rv = 0;
+    jp->gp = NULL;
+    if ((str = agget(g, "maxiter")))
+	MaxIter = atoi(str);
+    else
+	MaxIter = DFLT_ITERATIONS;
+    nG = scan_graph_mode(g, MODE_MAJOR);
+    if ((nG < 2) || (MaxIter < 0))
+	return;
+
+    init = checkStart(g, nG, INIT_RANDOM);
+    opts = checkExp(g);
+    if (init == INIT_SELF)
+	opts |= opt_smart_init;
+    jp->coords = N_GNEW(Ndim, double *);
+    jp->coords[0] = N_GNEW(nG * Ndim, double);
+    for (i = 1; i < Ndim; i++)
+	jp->coords[i] = jp->coords[0] + i * nG;
+    jp->gp = makeGraphData(g, nG, &ne, MODE_MAJOR, model, &jp->nodes);
+    jp->rv = stress_kD_setup(&jp->sd, jp->gp, nG, ne, jp->coords,
+			     jp->nodes, Ndim, opts, model, MaxIter);
+    jp->sd.verbose = FALSE;
+}
+
+/* majorCCs:
+ * Lay out and route the edges of the components cc[0..n_cc-1]
+ * using stress majorization, as the loop in neato_layout does.
+ */
+static void
+majorCCs(graph_t ** cc, int n_cc, int model, adjust_data * am,
+	 boolean noTranslate)
+{
+    cc_job_t *jobs = N_NEW(MIN(n_cc, CC_BATCH), cc_job_t);
+    int i, j, nj;
+    double sz2;
+
+    for (i = 0; i < n_cc; i += nj) {
+	sz2 = 0;
+	for (nj = 0; (nj < CC_BATCH) && (i + nj < n_cc); nj++) {
+	    double sz = agnnodes(cc[i + nj]);
+	    if ((nj > 0) && (sz2 + sz * sz > CC_BATCH_NODES2))
+		break;
+	    sz2 += sz * sz;
+	    nodeInduce(cc[i + nj]);
+	    ccSetup(cc[i + nj], model, jobs + nj);
+	}
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (j = 0; j < nj; j++) {
+	    if (jobs[j].rv > 0)
+		jobs[j].rv = stress_kD_solve(&jobs[j].sd);
+	}
+	for (j = 0; j < nj; j++) {
+	    cc_job_t *jp = jobs + j;
+	    if (jp->gp)
+		majorFinish(jp->g, jp->rv, jp->coords, jp->gp, jp->nodes);
+	    removeOverlapWith(jp->g, am);
+	    setEdgeType(jp->g, ET_LINE);
+	    if (noTranslate) doEdges(jp->g);
+	    else spline_edges(jp->g);
+	}
+    }
+    free(jobs);
+}
+
 /* neato_layout:
  */
 void neato_layout(Agraph_t * g)
@@ -1459,7 +1585,9 @@ void neato_layout(Agraph_t * g)
 
 	    if (n_cc > 1) {
 		boolean *bp;
-		for (i = 0; i < n_cc; i++) {
+		if (layoutMode == MODE_MAJOR)
+		    majorCCs(cc, n_cc, model, &am, noTranslate);
+		else for (i = 0; i < n_cc; i++) {
 		    gc = cc[i];
 		    nodeInduce(gc);
 		    neatoLayout(g, gc, layoutMode, model, &am);
@@ -488,11 +488,17 @@ makePolyline(graph_t* g, edge_t * e)
  * is on or inside one of the obstacles and, if so, tells the shortest path
  * computation to ignore them. 
  */
-void makeSpline(graph_t* g, edge_t * e, Ppoly_t ** obs, int npoly, boolean chkPts)
+/* routeSpline:
+ * Fit a spline to the path of e, avoiding the npoly obstacles obs,
+ * ignoring those containing the endpoints if chkPts is true.
+ * Returns the result of Proutespline.
+ */
+static int routeSpline(edge_t * e, Ppoly_t ** obs, int npoly,
+		       boolean chkPts, Ppolyline_t * spline)
 {
-    Ppolyline_t line, spline;
+    Ppolyline_t line;
     Pvector_t slopes[2];
-    int i, n_barriers;
+    int i, n_barriers, rv;
     int pp, qp;
     Ppoint_t p, q;
     Pedge_t *barriers;
@@ -513,17 +519,270 @@ void makeSpline(graph_t* g, edge_t * e, Ppoly_t ** obs, int npoly, boolean chkPt
     make_barriers(obs, npoly, pp, qp, &barriers, &n_barriers);
     slopes[0].x = slopes[0].y = 0.0;
     slopes[1].x = slopes[1].y = 0.0;
-    if (Proutespline(barriers, n_barriers, line, slopes, &spline) < 0) {
-	agerr (AGERR, "makeSpline: failed to make spline edge (%s,%s)\n", agnameof(agtail(e)), agnameof(aghead(e)));
-	return;
-    }
+    rv = Proutespline(barriers, n_barriers, line, slopes, spline);
+    free(barriers);
+    return rv;
+}
+
+/* installSpline:
+ * Attach the spline routed for e, and place the edge labels.
+ */
+static void installSpline(graph_t * g, edge_t * e, Ppolyline_t spline)
+{
+    Ppolyline_t line = ED_path(e);
 
     /* north why did you ever use int coords */
     if (Verbose > 1)
 	fprintf(stderr, "spline %s %s\n", agnameof(agtail(e)), agnameof(aghead(e)));
     clip_and_install(e, aghead(e), spline.ps, spline.pn, &sinfo);
-    free(barriers);
-    addEdgeLabels(g, e, p, q);
+    addEdgeLabels(g, e, line.ps[0], line.ps[line.pn - 1]);
+}
+
+void makeSpline(graph_t* g, edge_t * e, Ppoly_t ** obs, int npoly, boolean chkPts)
+{
+    Ppolyline_t spline;
+
+    if (routeSpline(e, obs, npoly, chkPts, &spline) < 0) {
+	agerr (AGERR, "makeSpline: failed to make spline edge (%s,%s)\n", agnameof(agtail(e)), agnameof(aghead(e)));
+	return;
+    }
+    installSpline(g, e, spline);
+}
+
+/* Obstacle subsets for localroute=true.
+ * The cells of a loose quadtree over the obstacles each keep the
+ * obstacles meeting their region, the cell grown by half its size on
+ * every side, and the vconfig_t of these, built on first use. An edge
+ * is routed in the smallest cell whose region holds its endpoints with
+ * room to get around an obstacle. A route leaving the region may cross
+ * obstacles the cell does not know, so it is redone in the parent; the
+ * root holds all obstacles.
+ */
+#define CELL_MAX_DEPTH 12
+#define CELL_MIN_OBS 8
+
+typedef struct obscell_s {
+    boxf bb;
+    boxf region;
+    int depth;
+    int nobs;
+    Ppoly_t **obs;		/* obstacles meeting region, in input order */
+    int *ids;			/* their indices among all obstacles */
+    vconfig_t *vconfig;
+    struct obscell_s *parent;
+    struct obscell_s *child[4];	/* NULL until split */
+} obscell_t;
+
+typedef struct {
+    boxf *bb;			/* bounding boxes of the obstacles */
+    double grow;		/* room left around endpoints */
+    obscell_t *root;
+} obstree_t;
+
+static obscell_t *mkObsCell(obstree_t * t, obscell_t * parent, boxf bb,
+			    Ppoly_t ** obs, int npoly)
+{
+    obscell_t *c = NEW(obscell_t);
+    double dx = (bb.UR.x - bb.LL.x) / 2;
+    double dy = (bb.UR.y - bb.LL.y) / 2;
+    int i, id;
+
+    c->bb = bb;
+    c->region.LL.x = bb.LL.x - dx;
+    c->region.LL.y = bb.LL.y - dy;
+    c->region.UR.x = bb.UR.x + dx;
+    c->region.UR.y = bb.UR.y + dy;
+    c->parent = parent;
+    if (parent) {
+	c->depth = parent->depth + 1;
+	c->obs = N_NEW(parent->nobs, Ppoly_t *);
+	c->ids = N_NEW(parent->nobs, int);
+	for (i = 0; i < parent->nobs; i++) {
+	    id = parent->ids[i];
+	    if (OVERLAP(c->region, t->bb[id])) {
+		c->obs[c->nobs] = parent->obs[i];
+		c->ids[c->nobs++] = id;
+	    }
+	}
+    } else {
+	c->obs = N_NEW(npoly, Ppoly_t *);
+	c->ids = N_NEW(npoly, int);
+	for (i = 0; i < npoly; i++) {
+	    c->obs[i] = obs[i];
+	    c->ids[i] = i;
+	}
+	c->nobs = npoly;
+    }
+    return c;
+}
+
+static void freeObsCell(obscell_t * c)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+	if (c->child[i])
+	    freeObsCell(c->child[i]);
+    if (c->vconfig)
+	Pobsclose(c->vconfig);
+    free(c->obs);
+    free(c->ids);
+    free(c);
+}
+
+static obstree_t *mkObsTree(Ppoly_t ** obs, int npoly)
+{
+    obstree_t *t = NEW(obstree_t);
+    boxf bb, all;
+    int i, j;
+
+    t->bb = N_NEW(npoly, boxf);
+    for (i = 0; i < npoly; i++) {
+	bb.LL = bb.UR = obs[i]->ps[0];
+	for (j = 1; j < obs[i]->pn; j++)
+	    EXPANDBP(bb, obs[i]->ps[j]);
+	t->bb[i] = bb;
+	t->grow = MAX(t->grow, MAX(bb.UR.x - bb.LL.x, bb.UR.y - bb.LL.y));
+	if (i == 0)
+	    all = bb;
+	else
+	    EXPANDBB(all, bb);
+    }
+    if (npoly == 0)
+	all.LL.x = all.LL.y = all.UR.x = all.UR.y = 0;
+    t->root = mkObsCell(t, NULL, all, obs, npoly);
+    return t;
+}
+
+static void freeObsTree(obstree_t * t)
+{
+    freeObsCell(t->root);
+    free(t->bb);
+    free(t);
+}
+
+/* findObsCell:
+ * Return the smallest cell whose region contains b, splitting
+ * cells on the way as needed. Only the child holding the center
+ * of b is tried, as its region leaves the most room around b.
+ */
+static obscell_t *findObsCell(obstree_t * t, boxf b)
+{
+    obscell_t *c = t->root;
+    boxf bb;
+    pointf m, ctr = mid_pointf(b.LL, b.UR);
+    int i;
+
+    while (c->nobs > CELL_MIN_OBS && c->depth < CELL_MAX_DEPTH) {
+	m = mid_pointf(c->bb.LL, c->bb.UR);
+	if (!c->child[0]) {
+	    for (i = 0; i < 4; i++) {
+		bb.LL.x = (i & 1) ? m.x : c->bb.LL.x;
+		bb.UR.x = (i & 1) ? c->bb.UR.x : m.x;
+		bb.LL.y = (i & 2) ? m.y : c->bb.LL.y;
+		bb.UR.y = (i & 2) ? c->bb.UR.y : m.y;
+		c->child[i] = mkObsCell(t, c, bb, NULL, 0);
+	    }
+	}
+	i = (ctr.x >= m.x) + 2 * (ctr.y >= m.y);
+	if (!CONTAINS(c->child[i]->region, b))
+	    break;
+	c = c->child[i];
+    }
+    return c;
+}
+
+/* inRegion:
+ * Return true if the n points ps, and hence their convex hull,
+ * lie in the region of cell c.
+ */
+static boolean inRegion(obscell_t * c, Ppoint_t * ps, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+	if (!INSIDE(ps[i], c->region))
+	    return FALSE;
+    return TRUE;
+}
+
+/* cellId:
+ * Return the index in cell c of obstacle id, or POLYID_NONE.
+ */
+static int cellId(obscell_t * c, int id)
+{
+    int lo = 0, hi = c->nobs - 1, mid;
+
+    if (id < 0)
+	return POLYID_NONE;
+    while (lo <= hi) {
+	mid = (lo + hi) / 2;
+	if (c->ids[mid] == id)
+	    return mid;
+	if (c->ids[mid] < id)
+	    lo = mid + 1;
+	else
+	    hi = mid - 1;
+    }
+    return POLYID_NONE;
+}
+
+/* getLocalPath:
+ * As getPath, routing among the obstacles of the smallest cell
+ * of t around the endpoints of e in which the route stays.
+ * An obstacle left out of a cell does not meet its region, so the
+ * route crosses no obstacle and is as short as that among all.
+ */
+static Ppolyline_t getLocalPath(edge_t * e, obstree_t * t)
+{
+    Ppolyline_t line;
+    Ppoint_t p, q;
+    obscell_t *c;
+    boxf b;
+
+    p = add_pointf(ND_coord(agtail(e)), ED_tail_port(e).p);
+    q = add_pointf(ND_coord(aghead(e)), ED_head_port(e).p);
+    b.LL.x = MIN(p.x, q.x) - t->grow;
+    b.LL.y = MIN(p.y, q.y) - t->grow;
+    b.UR.x = MAX(p.x, q.x) + t->grow;
+    b.UR.y = MAX(p.y, q.y) + t->grow;
+
+    for (c = findObsCell(t, b);; c = c->parent) {
+	if (!c->vconfig)
+	    c->vconfig = Pobsopen(c->obs, c->nobs);
+	Pobspath(c->vconfig, p, cellId(c, ND_lim(agtail(e))),
+		 q, cellId(c, ND_lim(aghead(e))), &line);
+	if (!c->parent || inRegion(c, line.ps, line.pn))
+	    return line;
+	free(line.ps);
+    }
+}
+
+/* makeLocalSpline:
+ * As makeSpline, fitting the spline to the barriers of the smallest cell
+ * of t holding the route of e. If the control points stay in the cell's
+ * region, every candidate spline rejected among all barriers was rejected
+ * there too, so the spline is the one fitted among all barriers.
+ */
+static void makeLocalSpline(graph_t * g, edge_t * e, obstree_t * t)
+{
+    Ppolyline_t line = ED_path(e);
+    Ppolyline_t spline;
+    obscell_t *c;
+    boxf b;
+    int i;
+
+    b.LL = b.UR = line.ps[0];
+    for (i = 1; i < line.pn; i++)
+	EXPANDBP(b, line.ps[i]);
+    for (c = findObsCell(t, b); c->parent; c = c->parent) {
+	if (routeSpline(e, c->obs, c->nobs, TRUE, &spline) == 0 &&
+	    inRegion(c, spline.ps, spline.pn)) {
+	    installSpline(g, e, spline);
+	    return;
+	}
+    }
+    makeSpline(g, e, c->obs, c->nobs, TRUE);
 }
 
   /* True if either head or tail has a port on its boundary */
@@ -548,6 +807,7 @@ static int _spline_edges(graph_t * g, expand_t* pmargin, int edgetype)
     Ppoly_t *obp;
     int cnt, i = 0, npoly;
     vconfig_t *vconfig = 0;
+    obstree_t *otree = 0;
     path *P = NULL;
     int useEdges = (Nop > 1);
     int legal = 0;
@@ -574,7 +834,12 @@ static int _spline_edges(graph_t * g, expand_t* pmargin, int edgetype)
     npoly = i;
     if (obs) {
 	if ((legal = Plegal_arrangement(obs, npoly))) {
-	    if (edgetype != ET_ORTHO) vconfig = Pobsopen(obs, npoly);
+	    if (edgetype != ET_ORTHO) {
+		if (mapbool(agget(g, "localroute")))
+		    otree = mkObsTree(obs, npoly);
+		else
+		    vconfig = Pobsopen(obs, npoly);
+	    }
 	}
 	else {
 	    if (edgetype == ET_ORTHO)
@@ -588,7 +853,7 @@ static int _spline_edges(graph_t * g, expand_t* pmargin, int edgetype)
     if (Verbose)
 	fprintf(stderr, "Creating edges using %s\n",
 	    (legal && (edgetype == ET_ORTHO)) ? "orthogonal lines" :
-	    (vconfig ? (edgetype == ET_SPLINE ? "splines" : "polylines") : 
+	    ((vconfig || otree) ? (edgetype == ET_SPLINE ? "splines" : "polylines") : 
 		"line segments"));
     if (vconfig) {
 	/* path-finding pass */
@@ -598,6 +863,13 @@ static int _spline_edges(graph_t * g, expand_t* pmargin, int edgetype)
 	    }
 	}
     }
+    else if (otree) {
+	for (n = agfstnode(g); n; n = agnxtnode(g, n)) {
+	    for (e = agfstout(g, n); e; e = agnxtout(g, e)) {
+		ED_path(e) = getLocalPath(e, otree);
+	    }
+	}
+    }
 #ifdef ORTHO
     else if (legal && (edgetype == ET_ORTHO)) {
 	orthoEdges (g, 0);
@@ -622,7 +894,7 @@ static int _spline_edges(graph_t * g, expand_t* pmargin, int edgetype)
 		    P->boxes = N_NEW(agnnodes(g) + 20 * 2 * 9, boxf);
 		}
 		makeSelfArcs(P, e, GD_nodesep(g->root));
-	    } else if (vconfig) { /* ET_SPLINE or ET_PLINE */
+	    } else if (vconfig || otree) { /* ET_SPLINE or ET_PLINE */
 #ifdef HAVE_GTS
 		if ((ED_count(e) > 1) || BOUNDARY_PORT(e)) {
 		    int fail = 0;
@@ -644,10 +916,12 @@ static int _spline_edges(graph_t * g, expand_t* pmargin, int edgetype)
 		if (Concentrate) cnt = 1; /* only do representative */
 		e0 = e;
 		for (i = 0; i < cnt; i++) {
-		    if (edgetype == ET_SPLINE)
-			makeSpline(g, e0, obs, npoly, TRUE);
-		    else
+		    if (edgetype != ET_SPLINE)
 			makePolyline(g, e0);
+		    else if (otree)
+			makeLocalSpline(g, e0, otree);
+		    else
+			makeSpline(g, e0, obs, npoly, TRUE);
 		    e0 = ED_to_virt(e0);
 		}
 	    } else {
@@ -663,6 +937,8 @@ static int _spline_edges(graph_t * g, expand_t* pmargin, int edgetype)
 
     if (vconfig)
 	Pobsclose (vconfig);
+    if (otree)
+	freeObsTree (otree);
     if (P) {
 	free(P->boxes);
 	free(P);
@@ -0,0 +1,238 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+
+/******************************************
+
+	Priority queues of graph vertices
+	for Dijkstra's algorithm
+
+******************************************/
+
+#include <neatogen/pqueue.h>
+#include <limits.h>
+#include <stdlib.h>
+
+#define ARITY 4
+#define parent(i) (((i)-1)/ARITY)
+#define child(i) (ARITY*(i)+1)
+
+void mkPQueue(PQueue * pq, int n)
+{
+    int i;
+
+    pq->n = n;
+    pq->data = N_GNEW(n, int);
+    pq->heapSize = 0;
+    pq->index = N_GNEW(n, int);
+    for (i = 0; i < n; i++)
+	pq->index[i] = -1;
+    for (i = 0; i < PQ_BUCKETS; i++) {
+	pq->bucket[i].items = NULL;
+	pq->bucket[i].size = 0;
+	pq->bucket[i].cap = 0;
+    }
+    pq->last = 0;
+    pq->settled = N_GNEW(n, int);
+    pq->stamp = 0;
+}
+
+void freePQueue(PQueue * pq)
+{
+    int i;
+
+    free(pq->data);
+    free(pq->index);
+    for (i = 0; i < PQ_BUCKETS; i++)
+	free(pq->bucket[i].items);
+    free(pq->settled);
+}
+
+/* initPQueue_f:
+ * Empty the 4-ary heap for a new search.
+ */
+void initPQueue_f(PQueue * pq)
+{
+    int i;
+
+    for (i = 0; i < pq->heapSize; i++)
+	pq->index[pq->data[i]] = -1;
+    pq->heapSize = 0;
+}
+
+/* insertPQueue_f:
+ * Insert v with key dist[v], or move it up if it is already in the
+ * heap and dist[v] has decreased.
+ */
+void insertPQueue_f(PQueue * pq, int v, float *dist)
+{
+    int *data = pq->data;
+    int *index = pq->index;
+    float key = dist[v];
+    int i = index[v];
+    int p;
+
+    if (i < 0)
+	i = pq->heapSize++;
+    while (i > 0 && dist[data[p = parent(i)]] > key) {
+	data[i] = data[p];
+	index[data[i]] = i;
+	i = p;
+    }
+    data[i] = v;
+    index[v] = i;
+}
+
+/* extractMinPQueue_f:
+ * Remove and return the vertex of least distance, or -1 if the heap
+ * is empty.
+ */
+int extractMinPQueue_f(PQueue * pq, float *dist)
+{
+    int *data = pq->data;
+    int *index = pq->index;
+    int min, v, i, c, last, end;
+    float key;
+
+    if (pq->heapSize == 0)
+	return -1;
+
+    min = data[0];
+    index[min] = -1;
+    v = data[--pq->heapSize];
+    if (pq->heapSize == 0)
+	return min;
+
+    key = dist[v];
+    i = 0;
+    while ((c = child(i)) < pq->heapSize) {
+	int best = c;
+	end = c + ARITY;
+	if (end > pq->heapSize)
+	    end = pq->heapSize;
+	for (last = c + 1; last < end; last++)
+	    if (dist[data[last]] < dist[data[best]])
+		best = last;
+	if (dist[data[best]] >= key)
+	    break;
+	data[i] = data[best];
+	index[data[i]] = i;
+	i = best;
+    }
+    data[i] = v;
+    index[v] = i;
+    return min;
+}
+
+/* bucketOf:
+ * Bucket of the radix heap for key: 0 if key is not above the last
+ * key extracted, else one more than its highest bit differing from it.
+ */
+static int bucketOf(PQueue * pq, DistType key)
+{
+    unsigned int x;
+    int b = 0;
+
+    if (key <= pq->last)
+	return 0;
+    for (x = (unsigned int) key ^ (unsigned int) pq->last; x; x >>= 1)
+	b++;
+    return b;
+}
+
+static void push(PQueue * pq, int v, DistType key)
+{
+    pq_bucket *bk = &pq->bucket[bucketOf(pq, key)];
+
+    if (bk->size == bk->cap) {
+	bk->cap = bk->cap ? 2 * bk->cap : 16;
+	bk->items = RALLOC(bk->cap, bk->items, pq_item);
+    }
+    bk->items[bk->size].v = v;
+    bk->items[bk->size].key = key;
+    bk->size++;
+}
+
+/* initPQueue_i:
+ * Empty the radix heap for a new search.
+ */
+void initPQueue_i(PQueue * pq)
+{
+    int i;
+
+    for (i = 0; i < PQ_BUCKETS; i++)
+	pq->bucket[i].size = 0;
+    pq->last = 0;
+    if (pq->stamp == INT_MAX) {
+	for (i = 0; i < pq->n; i++)
+	    pq->settled[i] = 0;
+	pq->stamp = 0;
+    }
+    pq->stamp++;
+}
+
+/* insertPQueue_i:
+ * Insert v with the key its distance has just been lowered to.
+ * An earlier entry of v stays in the heap and is skipped when
+ * it comes out, its key being no longer the distance of v.
+ */
+void insertPQueue_i(PQueue * pq, int v, DistType key)
+{
+    push(pq, v, key);
+}
+
+/* extractMinPQueue_i:
+ * Remove and return the unsettled vertex of least distance, or -1 if
+ * there is none. When bucket 0 runs out, last becomes the least key of
+ * the next nonempty bucket, whose entries then all move to lower ones.
+ */
+int extractMinPQueue_i(PQueue * pq, DistType * dist)
+{
+    pq_bucket *b0 = &pq->bucket[0];
+    pq_bucket *bk;
+    pq_item *it;
+    int b, i, size;
+    DistType min = 0;
+    boolean found;
+
+#define LIVE(it) ((it)->key == dist[(it)->v] && pq->settled[(it)->v] != pq->stamp)
+    for (;;) {
+	if (b0->size == 0) {
+	    for (b = 1; b < PQ_BUCKETS && pq->bucket[b].size == 0; b++);
+	    if (b == PQ_BUCKETS)
+		return -1;
+	    bk = &pq->bucket[b];
+	    found = FALSE;
+	    for (i = 0; i < bk->size; i++) {
+		it = bk->items + i;
+		if (LIVE(it) && (!found || it->key < min)) {
+		    min = it->key;
+		    found = TRUE;
+		}
+	    }
+	    size = bk->size;
+	    bk->size = 0;
+	    if (!found)
+		continue;
+	    pq->last = min;
+	    for (i = 0; i < size; i++) {
+		it = bk->items + i;
+		if (LIVE(it))
+		    push(pq, it->v, it->key);
+	    }
+	}
+	it = b0->items + --b0->size;
+	if (LIVE(it)) {
+	    pq->settled[it->v] = pq->stamp;
+	    return it->v;
+	}
+    }
+#undef LIVE
+}
@@ -0,0 +1,74 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _PQUEUE_H_
+#define _PQUEUE_H_
+
+#include <neatogen/defs.h>
+
+/* Priority queue of the vertices 0..n-1 of a graph for Dijkstra's
+ * algorithm, keyed by the distance array of the search.
+ *
+ * Float distances use a 4-ary heap with decrease-key. Integer distances
+ * use a radix heap, which relies on the keys extracted never decreasing,
+ * as holds for edge weights >= 0.
+ *
+ * Vertices enter the queue only once reached, and a PQueue is made once
+ * for all the searches on a graph, so a search costs no allocation and
+ * no O(n) setup beyond that of its distance array.
+ */
+
+#define PQ_BUCKETS 33
+
+    typedef struct {
+	int v;
+	DistType key;
+    } pq_item;
+
+    typedef struct {
+	pq_item *items;
+	int size;
+	int cap;
+    } pq_bucket;
+
+    typedef struct {
+	int n;
+	/* 4-ary heap, for float keys */
+	int *data;
+	int heapSize;
+	int *index;		/* position of a vertex in data, or -1 */
+	/* radix heap, for integer keys */
+	pq_bucket bucket[PQ_BUCKETS];	/* bucket[b] has the keys whose highest
+					   bit differing from last is bit b-1 */
+	DistType last;		/* the last key extracted */
+	int *settled;		/* stamp of the search that settled a vertex */
+	int stamp;
+    } PQueue;
+
+    extern void mkPQueue(PQueue *, int);
+    extern void freePQueue(PQueue *);
+
+    extern void initPQueue_f(PQueue *);
+    extern void insertPQueue_f(PQueue *, int, float *);
+    extern int extractMinPQueue_f(PQueue *, float *);
+
+    extern void initPQueue_i(PQueue *);
+    extern void insertPQueue_i(PQueue *, int, DistType);
+    extern int extractMinPQueue_i(PQueue *, DistType *);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -5,6 +5,13 @@
 #include <neatogen/neatoprocs.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+
+// with OpenMP, shortest paths are computed in parallel for graphs of at least
+// this many nodes, and with hogwild=true each epoch's updates for at least
+// this many terms
+#define SGD_PARALLEL_NODES 256
+#define SGD_PARALLEL_TERMS (1 << 16)
 
 
 static float calculate_stress(float *pos, term_sgd *terms, int n_terms) {
@@ -140,9 +147,148 @@ static void free_adjacency(graph_sgd *graph) {
     free(graph);
 }
 
+// number of pivots used by sparse sgd, or all nodes if there are fewer
+#define SPARSE_SGD_PIVOTS 50
+
+static int floatcmp(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+// sparse approximation of the stress terms, as in Zheng, Pawar & Goodman,
+// "Graph Drawing by Stochastic Gradient Descent": an exact term for each edge,
+// plus terms from every node to a set of pivots chosen by maximin distance.
+// The term from node i to pivot p stands in for the nodes closest to p,
+// so it is weighted by how many of those lie within half the distance from p to i.
+// Pivot terms only move i, so they go in a list of their own.
+// Returns the number of edge terms, and sets *far and *n_far to the pivot terms.
+static int sparse_terms(graph_sgd *graph, term_sgd **near, term_sgd **far, int *n_far) {
+    int n = graph->n;
+    int n_pivots = MIN(n, SPARSE_SGD_PIVOTS);
+    int i, p, x;
+
+    // exact terms for edges, once per pair of adjacent nodes
+    int n_near = 0;
+    int *seen = N_NEW(n, int);
+    for (i=0; i<n; i++)
+        seen[i] = -1;
+    *near = N_NEW(graph->sources[n], term_sgd);
+    for (i=0; i<n; i++) {
+        for (x=graph->sources[i]; x<graph->sources[i+1]; x++) {
+            int j = graph->targets[x];
+            if (j < i || seen[j] == i || (graph->pinneds[i] && graph->pinneds[j]))
+                continue;
+            seen[j] = i;
+            (*near)[n_near].i = i;
+            (*near)[n_near].j = j;
+            (*near)[n_near].d = graph->weights[x];
+            (*near)[n_near].w = 1 / (graph->weights[x]*graph->weights[x]);
+            n_near++;
+        }
+    }
+    free(seen);
+
+    // maximin pivots: each is the node farthest from those chosen so far
+    float *dists = N_NEW(n_pivots*n, float);
+    float *mindist = N_NEW(n, float);
+    int *region = N_NEW(n, int);
+    int *pivots = N_NEW(n_pivots, int);
+    PQueue pq;
+    for (i=0; i<n; i++)
+        mindist[i] = MAXFLOAT;
+    mkPQueue(&pq, n);
+    int next = 0;
+    for (p=0; p<n_pivots; p++) {
+        float *d = dists + p*n;
+        pivots[p] = next;
+        dijkstra_sgd_dist(graph, next, d, &pq);
+        for (i=0; i<n; i++) {
+            if (d[i] < mindist[i]) {
+                mindist[i] = d[i];
+                region[i] = p;
+            }
+        }
+        // unreachable nodes come first, so every component gets a pivot
+        for (i=0; i<n; i++) {
+            if (mindist[i] > mindist[next])
+                next = i;
+        }
+    }
+    freePQueue(&pq);
+
+    // distances of the nodes of each region from its pivot, in increasing order
+    int *start = N_NEW(n_pivots+1, int);
+    float *members = N_NEW(n, float);
+    for (i=0; i<n; i++)
+        start[region[i]+1]++;
+    for (p=0; p<n_pivots; p++)
+        start[p+1] += start[p];
+    int *fill = N_NEW(n_pivots, int);
+    for (i=0; i<n; i++) {
+        p = region[i];
+        members[start[p] + fill[p]++] = mindist[i];
+    }
+    free(fill);
+    for (p=0; p<n_pivots; p++)
+        qsort(members+start[p], start[p+1]-start[p], sizeof(float), floatcmp);
+
+    // weighted terms from each movable node to each pivot
+    *far = N_NEW(n_pivots*n, term_sgd);
+    *n_far = 0;
+    for (i=0; i<n; i++) {
+        if (graph->pinneds[i])
+            continue;
+        for (p=0; p<n_pivots; p++) {
+            float d = dists[p*n+i];
+            if (pivots[p] == i || d == MAXFLOAT)
+                continue;
+            // number of region members within d/2 of the pivot; at least the pivot itself
+            int lo = start[p], hi = start[p+1];
+            while (lo < hi) {
+                int mid = lo + (hi-lo)/2;
+                if (members[mid] <= d/2)
+                    lo = mid+1;
+                else
+                    hi = mid;
+            }
+            int s = lo - start[p];
+            assert(s > 0);
+            (*far)[*n_far].i = i;
+            (*far)[*n_far].j = pivots[p];
+            (*far)[*n_far].d = d;
+            (*far)[*n_far].w = s / (d*d);
+            (*n_far)++;
+        }
+    }
+    free(dists);
+    free(mindist);
+    free(region);
+    free(pivots);
+    free(start);
+    free(members);
+    return n_near;
+}
+
+// the key of the stress terms of graph in the distance cache:
+// the model and all of graph, as pinned nodes get fewer terms
+static char *terms_key(graph_sgd *graph, int model, size_t *len) {
+    int n = graph->n, m = graph->sources[n];
+    size_t sz = 2*sizeof(int) + (n+1)*sizeof(int) + n*sizeof(bool)
+              + m*sizeof(int) + m*sizeof(float);
+    char *key = N_NEW(sz, char), *kp = key;
+    memcpy(kp, &model, sizeof(int)); kp += sizeof(int);
+    memcpy(kp, &n, sizeof(int)); kp += sizeof(int);
+    memcpy(kp, graph->sources, (n+1)*sizeof(int)); kp += (n+1)*sizeof(int);
+    memcpy(kp, graph->pinneds, n*sizeof(bool)); kp += n*sizeof(bool);
+    memcpy(kp, graph->targets, m*sizeof(int)); kp += m*sizeof(int);
+    memcpy(kp, graph->weights, m*sizeof(float));
+    *len = sz;
+    return key;
+}
 
 void sgd(graph_t *G, /* input graph */
-        int model /* distance model */)
+        int model, /* distance model */
+        bool sparse /* use pivots instead of all pairs */)
 {
     if (model == MODEL_CIRCUIT) {
         agerr(AGWARN, "circuit model not yet supported in Gmode=sgd, reverting to shortpath model\n");
@@ -158,38 +304,93 @@ void sgd(graph_t *G, /* input graph */
         fprintf(stderr, "calculating shortest paths and setting up stress terms:");
         start_timer();
     }
-    // calculate how many terms will be needed as fixed nodes can be ignored
-    int i, n_fixed = 0, n_terms = 0;
-    for (i=0; i<n; i++) {
-        if (!isFixed(GD_neato_nlist(G)[i])) {
-            n_fixed++;
-            n_terms += n-n_fixed;
-        }
-    }
-    term_sgd *terms = N_NEW(n_terms, term_sgd);
-    // calculate term values through shortest paths
-    int offset = 0;
+    int i, n_terms, n_far = 0;
+    term_sgd *terms, *far = NULL;
     graph_sgd *graph = extract_adjacency(G, model);
-    for (i=0; i<n; i++) {
-        if (!isFixed(GD_neato_nlist(G)[i])) {
-            offset += dijkstra_sgd(graph, i, terms+offset);
+    size_t keylen = 0, size;
+    char *key = sparse || !distcache_enabled(G) ? NULL
+              : terms_key(graph, model, &keylen);
+    if (sparse) {
+        n_terms = sparse_terms(graph, &terms, &far, &n_far);
+    } else if (key && (terms = distcache_get(G, "sgd", key, keylen, &size))) {
+        // the terms of the same graph from an earlier layout
+        n_terms = size / sizeof(term_sgd);
+    } else {
+        // calculate how many terms will be needed as fixed nodes can be ignored:
+        // a source gets a term for each lower node and each fixed higher one,
+        // so each source can fill its own part of terms
+        int *start = N_NEW(n+1, int);
+        int *count = N_NEW(n, int);
+        int n_pinned = 0;
+        for (i=n-1; i>=0; i--) {
+            if (graph->pinneds[i])
+                n_pinned++;
+            else
+                count[i] = i + n_pinned;
+        }
+        for (i=0; i<n; i++)
+            start[i+1] = start[i] + count[i];
+        n_terms = start[n];
+        terms = N_NEW(n_terms, term_sgd);
+        // calculate term values through shortest paths,
+        // each thread with its own distances and queue
+#ifdef _OPENMP
+#pragma omp parallel if (n >= SGD_PARALLEL_NODES)
+#endif
+        {
+            float *dists = N_NEW(n, float);
+            PQueue pq;
+            int k;
+            mkPQueue(&pq, n);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+            for (k=0; k<n; k++) {
+                if (!graph->pinneds[k]) {
+                    count[k] = dijkstra_sgd(graph, k, terms+start[k], dists, &pq);
+                }
+            }
+            free(dists);
+            freePQueue(&pq);
+        }
+        // a disconnected graph gets fewer terms than allowed for
+        int offset = 0;
+        for (i=0; i<n; i++) {
+            memmove(terms+offset, terms+start[i], count[i] * sizeof(term_sgd));
+            offset += count[i];
         }
+        n_terms = offset;
+        free(start);
+        free(count);
+        if (key)
+            distcache_put(G, "sgd", key, keylen, terms, n_terms * sizeof(term_sgd));
     }
-    assert(offset == n_terms);
+    free(key);
     free_adjacency(graph);
     if (Verbose) {
         fprintf(stderr, " %.2f sec\n", elapsed_sec());
     }
+    if (n_terms + n_far == 0) {
+        free(terms);
+        free(far);
+        return;
+    }
 
     // initialise annealing schedule
-    float w_min = terms[0].w, w_max = terms[0].w;
+    float w_min = n_terms ? terms[0].w : far[0].w, w_max = w_min;
     int ij;
-    for (ij=1; ij<n_terms; ij++) {
+    for (ij=0; ij<n_terms; ij++) {
         if (terms[ij].w < w_min)
             w_min = terms[ij].w;
         if (terms[ij].w > w_max)
             w_max = terms[ij].w;
     }
+    for (ij=0; ij<n_far; ij++) {
+        if (far[ij].w < w_min)
+            w_min = far[ij].w;
+        if (far[ij].w > w_max)
+            w_max = far[ij].w;
+    }
     // note: Epsilon is different from MODE_KK and MODE_MAJOR as it is a minimum step size rather than energy threshold
     //       MaxIter is also different as it is a fixed number of iterations rather than a maximum
     float eta_max = 1 / w_min;
@@ -214,10 +415,21 @@ void sgd(graph_t *G, /* input graph */
         start_timer();
     }
     int t;
-    rk_seed(0, &rstate); // TODO: get seed from graph
+    long seed = 0;
+    setSeed(G, INIT_RANDOM, &seed);
+    rk_seed(seed, &rstate);
+#ifdef _OPENMP
+    bool hogwild = mapBool(agget(G, "hogwild"), false);
+#endif
     for (t=0; t<MaxIter; t++) {
         fisheryates_shuffle(terms, n_terms);
         float eta = eta_max * exp(-lambda * t);
+        // with hogwild=true, updates of the same node can race; they rarely
+        // meet, and SGD copes with the few lost updates when they do, but the
+        // layout then depends on the timing of the threads
+#ifdef _OPENMP
+#pragma omp parallel for if (hogwild && n_terms >= SGD_PARALLEL_TERMS)
+#endif
         for (ij=0; ij<n_terms; ij++) {
             // cap step size
             float mu = eta * terms[ij].w;
@@ -241,14 +453,33 @@ void sgd(graph_t *G, /* input graph */
                 pos[2*terms[ij].j+1] += r_y;
             }
         }
+        // pivot terms move only their node, by the whole step
+        fisheryates_shuffle(far, n_far);
+#ifdef _OPENMP
+#pragma omp parallel for if (hogwild && n_far >= SGD_PARALLEL_TERMS)
+#endif
+        for (ij=0; ij<n_far; ij++) {
+            float mu = eta * far[ij].w;
+            if (mu > 1)
+                mu = 1;
+
+            float dx = pos[2*far[ij].i] - pos[2*far[ij].j];
+            float dy = pos[2*far[ij].i+1] - pos[2*far[ij].j+1];
+            float mag = sqrt(dx*dx + dy*dy);
+
+            float r = (mu * (mag-far[ij].d)) / mag;
+            pos[2*far[ij].i] -= r * dx;
+            pos[2*far[ij].i+1] -= r * dy;
+        }
         if (Verbose) {
-            fprintf(stderr, " %.3f", calculate_stress(pos, terms, n_terms));
+            fprintf(stderr, " %.3f", calculate_stress(pos, terms, n_terms) + calculate_stress(pos, far, n_far));
         }
     }
     if (Verbose) {
         fprintf(stderr, "\nfinished in %.2f sec\n", elapsed_sec());
     }
     free(terms);
+    free(far);
 
     // copy temporary positions back into graph_t
     for (i=0; i<n; i++) {
@@ -19,7 +19,7 @@ typedef struct graph_sgd {
     float *weights; // weights of edges (length sources[n])
 } graph_sgd;
 
-extern void sgd(graph_t *, int);
+extern void sgd(graph_t *, int, bool);
 
 #endif /* SGD_H */
 
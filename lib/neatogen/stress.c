@@ -21,6 +21,9 @@
 #include <math.h>
 #include <stdlib.h>
 #include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 
 #ifndef HAVE_DRAND48
@@ -31,14 +34,6 @@ extern double drand48(void);
 				   by d_{ij}^{-2} otherwise, they are normalized by d_{ij}^{-1}
 				 */
 
-#ifdef NONCORE
-/* Set 'max_nodes_in_mem' so that 
- * 4*(max_nodes_in_mem^2) is smaller than the available memory (in bytes)
- * 4 = sizeof(float)
- */
-#define max_nodes_in_mem 18000
-#endif
-
  /* relevant when using sparse distance matrix not within subspace */
 #define smooth_pivots true
 
@@ -292,6 +287,7 @@ static int sparse_stress_subspace_majorization_kD(vtx_data * graph,	/* Input gra
     int *CenterIndex;
     int *invCenterIndex;	/* list the pivot nodes  */
     Queue Q;
+    PQueue pq;
     float *old_weights;
     /* this matrix stores the distance between  each node and each "center" */
     DistType **Dij;
@@ -351,6 +347,7 @@ static int sparse_stress_subspace_majorization_kD(vtx_data * graph,	/* Input gra
     invCenterIndex = NULL;
 
     mkQueue(&Q, n);
+    mkPQueue(&pq, n);
     old_weights = graph[0].ewgts;
 
     if (reweight_graph) {
@@ -384,7 +381,7 @@ static int sparse_stress_subspace_majorization_kD(vtx_data * graph,	/* Input gra
     invCenterIndex[0] = node;
 
     if (reweight_graph) {
-	dijkstra(node, graph, n, Dij[0]);
+	dijkstra(node, graph, n, Dij[0], &pq);
     } else {
 	bfs(node, graph, n, Dij[0], &Q);
     }
@@ -403,7 +400,7 @@ static int sparse_stress_subspace_majorization_kD(vtx_data * graph,	/* Input gra
 	CenterIndex[node] = i;
 	invCenterIndex[i] = node;
 	if (reweight_graph) {
-	    dijkstra(node, graph, n, Dij[i]);
+	    dijkstra(node, graph, n, Dij[i], &pq);
 	} else {
 	    bfs(node, graph, n, Dij[i], &Q);
 	}
@@ -455,7 +452,7 @@ static int sparse_stress_subspace_majorization_kD(vtx_data * graph,	/* Input gra
 	if (dist_bound > 0) {
 	    if (reweight_graph) {
 		num_visited_nodes =
-		    dijkstra_bounded(i, graph, n, dist, dist_bound,
+		    dijkstra_bounded(i, graph, n, dist, &Q, &pq, dist_bound,
 				     visited_nodes);
 	    } else {
 		num_visited_nodes =
@@ -700,32 +697,56 @@ finish0:
     free(subspace[0]);
     free(subspace);
     freeQueue(&Q);
+    freePQueue(&pq);
 
     return iterations;
 }
 
+/* Below this many nodes, the shortest paths are computed serially. */
+#define APSP_PARALLEL_NODES 500
+
+/* packed_row:
+ * Offset of the diagonal entry of row i in a packed n x n
+ * upper triangular matrix.
+ */
+static size_t packed_row(int i, int n)
+{
+    return (size_t) i *n - (size_t) i *(i - 1) / 2;
+}
+
 /* compute_weighted_apsp_packed:
  * Edge lengths can be any float > 0
+ * The rows are independent, so with OpenMP each thread runs dijkstra_f
+ * from its share of the sources, with its own scratch vector and queue,
+ * and writes only those rows of Dij.
  */
 static float *compute_weighted_apsp_packed(vtx_data * graph, int n)
 {
-    int i, j, count;
     float *Dij = N_NEW(n * (n + 1) / 2, float);
 
-    float *Di = N_NEW(n, float);
-    Queue Q;
-
-    mkQueue(&Q, n);
-
-    count = 0;
-    for (i = 0; i < n; i++) {
-	dijkstra_f(i, graph, n, Di);
-	for (j = i; j < n; j++) {
-	    Dij[count++] = Di[j];
+#ifdef _OPENMP
+#pragma omp parallel if (n >= APSP_PARALLEL_NODES)
+#endif
+    {
+	int i, j;
+	float *Di = N_NEW(n, float);
+	float *Dii;
+	PQueue pq;
+
+	mkPQueue(&pq, n);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+	for (i = 0; i < n; i++) {
+	    dijkstra_f(i, graph, n, Di, &pq);
+	    Dii = Dij + packed_row(i, n);
+	    for (j = i; j < n; j++) {
+		Dii[j - i] = Di[j];
+	    }
 	}
+	free(Di);
+	freePQueue(&pq);
     }
-    free(Di);
-    freeQueue(&Q);
     return Dij;
 }
 
@@ -765,26 +786,35 @@ float *mdsModel(vtx_data * graph, int nG)
 
 /* compute_apsp_packed:
  * Assumes integral weights > 0.
+ * Rows are filled in parallel as in compute_weighted_apsp_packed.
  */
 float *compute_apsp_packed(vtx_data * graph, int n)
 {
-    int i, j, count;
     float *Dij = N_NEW(n * (n + 1) / 2, float);
 
-    DistType *Di = N_NEW(n, DistType);
-    Queue Q;
-
-    mkQueue(&Q, n);
-
-    count = 0;
-    for (i = 0; i < n; i++) {
-	bfs(i, graph, n, Di, &Q);
-	for (j = i; j < n; j++) {
-	    Dij[count++] = ((float) Di[j]);
+#ifdef _OPENMP
+#pragma omp parallel if (n >= APSP_PARALLEL_NODES)
+#endif
+    {
+	int i, j;
+	DistType *Di = N_NEW(n, DistType);
+	float *Dii;
+	Queue Q;
+
+	mkQueue(&Q, n);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+	for (i = 0; i < n; i++) {
+	    bfs(i, graph, n, Di, &Q);
+	    Dii = Dij + packed_row(i, n);
+	    for (j = i; j < n; j++) {
+		Dii[j - i] = ((float) Di[j]);
+	    }
 	}
+	free(Di);
+	freeQueue(&Q);
     }
-    free(Di);
-    freeQueue(&Q);
     return Dij;
 }
 
@@ -875,56 +905,92 @@ static void dumpMatrix(float *Dij, int n)
 }
 #endif
 
+/* distKey:
+ * The key of the distance matrix of graph under model in the distance
+ * cache: the model, and the neighbors and edge lengths of each node,
+ * which is all the distance models use.
+ */
+static char *distKey(vtx_data * graph, int n, int model, size_t * len)
+{
+    int i, hdr[3];
+    size_t sz = sizeof(hdr);
+    char *key, *kp;
+
+    for (i = 0; i < n; i++) {
+	sz += sizeof(int) + graph[i].nedges * sizeof(int);
+	if (graph->ewgts)
+	    sz += graph[i].nedges * sizeof(float);
+    }
+    key = kp = N_GNEW(sz, char);
+    hdr[0] = model;
+    hdr[1] = n;
+    hdr[2] = (graph->ewgts != NULL);
+    memcpy(kp, hdr, sizeof(hdr));
+    kp += sizeof(hdr);
+    for (i = 0; i < n; i++) {
+	memcpy(kp, &graph[i].nedges, sizeof(int));
+	kp += sizeof(int);
+	memcpy(kp, graph[i].edges, graph[i].nedges * sizeof(int));
+	kp += graph[i].nedges * sizeof(int);
+	if (graph->ewgts) {
+	    memcpy(kp, graph[i].ewgts, graph[i].nedges * sizeof(float));
+	    kp += graph[i].nedges * sizeof(float);
+	}
+    }
+    *len = sz;
+    return key;
+}
+
+/* cachedDist:
+ * Return the distance matrix of the n nodes cached under key, or NULL.
+ */
+static float *cachedDist(node_t ** nodes, int n, char *key, size_t keylen)
+{
+    size_t size;
+    float *Dij = distcache_get(agraphof(nodes[0]), "stress", key, keylen,
+			       &size);
+
+    if (Dij && size != n * (n + 1) / 2 * sizeof(float)) {
+	free(Dij);
+	Dij = NULL;
+    }
+    return Dij;
+}
+
 /* Accumulator type for diagonal of Laplacian. Needs to be as large
  * as possible. Use long double; configure to double if necessary.
  */
 #define DegType long double
 
-/* stress_majorization_kD_mkernel:
+/* stress_kD_setup:
+ * First half of stress_majorization_kD_mkernel: compute the distance
+ * matrix and the initial layout. This reads node attributes and uses
+ * the global random number generator, so it must be called serially.
+ * On success, sp holds everything stress_kD_solve needs.
+ * Return -1 on error, 0 if the layout is already final, and 1 if
+ * stress_kD_solve should be called.
  * At present, if any nodes have pos set, smart_ini is false.
  */
-int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse representation */
-				   int n,	/* Number of nodes */
-				   int nedges_graph,	/* Number of edges */
-				   double **d_coords,	/* coordinates of nodes (output layout) */
-				   node_t ** nodes,	/* original nodes */
-				   int dim,	/* dimemsionality of layout */
-				   int opts,    /* options */
-				   int model,	/* model */
-				   int maxi	/* max iterations */
+int stress_kD_setup(stress_kD_t * sp,
+		    vtx_data * graph,	/* Input graph in sparse representation */
+		    int n,	/* Number of nodes */
+		    int nedges_graph,	/* Number of edges */
+		    double **d_coords,	/* coordinates of nodes (output layout) */
+		    node_t ** nodes,	/* original nodes */
+		    int dim,	/* dimemsionality of layout */
+		    int opts,    /* options */
+		    int model,	/* model */
+		    int maxi	/* max iterations */
     )
 {
-    int iterations;		/* output: number of iteration of the process */
-
-    double conj_tol = tolerance_cg;	/* tolerance of Conjugate Gradient */
     float *Dij = NULL;
-    int i, j, k;
-    float **coords = NULL;
-    float *f_storage = NULL;
-    float constant_term;
-    int count;
-    DegType degree;
-    int lap_length;
-    float *lap2 = NULL;
-    DegType *degrees = NULL;
-    int step;
-    float val;
-    double old_stress, new_stress;
-    boolean converged;
-    float **b = NULL;
-    float *tmp_coords = NULL;
-    float *dist_accumulator = NULL;
-    float *lap1 = NULL;
+    char *key = NULL;
+    size_t keylen = 0;
+    int cached = 0;
+    int i, j;
     int smart_ini = opts & opt_smart_init;
     int exp = opts & opt_exp_flag;
-    int len;
     int havePinned;		/* some node is pinned */
-#ifdef ALTERNATIVE_STRESS_CALC
-    double mat_stress;
-#endif
-#ifdef NONCORE
-    FILE *fp = NULL;
-#endif
 
 
 	/*************************************************
@@ -942,7 +1008,17 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
     if (Verbose)
 	start_timer();
 
-    if (model == MODEL_SUBSET) {
+    /* with distcache set, the matrix may be known from an earlier layout */
+    if (nodes && n > 0 && distcache_enabled(agraphof(nodes[0]))) {
+	key = distKey(graph, n, model, &keylen);
+	Dij = cachedDist(nodes, n, key, keylen);
+	cached = Dij != NULL;
+    }
+
+    if (Dij) {
+	if (Verbose)
+	    fprintf(stderr, "Using cached distances");
+    } else if (model == MODEL_SUBSET) {
 	/* weight graph to separate high-degree nodes */
 	/* and perform slower Dijkstra-based computation */
 	if (Verbose)
@@ -955,6 +1031,14 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
 		  "graph is disconnected. Hence, the circuit model\n");
 	    agerr(AGPREV,
 		  "is undefined. Reverting to the shortest path model.\n");
+	    /* the fallback is cached as the shortest path model, so that
+	     * later circuit layouts still warn */
+	    if (key) {
+		free(key);
+		key = distKey(graph, n, MODEL_SHORTPATH, &keylen);
+		Dij = cachedDist(nodes, n, key, keylen);
+		cached = Dij != NULL;
+	    }
 	}
     } else if (model == MODEL_MDS) {
 	if (Verbose)
@@ -969,6 +1053,12 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
 	else
 	    Dij = compute_apsp_packed(graph, n);
     }
+    if (key) {
+	if (!cached)
+	    distcache_put(agraphof(nodes[0]), "stress", key, keylen, Dij,
+			  n * (n + 1) / 2 * sizeof(float));
+	free(key);
+    }
 
     if (Verbose) {
 	fprintf(stderr, ": %.2f sec\n", elapsed_sec());
@@ -990,8 +1080,8 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
 					       (model == MODEL_SUBSET), 50,
 					       neighborhood_radius_subspace,
 					       num_pivots_stress) < 0) {
-	    iterations = -1;
-	    goto finish1;
+	    free(Dij);
+	    return -1;
 	}
 
 	for (i = 0; i < dim; i++) {
@@ -1016,10 +1106,185 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
     }
     if (Verbose)
 	fprintf(stderr, ": %.2f sec", elapsed_sec());
-    if ((n == 1) || (maxi == 0))
+    if ((n == 1) || (maxi == 0)) {
+	free(Dij);
 	return 0;
+    }
 
-    if (Verbose) {
+    sp->n = n;
+    sp->d_coords = d_coords;
+    sp->nodes = nodes;
+    sp->dim = dim;
+    sp->exp = exp;
+    sp->maxi = maxi;
+    sp->Dij = Dij;
+    sp->havePinned = havePinned;
+    sp->verbose = Verbose;
+    return 1;
+}
+
+/* lap1_row:
+ * Store in w the entries of row i of lap1, the Laplacian of
+ * 1/(d_ij*|p_i-p_j|), in columns j0..j1-1, where i < j0.
+ * lap2i points to the entry of lap2 in row i and column j0.
+ * Building a row costs less than storing all of lap1, which would
+ * double the memory of the solve, so rows are rebuilt when needed.
+ */
+static void
+lap1_row(float **coords, int dim, int i, int j0, int j1, int exp,
+	 float *lap2i, float *w)
+{
+    int j, k;
+    int len = j1 - j0;
+
+    /* init 'w' with zeros */
+    set_vector_valf(len, 0, w);
+
+    /* put into 'w' all squared distances between 'i' and 'j0',...,'j1'-1 */
+    for (k = 0; k < dim; k++) {
+	size_t x;
+	for (x = 0; x < (size_t)len; ++x) {
+	    float tmp = coords[k][i] + -1.0f * (coords[k] + j0)[x];
+	    w[x] += tmp * tmp;
+	}
+    }
+
+    /* convert to 1/d_{ij} */
+    invert_sqrt_vec(len, w);
+    /* detect overflows */
+    for (j = 0; j < len; j++) {
+	if (w[j] >= MAXFLOAT || w[j] < 0) {
+	    w[j] = 0;
+	}
+    }
+
+#ifdef Dij2
+    if (exp == 2) {
+	double d;
+	float v;
+	for (j = 0; j < len; j++) {
+	    if ((v = lap2i[j]) >= 0.0) {
+		d = sqrt(v);
+		w[j] *= (float) d;
+	    } else
+		w[j] = 0;
+	}
+    }
+#endif
+}
+
+/* Below this many nodes, lap1_mult_rows is run serially. */
+#define LAP_PARALLEL_SIZE 1000
+
+/* lap1_mult_rows:
+ * Set b[k][lo..hi-1] to the same entries of lap1*coords[k], and
+ * degrees[lo..hi-1] to the diagonal of lap1, both as if all the rows
+ * of lap1 were built in order and multiplied by right_mult_with_vector_ff.
+ * Rows above lo only contribute their entries in columns lo..hi-1. Each
+ * row below gets its diagonal once the rows above it are done, so a
+ * single pass over the rows is enough.
+ * w is scratch space for n floats.
+ */
+static void
+lap1_mult_rows(float **coords, int dim, int n, int exp, float *lap2,
+	       float **b, DegType * degrees, float *w, int lo, int hi)
+{
+    int i, j, k, len;
+    size_t count;
+    DegType degree;
+    float val, vi, res;
+
+    for (i = lo; i < hi; i++) {
+	degrees[i] = 0;
+	for (k = 0; k < dim; k++) {
+	    b[k][i] = 0;
+	}
+    }
+
+    /* rows above the block: row i starts at count */
+    for (count = 0, i = 0; i < lo; count += n - i, i++) {
+	lap1_row(coords, dim, i, lo, hi, exp, lap2 + count + (lo - i), w);
+	for (j = lo; j < hi; j++) {
+	    degrees[j] -= w[j - lo];
+	}
+	for (k = 0; k < dim; k++) {
+	    vi = coords[k][i];
+	    for (j = lo; j < hi; j++) {
+		b[k][j] += w[j - lo] * vi;
+	    }
+	}
+    }
+
+    /* rows of the block */
+    for (; i < hi; count += n - i, i++) {
+	len = n - i - 1;
+	lap1_row(coords, dim, i, i + 1, n, exp, lap2 + count + 1, w);
+	degree = 0;
+	for (j = 0; j < len; j++) {
+	    val = w[j];
+	    degree += val;
+	    if (i + j + 1 < hi)
+		degrees[i + j + 1] -= val;
+	}
+	degrees[i] -= degree;
+
+	val = (float) degrees[i];
+	for (k = 0; k < dim; k++) {
+	    vi = coords[k][i];
+	    res = 0;
+	    res += val * vi;
+	    for (j = 0; j < len; j++) {
+		res += w[j] * coords[k][i + j + 1];
+		if (i + j + 1 < hi)
+		    b[k][i + j + 1] += w[j] * vi;
+	    }
+	    b[k][i] += res;
+	}
+    }
+}
+
+/* stress_kD_solve:
+ * Second half of stress_majorization_kD_mkernel: iterate the
+ * majorization from the state left by stress_kD_setup, store the
+ * result in sp->d_coords and release sp->Dij.
+ * This only touches the arrays in sp, so calls for different
+ * components may run concurrently, provided sp->verbose is off.
+ * Return the number of iterations, or -1 on error.
+ */
+int stress_kD_solve(stress_kD_t * sp)
+{
+    int iterations;		/* output: number of iteration of the process */
+
+    double conj_tol = tolerance_cg;	/* tolerance of Conjugate Gradient */
+    int n = sp->n;
+    int dim = sp->dim;
+    int exp = sp->exp;
+    int maxi = sp->maxi;
+    int havePinned = sp->havePinned;
+    double **d_coords = sp->d_coords;
+    node_t **nodes = sp->nodes;
+    float *Dij = sp->Dij;
+    int i, j, k;
+    float **coords = NULL;
+    float *f_storage = NULL;
+    float constant_term;
+    int count;
+    DegType degree;
+    int lap_length;
+    float *lap2 = NULL;
+    DegType *degrees = NULL;
+    int step;
+    float val;
+    double old_stress, new_stress;
+    boolean converged;
+    float **b = NULL;
+    float *tmp_coords = NULL;
+    float *dist_accumulator = NULL;
+#ifdef ALTERNATIVE_STRESS_CALC
+    double mat_stress;
+#endif
+
+    if (sp->verbose) {
 	fprintf(stderr, ": %.2f sec\n", elapsed_sec());
 	fprintf(stderr, "Setting up stress function");
 	start_timer();
@@ -1090,16 +1355,6 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
 	lap2[count] = degrees[i];
     }
 
-#ifdef NONCORE
-    if (n > max_nodes_in_mem) {
-#define FILENAME "tmp_Dij$$$.bin"
-	fp = fopen(FILENAME, "wb");
-	fwrite(lap2, sizeof(float), lap_length, fp);
-	fclose(fp);
-	fp = NULL;
-    }
-#endif
-
 	/*************************
 	** Layout optimization  **
 	*************************/
@@ -1112,18 +1367,6 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
 
     tmp_coords = N_NEW(n, float);
     dist_accumulator = N_NEW(n, float);
-    lap1 = NULL;
-#ifdef NONCORE
-    if (n <= max_nodes_in_mem) {
-	lap1 = N_NEW(lap_length, float);
-    } else {
-	lap1 = lap2;
-	fp = fopen(FILENAME, "rb");
-	fgetpos(fp, &pos);
-    }
-#else
-    lap1 = N_NEW(lap_length, float);
-#endif
 
 
 #ifdef USE_MAXFLOAT
@@ -1131,7 +1374,7 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
 #else
     old_stress = MAXDOUBLE;	/* at least one iteration */
 #endif
-    if (Verbose) {
+    if (sp->verbose) {
 	fprintf(stderr, ": %.2f sec\n", elapsed_sec());
 	fprintf(stderr, "Solving model: ");
 	start_timer();
@@ -1140,77 +1383,23 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
     for (converged = FALSE, iterations = 0;
 	 iterations < maxi && !converged; iterations++) {
 
-	/* First, construct Laplacian of 1/(d_ij*|p_i-p_j|)  */
-	/* set_vector_val(n, 0, degrees); */
-	memset(degrees, 0, n * sizeof(DegType));
-	if (exp == 2) {
-#ifdef Dij2
-#ifdef NONCORE
-	    if (n <= max_nodes_in_mem) {
-		sqrt_vecf(lap_length, lap2, lap1);
-	    } else {
-		sqrt_vec(lap_length, lap1);
-	    }
-#else
-	    sqrt_vecf(lap_length, lap2, lap1);
-#endif
-#endif
+	/* First, compute b[k] := lap1*coords[k], where lap1 is the */
+	/* Laplacian of 1/(d_ij*|p_i-p_j|) */
+#ifdef _OPENMP
+#pragma omp parallel if (n >= LAP_PARALLEL_SIZE)
+	{
+	    int nblocks = omp_get_num_threads();
+	    int blk = omp_get_thread_num();
+	    float *w = N_NEW(n, float);
+	    lap1_mult_rows(coords, dim, n, exp, lap2, b, degrees, w,
+			   (int) ((double) n * blk / nblocks),
+			   (int) ((double) n * (blk + 1) / nblocks));
+	    free(w);
 	}
-	for (count = 0, i = 0; i < n - 1; i++) {
-	    len = n - i - 1;
-	    /* init 'dist_accumulator' with zeros */
-	    set_vector_valf(len, 0, dist_accumulator);
-
-	    /* put into 'dist_accumulator' all squared distances between 'i' and 'i'+1,...,'n'-1 */
-	    for (k = 0; k < dim; k++) {
-		size_t x;
-		for (x = 0; x < (size_t)len; ++x) {
-		    float tmp = coords[k][i] + -1.0f * (coords[k] + i + 1)[x];
-		    dist_accumulator[x] += tmp * tmp;
-		}
-	    }
-
-	    /* convert to 1/d_{ij} */
-	    invert_sqrt_vec(len, dist_accumulator);
-	    /* detect overflows */
-	    for (j = 0; j < len; j++) {
-		if (dist_accumulator[j] >= MAXFLOAT
-		    || dist_accumulator[j] < 0) {
-		    dist_accumulator[j] = 0;
-		}
-	    }
-
-	    count++;		/* save place for the main diagonal entry */
-	    degree = 0;
-	    if (exp == 2) {
-		for (j = 0; j < len; j++, count++) {
-#ifdef Dij2
-		    val = lap1[count] *= dist_accumulator[j];
 #else
-		    val = lap1[count] = dist_accumulator[j];
+	lap1_mult_rows(coords, dim, n, exp, lap2, b, degrees,
+		       dist_accumulator, 0, n);
 #endif
-		    degree += val;
-		    degrees[i + j + 1] -= val;
-		}
-	    } else {
-		for (j = 0; j < len; j++, count++) {
-		    val = lap1[count] = dist_accumulator[j];
-		    degree += val;
-		    degrees[i + j + 1] -= val;
-		}
-	    }
-	    degrees[i] -= degree;
-	}
-	for (step = n, count = 0, i = 0; i < n; i++, count += step, step--) {
-	    lap1[count] = degrees[i];
-	}
-
-	/* Now compute b[] */
-	for (k = 0; k < dim; k++) {
-	    /* b[k] := lap1*coords[k] */
-	    right_mult_with_vector_ff(lap1, n, coords[k], b[k]);
-	}
-
 
 	/* compute new stress  */
 	/* remember that the Laplacians are negated, so we subtract instead of add and vice versa */
@@ -1220,13 +1409,6 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
 	}
 	new_stress *= 2;
 	new_stress += constant_term;	/* only after mult by 2 */
-#ifdef NONCORE
-	if (n > max_nodes_in_mem) {
-	    /* restore lap2 from memory */
-	    fsetpos(fp, &pos);
-	    fread(lap2, sizeof(float), lap_length, fp);
-	}
-#endif
 	for (k = 0; k < dim; k++) {
 	    right_mult_with_vector_ff(lap2, n, coords[k], tmp_coords);
 	    new_stress -= vectors_inner_productf(n, coords[k], tmp_coords);
@@ -1273,13 +1455,13 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
 		}
 	    }
 	}
-	if (Verbose && (iterations % 5 == 0)) {
+	if (sp->verbose && (iterations % 5 == 0)) {
 	    fprintf(stderr, "%.3f ", new_stress);
 	    if ((iterations + 5) % 50 == 0)
 		fprintf(stderr, "\n");
 	}
     }
-    if (Verbose) {
+    if (sp->verbose) {
 	fprintf(stderr, "\nfinal e = %f %d iterations %.2f sec\n",
 		compute_stressf(coords, lap2, dim, n, exp),
 		iterations, elapsed_sec());
@@ -1290,10 +1472,6 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
 	    d_coords[i][j] = coords[i][j];
 	}
     }
-#ifdef NONCORE
-    if (fp)
-	fclose(fp);
-#endif
 finish1:
     free(f_storage);
     free(coords);
@@ -1306,6 +1484,29 @@ finish1:
     free(tmp_coords);
     free(dist_accumulator);
     free(degrees);
-    free(lap1);
     return iterations;
 }
+
+/* stress_majorization_kD_mkernel:
+ * At present, if any nodes have pos set, smart_ini is false.
+ */
+int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse representation */
+				   int n,	/* Number of nodes */
+				   int nedges_graph,	/* Number of edges */
+				   double **d_coords,	/* coordinates of nodes (output layout) */
+				   node_t ** nodes,	/* original nodes */
+				   int dim,	/* dimemsionality of layout */
+				   int opts,    /* options */
+				   int model,	/* model */
+				   int maxi	/* max iterations */
+    )
+{
+    stress_kD_t sd;
+    int rv;
+
+    rv = stress_kD_setup(&sd, graph, n, nedges_graph, d_coords, nodes,
+			 dim, opts, model, maxi);
+    if (rv <= 0)
+	return rv;
+    return stress_kD_solve(&sd);
+}
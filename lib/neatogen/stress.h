@@ -53,6 +53,28 @@ extern "C" {
 					      int maxi	/* max iterations */
 	);
 
+    /* State handed from stress_kD_setup to stress_kD_solve */
+    typedef struct {
+	int n;			/* Number of nodes */
+	int dim;		/* dimensionality of layout */
+	int exp;		/* stress weighting exponent */
+	int maxi;		/* max iterations */
+	int havePinned;		/* some node is pinned */
+	boolean verbose;	/* report progress on stderr */
+	double **d_coords;	/* coordinates of nodes (output layout) */
+	node_t **nodes;		/* original nodes */
+	float *Dij;		/* packed distance matrix; freed by solve */
+    } stress_kD_t;
+
+    /* stress_majorization_kD_mkernel in two steps, so that the solve
+     * step of independent components can be run concurrently.
+     */
+    extern int stress_kD_setup(stress_kD_t * sp, vtx_data * graph, int n,
+			       int nedges_graph, double **coords,
+			       node_t ** nodes, int dim, int opts,
+			       int model, int maxi);
+    extern int stress_kD_solve(stress_kD_t * sp);
+
 extern float *compute_apsp_packed(vtx_data * graph, int n);
 extern float *compute_apsp_artifical_weights_packed(vtx_data * graph, int n);
 extern float* circuitModel(vtx_data * graph, int nG);
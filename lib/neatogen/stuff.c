@@ -258,7 +258,7 @@ int scan_graph_mode(graph_t * G, int mode)
 	    ND_heapindex(np) = -1;
 	    total_len += setEdgeLen(G, np, lenx, dfltlen);
 	}
-    } else if (mode == MODE_SGD) {
+    } else if (mode == MODE_SGD || mode == MODE_SPARSE_SGD) {
 	Epsilon = .01;
 	getdouble(G, "epsilon", &Epsilon);
 	GD_neato_nlist(G) = N_NEW(nV + 1, node_t *); // not sure why but sometimes needs the + 1
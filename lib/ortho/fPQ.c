@@ -13,60 +13,66 @@
 #include "config.h"
 #include <common/memory.h>
 #include <assert.h>
+#include <float.h>
 
 #include <ortho/fPQ.h>
 
-static snode**  pq;
-static int     PQcnt;
-static snode    guard;
-static int     PQsize;
+/* Ties on the key go to the node farther from the source: it is
+ * usually the one closer to the target.
+ */
+#define BEFORE(a,b) \
+  ((N_KEY(a) < N_KEY(b)) || ((N_KEY(a) == N_KEY(b)) && (N_VAL(a) > N_VAL(b))))
 
 void
-PQgen(int sz)
+PQgen(PQ* pq, int sz)
 {
-  if (!pq) {
-    pq = N_NEW(sz+1,snode*);
-    pq[0] = &guard;
-    PQsize = sz;
-  }
-  PQcnt = 0;
+  pq->pq = N_NEW(sz+1,snode*);
+  N_KEY(&pq->guard) = -DBL_MAX;
+  N_VAL(&pq->guard) = 0;
+  pq->pq[0] = &pq->guard;
+  pq->PQsize = sz;
+  pq->PQcnt = 0;
 }
 
 void
-PQfree(void)
+PQfree(PQ* pq)
 {
-  free (pq);
-  pq = NULL;
-  PQcnt = 0;
+  free (pq->pq);
+  pq->pq = NULL;
+  pq->PQcnt = 0;
 }
 
 void
-PQinit(void)
+PQinit(PQ* pq)
 {
-  PQcnt = 0;
+  pq->PQcnt = 0;
 }
 
+#ifdef PQCHECK
 void
-PQcheck (void)
+PQcheck (PQ* pq)
 {
   int i;
  
-  for (i = 1; i <= PQcnt; i++) {
-    if (N_IDX(pq[i]) != i) {
+  for (i = 1; i <= pq->PQcnt; i++) {
+    if (N_IDX(pq->pq[i]) != i) {
       assert (0);
     }
   }
 }
+#else
+#define PQcheck(pq)
+#endif
 
 void
-PQupheap(int k)
+PQupheap(PQ* ppq, int k)
 {
+  snode** pq = ppq->pq;
   snode* x = pq[k];
-  int     v = x->n_val;
   int     next = k/2;
   snode*  n;
   
-  while (N_VAL(n = pq[next]) < v) {
+  while (BEFORE(x, n = pq[next])) {
     pq[k] = n;
     N_IDX(n) = k;
     k = next;
@@ -77,38 +83,39 @@ PQupheap(int k)
 }
 
 int
-PQ_insert(snode* np)
+PQ_insert(PQ* pq, snode* np)
 {
-  if (PQcnt == PQsize) {
+  if (pq->PQcnt == pq->PQsize) {
     agerr (AGERR, "Heap overflow\n");
     return (1);
   }
-  PQcnt++;
-  pq[PQcnt] = np;
-  PQupheap (PQcnt);
-  PQcheck();
+  pq->PQcnt++;
+  pq->pq[pq->PQcnt] = np;
+  PQupheap (pq, pq->PQcnt);
+  PQcheck(pq);
   return 0;
 }
 
 void
-PQdownheap (int k)
+PQdownheap (PQ* ppq, int k)
 {
+  snode**   pq = ppq->pq;
   snode*    x = pq[k];
-  int      v = N_VAL(x);
-  int      lim = PQcnt/2;
+  int      cnt = ppq->PQcnt;
+  int      lim = cnt/2;
   snode*    n;
   int      j;
 
   while (k <= lim) {
     j = k+k;
     n = pq[j];
-    if (j < PQcnt) {
-      if (N_VAL(n) < N_VAL(pq[j+1])) {
+    if (j < cnt) {
+      if (BEFORE(pq[j+1], n)) {
         j++;
         n = pq[j];
       }
     }
-    if (v >= N_VAL(n)) break;
+    if (!BEFORE(n, x)) break;
     pq[k] = n;
     N_IDX(n) = k;
     k = j;
@@ -117,41 +124,50 @@ PQdownheap (int k)
   N_IDX(x) = k;
 }
 
+/* PQremove:
+ * Remove and return the node with least key, or NULL if the queue is
+ * empty. The node's index is set to 0, so it can be recognized as
+ * no longer in the queue.
+ */
 snode*
-PQremove (void)
+PQremove (PQ* pq)
 {
   snode* n;
 
-  if (PQcnt) {
-    n = pq[1];
-    pq[1] = pq[PQcnt];
-    PQcnt--;
-    if (PQcnt) PQdownheap (1);
-    PQcheck();
+  if (pq->PQcnt) {
+    n = pq->pq[1];
+    pq->pq[1] = pq->pq[pq->PQcnt];
+    pq->PQcnt--;
+    if (pq->PQcnt) PQdownheap (pq, 1);
+    PQcheck(pq);
+    N_IDX(n) = 0;
     return n;
   }
   else return 0;
 }
 
+/* PQupdate:
+ * Lower the key of n, which must be in the queue, to d.
+ */
 void
-PQupdate (snode* n, int d)
+PQupdate (PQ* pq, snode* n, double d)
 {
-  N_VAL(n) = d;
-  PQupheap (n->n_idx);
-  PQcheck();
+  N_KEY(n) = d;
+  PQupheap (pq, n->n_idx);
+  PQcheck(pq);
 }
 
 void
-PQprint (void)
+PQprint (PQ* pq)
 {
   int    i;
   snode*  n;
 
   fprintf (stderr, "Q: ");
-  for (i = 1; i <= PQcnt; i++) {
-    n = pq[i];
-    fprintf (stderr, "%d(%d:%d) ",  
-      n->index, N_IDX(n), N_VAL(n));
+  for (i = 1; i <= pq->PQcnt; i++) {
+    n = pq->pq[i];
+    fprintf (stderr, "%d(%d:%f) ",  
+      n->index, N_IDX(n), N_KEY(n));
   }
   fprintf (stderr, "\n");
 }
@@ -263,6 +263,17 @@ createSEdges (cell* cp, sgraph* g)
 	wt = BIG;
     }
 
+    /* The estimate in shortPath is the Manhattan distance between segment
+     * midpoints, scaled by g->hscale. Lower the scale if crossing this cell
+     * can cost less than that distance.
+     */
+    if (hwt < bb.UR.x-bb.LL.x)
+	g->hscale = MIN(g->hscale, hwt/(bb.UR.x-bb.LL.x));
+    if (vwt < bb.UR.y-bb.LL.y)
+	g->hscale = MIN(g->hscale, vwt/(bb.UR.y-bb.LL.y));
+    if (wt < ((bb.UR.x-bb.LL.x) + (bb.UR.y-bb.LL.y))/2.0)
+	g->hscale = MIN(g->hscale, 2*wt/((bb.UR.x-bb.LL.x) + (bb.UR.y-bb.LL.y)));
+
     if (cp->sides[M_LEFT] && cp->sides[M_TOP])
 	cp->edges[cp->nedges++] = createSEdge (g, cp->sides[M_LEFT], cp->sides[M_TOP], wt);
     if (cp->sides[M_TOP] && cp->sides[M_RIGHT])
@@ -341,6 +352,8 @@ mkMazeGraph (maze* mp, boxf bb)
 	    pt.y = cp->bb.LL.y;
 	    np = findSVert (g, vdict, pt, ditems, TRUE);
 	    np->cells[0] = cp;
+	    np->mid.x = pt.x;
+	    np->mid.y = (cp->bb.LL.y + cp->bb.UR.y)/2;
 	    cp->sides[M_RIGHT] = np;
 	}
 	if (cp->bb.UR.y < bb.UR.y) {
@@ -348,16 +361,22 @@ mkMazeGraph (maze* mp, boxf bb)
 	    pt.y = cp->bb.UR.y;
 	    np = findSVert (g, hdict, pt, ditems, FALSE);
 	    np->cells[0] = cp;
+	    np->mid.x = (cp->bb.LL.x + cp->bb.UR.x)/2;
+	    np->mid.y = pt.y;
 	    cp->sides[M_TOP] = np;
 	}
 	if (cp->bb.LL.x > bb.LL.x) {
 	    np = findSVert (g, vdict, cp->bb.LL, ditems, TRUE);
 	    np->cells[1] = cp;
+	    np->mid.x = cp->bb.LL.x;
+	    np->mid.y = (cp->bb.LL.y + cp->bb.UR.y)/2;
 	    cp->sides[M_LEFT] = np;
 	}
 	if (cp->bb.LL.y > bb.LL.y) {
 	    np = findSVert (g, hdict, cp->bb.LL, ditems, FALSE);
 	    np->cells[1] = cp;
+	    np->mid.x = (cp->bb.LL.x + cp->bb.UR.x)/2;
+	    np->mid.y = cp->bb.LL.y;
 	    cp->sides[M_BOTTOM] = np;
 	}
     }
@@ -499,6 +518,23 @@ mkMaze (graph_t* g, int doLbls)
     return mp;
 }
 
+static void
+freeChans (chanList* cl)
+{
+    int i;
+
+    if (!cl) return;
+    for (i = 0; i < cl->cnt; i++) {
+	channel* cp = cl->chans[i];
+	if (cp->G) free_graph (cp->G);
+	free (cp->seg_list);
+	free (cp);
+    }
+    free (cl->chans);
+    free (cl->items);
+    free (cl);
+}
+
 void freeMaze (maze* mp)
 {
     free (mp->cells[0].sides);
@@ -506,8 +542,8 @@ void freeMaze (maze* mp)
     free (mp->cells);
     free (mp->gcells);
     freeSGraph (mp->sg);
-    dtclose (mp->hchans);
-    dtclose (mp->vchans);
+    freeChans (mp->hchans);
+    freeChans (mp->vchans);
     free (mp);
 }
 
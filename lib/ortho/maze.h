@@ -46,8 +46,8 @@ typedef struct {
   cell* cells;     /* cells not corresponding to graph nodes */
   cell* gcells;    /* cells corresponding to graph nodes */
   sgraph* sg;
-  Dt_t* hchans;
-  Dt_t* vchans;
+  chanList* hchans;
+  chanList* vchans;
 } maze;
 
 extern maze* mkMaze (graph_t*, int);
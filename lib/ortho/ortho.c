@@ -240,102 +240,68 @@ convertSPtoRoute (sgraph* g, snode* fst, snode* lst)
     return rte;
 }
 
-typedef struct {
-    Dtlink_t  link;
-    double    v;
-    Dt_t*     chans;
-} chanItem;
-
-static void
-freeChannel (Dt_t* d, channel* cp, Dtdisc_t* disc)
-{
-    free_graph (cp->G);
-    free (cp->seg_list);
-    free (cp);
-}
-
-static void
-freeChanItem (Dt_t* d, chanItem* cp, Dtdisc_t* disc)
+/* chanCmp:
+ * Order channels by common coordinate, then by p1. The channels
+ * with a given coordinate are disjoint, so this is a total order.
+ */
+static int
+chanCmp (double v1, double v2, channel* cp1, channel* cp2)
 {
-    dtclose (cp->chans);
-    free (cp);
+  if (v1 > v2) return 1;
+  else if (v1 < v2) return -1;
+  else if (cp1->p.p1 > cp2->p.p1) return 1;
+  else if (cp1->p.p1 < cp2->p.p1) return -1;
+  else return 0;
 }
 
-/* chancmpid:
- * Compare intervals. Two intervals are equal if one contains
- * the other. Otherwise, the one with the smaller p1 value is
- * less. 
- * This combines two separate functions into one. Channels are
- * disjoint, so we really only need to key on p1.
- * When searching for a channel containing a segment, we rely on
- * interval containment to return the correct channel.
- */
 static int
-chancmpid(Dt_t* d, paird* key1, paird* key2, Dtdisc_t* disc)
+hchancmp (channel** cp1, channel** cp2)
 {
-  if (key1->p1 > key2->p1) {
-    if (key1->p2 <= key2->p2) return 0;
-    else return 1;
-  }
-  else if (key1->p1 < key2->p1) {
-    if (key1->p2 >= key2->p2) return 0;
-    else return -1;
-  }
-  else return 0;
-}   
+  return chanCmp ((*cp1)->cp->bb.LL.y, (*cp2)->cp->bb.LL.y, *cp1, *cp2);
+}
 
 static int
-dcmpid(Dt_t* d, double* key1, double* key2, Dtdisc_t* disc)
+vchancmp (channel** cp1, channel** cp2)
 {
-  if (*key1 > *key2) return 1;
-  else if (*key1 < *key2) return -1;
-  else return 0;
-}   
-
-static Dtdisc_t chanDisc = {
-    offsetof(channel,p),
-    sizeof(paird),
-    offsetof(channel,link),
-    0,
-    (Dtfree_f)freeChannel,
-    (Dtcompar_f)chancmpid,
-    0,
-    0,
-    0
-};
-
-static Dtdisc_t chanItemDisc = {
-    offsetof(chanItem,v),
-    sizeof(double),
-    offsetof(chanItem,link),
-    0,
-    (Dtfree_f)freeChanItem,
-    (Dtcompar_f)dcmpid,
-    0,
-    0,
-    0
-};
+  return chanCmp ((*cp1)->cp->bb.LL.x, (*cp2)->cp->bb.LL.x, *cp1, *cp2);
+}
 
-static void
-addChan (Dt_t* chdict, channel* cp, double j)
+/* mkChanList:
+ * Sort the channels and group those with a common coordinate. The
+ * array chans is taken over by the list.
+ */
+static chanList*
+mkChanList (channel** chans, int cnt, boolean isVert)
 {
-    chanItem* subd = dtmatch (chdict, &j);
+    chanList* cl = NEW(chanList);
+    chanItem* ip = NULL;
+    int i;
 
-    if (!subd) {
-	subd = NEW (chanItem);
-	subd->v = j;
-	subd->chans = dtopen (&chanDisc, Dtoset);
-	dtinsert (chdict, subd);
+    qsort (chans, cnt, sizeof(channel*),
+	(qsort_cmpf)(isVert ? vchancmp : hchancmp));
+    cl->cnt = cnt;
+    cl->chans = chans;
+    cl->items = N_NEW(cnt, chanItem);
+    for (i = 0; i < cnt; i++) {
+	cell* cp = chans[i]->cp;
+	double v = (isVert ? cp->bb.LL.x : cp->bb.LL.y);
+	if (!ip || (ip->v != v)) {
+	    ip = cl->items + cl->nitems++;
+	    ip->v = v;
+	    ip->chans = chans + i;
+	}
+	ip->cnt++;
     }
-    dtinsert (subd->chans, cp);
+    return cl;
 }
 
-static Dt_t*
+static chanList*
 extractHChans (maze* mp)
 {
     int i;
     snode* np;
-    Dt_t* hchans = dtopen (&chanItemDisc, Dtoset);
+    int cnt = 0;
+    channel** hchans = N_NEW(mp->ncells, channel*);
 
     for (i = 0; i < mp->ncells; i++) {
 	channel* chp;
@@ -362,17 +328,18 @@ extractHChans (maze* mp)
 	}
 
         chp->p.p2 = cp->bb.UR.x;
-	addChan (hchans, chp, chp->cp->bb.LL.y);
+	hchans[cnt++] = chp;
     }
-    return hchans;
+    return mkChanList (hchans, cnt, FALSE);
 }
 
-static Dt_t*
+static chanList*
 extractVChans (maze* mp)
 {
     int i;
     snode* np;
-    Dt_t* vchans = dtopen (&chanItemDisc, Dtoset);
+    int cnt = 0;
+    channel** vchans = N_NEW(mp->ncells, channel*);
 
     for (i = 0; i < mp->ncells; i++) {
 	channel* chp;
@@ -399,9 +366,9 @@ extractVChans (maze* mp)
 	}
 
         chp->p.p2 = cp->bb.UR.y;
-	addChan (vchans, chp, chp->cp->bb.LL.x);
+	vchans[cnt++] = chp;
     }
-    return vchans;
+    return mkChanList (vchans, cnt, TRUE);
 }
 
 static void
@@ -412,15 +379,37 @@ insertChan (channel* chan, segment* seg)
     chan->seg_list[chan->cnt-1] = seg;
 }
 
+/* chanSearch:
+ * Return the channel containing seg: among the channels with the
+ * segment's common coordinate, the last one starting at or before it.
+ */
 static channel*
-chanSearch (Dt_t* chans, segment* seg)
+chanSearch (chanList* cl, segment* seg)
 {
-  channel* cp;
-  chanItem* chani = dtmatch (chans, &seg->comm_coord);
-  assert (chani);
-  cp = dtmatch (chani->chans, &seg->p);
-  assert (cp);
-  return cp;
+  chanItem* ip = NULL;
+  int lo, hi, mid;
+
+  lo = 0;
+  hi = cl->nitems - 1;
+  while (lo <= hi) {
+    mid = (lo + hi)/2;
+    if (cl->items[mid].v < seg->comm_coord) lo = mid + 1;
+    else if (cl->items[mid].v > seg->comm_coord) hi = mid - 1;
+    else {
+      ip = cl->items + mid;
+      break;
+    }
+  }
+  assert (ip);
+
+  lo = 0;
+  hi = ip->cnt - 1;
+  while (lo < hi) {
+    mid = (lo + hi + 1)/2;
+    if (ip->chans[mid]->p.p1 <= seg->p.p1) lo = mid;
+    else hi = mid - 1;
+  }
+  return ip->chans[lo];
 }
 
 static void
@@ -549,45 +538,47 @@ dumpChanG (channel* cp, int v)
 }
 #endif
 
+/* assignTrackNo:
+ * Number the segments of each channel by a topological sort of its
+ * constraint graph. The channels are independent, so this is done in
+ * parallel when built with OpenMP.
+ */
 static void
-assignTrackNo (Dt_t* chans)
+assignTrackNo (chanList* cl)
 {
-    Dt_t* lp;
-    Dtlink_t* l1;
-    Dtlink_t* l2;
-    channel* cp;
-    int k;
-
-    for (l1 = dtflatten (chans); l1; l1 = dtlink(chans,l1)) {
-	lp = ((chanItem*)l1)->chans;
-	for (l2 = dtflatten (lp); l2; l2 = dtlink(lp,l2)) {
-	    cp = (channel*)l2;
-	    if (cp->cnt) {
+    int i, k;
+
 #ifdef DEBUG
-    if (odb_flags & ODB_CHANG) dumpChanG (cp, ((chanItem*)l1)->v);
+    if (odb_flags & ODB_CHANG) {
+	int j;
+	for (i = 0; i < cl->nitems; i++) {
+	    chanItem* ip = cl->items+i;
+	    for (j = 0; j < ip->cnt; j++)
+		if (ip->chans[j]->cnt) dumpChanG (ip->chans[j], ip->v);
+	}
+    }
 #endif
-		top_sort (cp->G);
-		for (k=0;k<cp->cnt;k++)
-		    cp->seg_list[k]->track_no = cp->G->vertices[k].topsort_order+1;
-	    }
-   	}
+#ifdef _OPENMP
+#pragma omp parallel for private(k) schedule(dynamic, 16)
+#endif
+    for (i = 0; i < cl->cnt; i++) {
+	channel* cp = cl->chans[i];
+	if (cp->cnt) {
+	    top_sort (cp->G);
+	    for (k=0;k<cp->cnt;k++)
+		cp->seg_list[k]->track_no = cp->G->vertices[k].topsort_order+1;
+	}
     }
 }
 
 static void
-create_graphs(Dt_t* chans)
+create_graphs(chanList* cl)
 {
-    Dt_t* lp;
-    Dtlink_t* l1;
-    Dtlink_t* l2;
-    channel* cp;
-
-    for (l1 = dtflatten (chans); l1; l1 = dtlink(chans,l1)) {
-	lp = ((chanItem*)l1)->chans;
-	for (l2 = dtflatten (lp); l2; l2 = dtlink(lp,l2)) {
-	    cp = (channel*)l2;
-	    cp->G = make_graph (cp->cnt);
-   	}
+    int i;
+
+    for (i = 0; i < cl->cnt; i++) {
+	channel* cp = cl->chans[i];
+	cp->G = make_graph (cp->cnt);
     }
 }
 
@@ -702,6 +693,18 @@ segCmp (segment* S1, segment* S2, bend T1, bend T2)
     return 0;
 }
 
+/* segCmpDir:
+ * seg_cmp, without checking that the segments are comparable.
+ */
+static int
+segCmpDir (segment* S1, segment* S2)
+{
+    if(S1->isVert)
+	return segCmp (S1, S2, B_RIGHT, B_LEFT);
+    else
+	return segCmp (S1, S2, B_DOWN, B_UP);
+}
+
 /* Function seg_cmp returns
  *  -1 if S1 HAS TO BE to the right/below S2 to avoid a crossing, 
  *   0 if a crossing is unavoidable or there is no crossing at all or 
@@ -723,12 +726,14 @@ seg_cmp(segment* S1, segment* S2)
 	agerr (AGERR, "incomparable segments !! -- Aborting\n");
 	longjmp(jbuf, 1);
     }
-    if(S1->isVert)
-	return segCmp (S1, S2, B_RIGHT, B_LEFT);
-    else
-	return segCmp (S1, S2, B_DOWN, B_UP);
+    return segCmpDir (S1, S2);
 }
 
+/* add_edges_in_G:
+ * The segments of a channel share their orientation and common
+ * coordinate, so they are compared without the check of seg_cmp: its
+ * longjmp must not leave the parallel loop of add_np_edges.
+ */
 static void 
 add_edges_in_G(channel* cp)
 {
@@ -739,7 +744,7 @@ add_edges_in_G(channel* cp)
 
     for(x=0;x+1<size;x++) {
 	for(y=x+1;y<size;y++) {
-	    switch (seg_cmp(seg_list[x],seg_list[y])) {
+	    switch (segCmpDir(seg_list[x],seg_list[y])) {
 	    case 1:
 		insert_edge(G,x,y);
 		break;
@@ -753,21 +758,22 @@ add_edges_in_G(channel* cp)
     }
 }
 
+/* add_np_edges:
+ * Each channel's graph only depends on its own segments, so the
+ * channels are done in parallel when built with OpenMP.
+ */
 static void
-add_np_edges (Dt_t* chans)
+add_np_edges (chanList* cl)
 {
-    Dt_t* lp;
-    Dtlink_t* l1;
-    Dtlink_t* l2;
-    channel* cp;
-
-    for (l1 = dtflatten (chans); l1; l1 = dtlink(chans,l1)) {
-	lp = ((chanItem*)l1)->chans;
-	for (l2 = dtflatten (lp); l2; l2 = dtlink(lp,l2)) {
-	    cp = (channel*)l2;
-	    if (cp->cnt)
-		add_edges_in_G(cp);
-   	}
+    int i;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+    for (i = 0; i < cl->cnt; i++) {
+	channel* cp = cl->chans[i];
+	if (cp->cnt)
+	    add_edges_in_G(cp);
     }
 }
 
@@ -1053,19 +1059,17 @@ addPEdges (channel* cp, maze* mp)
     }
 }
 
+/* add_p_edges:
+ * Unlike the other passes, this one is serial: resolving parallel
+ * segments adds and removes edges in the graphs of other channels.
+ */
 static void 
-add_p_edges (Dt_t* chans, maze* mp)
+add_p_edges (chanList* cl, maze* mp)
 {
-    Dt_t* lp;
-    Dtlink_t* l1;
-    Dtlink_t* l2;
-
-    for (l1 = dtflatten (chans); l1; l1 = dtlink(chans,l1)) {
-	lp = ((chanItem*)l1)->chans;
-	for (l2 = dtflatten (lp); l2; l2 = dtlink(lp,l2)) {
-	    addPEdges ((channel*)l2, mp);
-   	}
-    }
+    int i;
+
+    for (i = 0; i < cl->cnt; i++)
+	addPEdges (cl->chans[i], mp);
 }
 
 static void
@@ -1205,7 +1209,7 @@ static boolean swap_ends_p(edge_t * e)
     return FALSE;
 }
 
-static splineInfo sinfo = { swap_ends_p, spline_merge, 1, 1 };
+static splineInfo sinfo = { swap_ends_p, spline_merge, 1, 1, FALSE };
 
 /* orthoEdges:
  * For edges without position information, construct an orthogonal routing.
@@ -1216,6 +1220,7 @@ void
 orthoEdges (Agraph_t* g, int doLbls)
 {
     sgraph* sg;
+    PQ pq;
     maze* mp;
     int n_edges;
     route* route_list;
@@ -1299,7 +1304,7 @@ orthoEdges (Agraph_t* g, int doLbls)
     qsort((char *)es, n_edges, sizeof(epair_t), (qsort_cmpf) edgecmp);
 
     gstart = sg->nnodes;
-    PQgen (sg->nnodes+2);
+    PQgen (&pq, sg->nnodes+2);
     sn = &sg->nodes[gstart];
     dn = &sg->nodes[gstart+1];
     for (i = 0; i < n_edges; i++) {
@@ -1319,13 +1324,16 @@ orthoEdges (Agraph_t* g, int doLbls)
        		addNodeEdges (sg, dest, dn);
 		addNodeEdges (sg, start, sn);
 	    }
-       	    if (shortPath (sg, dn, sn)) goto orthofinish;
+       	    if (shortPath (&pq, sg, dn, sn, &start->bb)) {
+		PQfree (&pq);
+		goto orthofinish;
+	    }
 	}
 	    
        	route_list[i] = convertSPtoRoute(sg, sn, dn);
        	reset (sg);
     }
-    PQfree ();
+    PQfree (&pq);
 
     mp->hchans = extractHChans (mp);
     mp->vchans = extractVChans (mp);
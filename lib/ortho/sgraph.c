@@ -94,16 +94,25 @@ gsave (sgraph* G)
 	G->nodes[i].save_n_adj =  G->nodes[i].n_adj;
 }
 
+/* reset:
+ * Remove the two temporary nodes and their edges. Only the nodes
+ * adjacent to the temporary ones need their edge count restored.
+ */
 void 
 reset(sgraph* G)
 {
-    int i;
+    int i, j;
+    for (i = G->save_nnodes; i < G->save_nnodes+2; i++) {
+	snode* np = G->nodes+i;
+	for (j = 0; j < np->n_adj; j++) {
+	    sedge* e = G->edges+np->adj_edge_list[j];
+	    snode* onp = G->nodes + (e->v1 == i ? e->v2 : e->v1);
+	    onp->n_adj = onp->save_n_adj;
+	}
+	np->n_adj = 0;
+    }
     G->nnodes = G->save_nnodes;
     G->nedges = G->save_nedges;
-    for (i = 0; i < G->nnodes; i++)
-	G->nodes[i].n_adj = G->nodes[i].save_n_adj;
-    for (; i < G->nnodes+2; i++)
-	G->nodes[i].n_adj = 0;
 }
 
 void
@@ -129,6 +138,8 @@ createSGraph (int nnodes)
 
 	/* create the nodes vector in the search graph */
     g->nnodes = 0;
+    g->gen = 0;
+    g->hscale = 1.0;
     g->nodes = N_NEW(nnodes, snode);
     return g;
 }
@@ -179,26 +190,21 @@ freeSGraph (sgraph* g)
 #include <ortho/fPQ.h>
 
 /* shortest path:
- * Constructs the path of least weight between from and to.
- * 
- * Assumes graph, node and edge type, and that nodes
- * have associated values N_VAL, N_IDX, and N_DAD, the first two
- * being ints, the last being a node*. Edges have a E_WT function 
- * to specify the edge length or weight.
+ * Constructs the path of least weight between from and to, using A*
+ * search. If bb is non-NULL, every node adjacent to to must lie on
+ * its boundary, and the Manhattan distance from the midpoint of a node's
+ * segment to bb, scaled by g->hscale, is the estimate of the remaining
+ * cost. This requires that an edge between two segment nodes never
+ * weighs less than g->hscale times the Manhattan distance between their
+ * midpoints. If bb is NULL, the search is plain Dijkstra.
  * 
- * Assumes there are functions:
- *  agnnodes: graph -> int           number of nodes in the graph
- *  agfstnode, agnxtnode : iterators over the nodes in the graph
- *  agfstedge, agnxtedge : iterators over the edges attached to a node
- *  adjacentNode : given an edge e and an endpoint n of e, returns the
- *                 other endpoint.
+ * Node state is valid only if N_GEN(n) == g->gen, so there is no need to
+ * clear it before each search.
  * 
  * The path is given by
  *  to, N_DAD(to), N_DAD(N_DAD(to)), ..., from
  */
 
-#define UNSEEN INT_MIN
-
 static snode*
 adjacentNode(sgraph* g, sedge* e, snode* n)
 {
@@ -208,61 +214,75 @@ adjacentNode(sgraph* g, sedge* e, snode* n)
 	return (&(g->nodes[e->v1]));
 }
 
+static double
+estimate (sgraph* g, snode* n, snode* to, boxf* bb)
+{
+    double dx, dy;
+
+    if (!bb || n == to) return 0;
+    if (n->mid.x < bb->LL.x) dx = bb->LL.x - n->mid.x;
+    else if (n->mid.x > bb->UR.x) dx = n->mid.x - bb->UR.x;
+    else dx = 0;
+    if (n->mid.y < bb->LL.y) dy = bb->LL.y - n->mid.y;
+    else if (n->mid.y > bb->UR.y) dy = n->mid.y - bb->UR.y;
+    else dy = 0;
+    return g->hscale*(dx + dy);
+}
+
 int
-shortPath (sgraph* g, snode* from, snode* to)
+shortPath (PQ* pq, sgraph* g, snode* from, snode* to, boxf* bb)
 {
     snode* n;
     sedge* e;
     snode* adjn;
-    int d;
+    double d;
     int   x, y;
 
-    for (x = 0; x<g->nnodes; x++) {
-	snode* temp;
-	temp = &(g->nodes[x]);
-	N_VAL(temp) = UNSEEN;
+    if (g->gen == INT_MAX) {
+	for (x = 0; x < g->nnodes; x++)
+	    N_GEN(&(g->nodes[x])) = 0;
+	g->gen = 0;
     }
-    
-    PQinit();
-    if (PQ_insert (from)) return 1;
+    g->gen++;
+
+    PQinit(pq);
+    N_GEN(from) = g->gen;
     N_DAD(from) = NULL;
     N_VAL(from) = 0;
+    N_KEY(from) = 0;
+    if (PQ_insert (pq, from)) return 1;
     
-    while ((n = PQremove())) {
+    while ((n = PQremove(pq))) {
 #ifdef DEBUG
 	fprintf (stderr, "process %d\n", n->index);
 #endif
-	N_VAL(n) *= -1;
 	if (n == to) break;
 	for (y=0; y<n->n_adj; y++) {
 	    e = &(g->edges[n->adj_edge_list[y]]);
 	    adjn = adjacentNode(g, e, n);
-	    if (N_VAL(adjn) < 0) {
-		d = -(N_VAL(n) + E_WT(e));
-		if (N_VAL(adjn) == UNSEEN) {
+	    d = N_VAL(n) + E_WT(e);
+	    if (N_GEN(adjn) != g->gen) {
 #ifdef DEBUG
-		    fprintf (stderr, "new %d (%d)\n", adjn->index, -d);
+		fprintf (stderr, "new %d (%f)\n", adjn->index, d);
 #endif
-		    N_VAL(adjn) = d;
-		    if (PQ_insert(adjn)) return 1;
-		    N_DAD(adjn) = n;
-		    N_EDGE(adjn) = e;
-            	}
-		else {
-		    if (N_VAL(adjn) < d) {
+		N_GEN(adjn) = g->gen;
+		N_VAL(adjn) = d;
+		N_KEY(adjn) = d + estimate(g, adjn, to, bb);
+		if (PQ_insert(pq, adjn)) return 1;
+		N_DAD(adjn) = n;
+		N_EDGE(adjn) = e;
+	    }
+	    else if (N_IDX(adjn) && (d < N_VAL(adjn))) {
 #ifdef DEBUG
-			fprintf (stderr, "adjust %d (%d)\n", adjn->index, -d);
+		fprintf (stderr, "adjust %d (%f)\n", adjn->index, d);
 #endif
-			PQupdate(adjn, d);
-			N_DAD(adjn) = n;
-			N_EDGE(adjn) = e;
-		    }
-		}
+		N_VAL(adjn) = d;
+		PQupdate(pq, adjn, d + estimate(g, adjn, to, bb));
+		N_DAD(adjn) = n;
+		N_EDGE(adjn) = e;
 	    }
 	}
     }
 
-    /* PQfree(); */
     return 0;
 }
-
@@ -15,9 +15,13 @@
 
 typedef struct snode snode;
 typedef struct sedge sedge;
+typedef struct PQ PQ;  /* priority queue of the search; see fPQ.h */
 
 struct snode {
-  int n_val, n_idx;
+  double n_val;  /* cost of the best path found from the source */
+  double n_key;  /* n_val plus the estimated cost to the target */
+  int n_idx;     /* position in the priority queue; 0 if not in it */
+  int n_gen;     /* search in which the fields above were last set */
   snode* n_dad;
   sedge* n_edge;
   short   n_adj;
@@ -30,6 +34,7 @@ struct snode {
   int* adj_edge_list;  
   int index;
   boolean isVert;  /* true if node corresponds to vertical segment */
+  pointf mid;      /* midpoint of the segment */
 };
 
 struct sedge {
@@ -44,6 +49,8 @@ struct sedge {
 typedef struct {
   int nnodes, nedges;
   int save_nnodes, save_nedges;
+  int gen;         /* current search; stale node state has n_gen < gen */
+  double hscale;   /* scale of the distance estimate, so it is a lower bound */
   snode* nodes;
   sedge* edges;
 } sgraph;
@@ -53,7 +60,7 @@ extern void gsave(sgraph*);
 extern sgraph* createSGraph(int);
 extern void freeSGraph (sgraph*);
 extern void initSEdges (sgraph* g, int maxdeg);
-extern int shortPath (sgraph* g, snode* from, snode* to);
+extern int shortPath (PQ* pq, sgraph* g, snode* from, snode* to, boxf* bb);
 extern snode* createSNode (sgraph*);
 extern sedge* createSEdge (sgraph* g, snode* v0, snode* v1, double wt);
 
@@ -50,7 +50,6 @@ typedef struct {
 } route;
 
 typedef struct {
-  Dtlink_t link;
   paird p;   /* extrema of channel */
   int cnt;   /* number of segments */
   segment** seg_list; /* array of segment pointers */
@@ -58,6 +57,21 @@ typedef struct {
   struct cell* cp;
 } channel;
 
+/* channels sharing a common coordinate */
+typedef struct {
+  double v;          /* the common coordinate */
+  int cnt;           /* number of channels */
+  channel** chans;   /* channels sorted by p.p1 */
+} chanItem;
+
+/* all horizontal or all vertical channels */
+typedef struct {
+  int nitems;
+  chanItem* items;   /* sorted by v */
+  int cnt;           /* number of channels */
+  channel** chans;   /* channels sorted by v, then p.p1; items point into it */
+} chanList;
+
 #if 0
 typedef struct {
   int i1, i2, j;
@@ -60,6 +60,11 @@ vconfig_t *Pobsopen(Ppoly_t ** obs, int n_obs)
     rv->prev = mymalloc(n * sizeof(int));
     rv->N = n;
     rv->Npoly = n_obs;
+    for (i = 0; i < VCACHE_SIZE; i++) {
+	rv->cache[i].vis = NULL;
+	rv->cache[i].used = 0;
+    }
+    rv->clock = 0;
 
     /* build arrays */
     i = 0;
@@ -83,17 +88,48 @@ vconfig_t *Pobsopen(Ppoly_t ** obs, int n_obs)
 
 void Pobsclose(vconfig_t * config)
 {
+    int i;
+
     free(config->P);
     free(config->start);
     free(config->next);
     free(config->prev);
-    if (config->vis) {
-	free(config->vis[0]);
-	free(config->vis);
-    }
+    freeVisibility(config);
+    for (i = 0; i < VCACHE_SIZE; i++)
+	free(config->cache[i].vis);
     free(config);
 }
 
+/* cachedPtVis:
+ * Return the visibility vector of point p in polygon poly, computing
+ * it with ptVis only if it is not among those of recent calls. Edges
+ * sharing an endpoint node are usually routed one after another.
+ * The least recently used vector makes room for a new one, so the one
+ * returned by the previous call stays valid.
+ */
+static COORD *cachedPtVis(vconfig_t * config, int poly, Ppoint_t p)
+{
+    vcache_t *c;
+    vcache_t *lru = config->cache;
+    int i;
+
+    for (i = 0; i < VCACHE_SIZE; i++) {
+	c = config->cache + i;
+	if (c->used && c->poly == poly && c->p.x == p.x && c->p.y == p.y) {
+	    c->used = ++config->clock;
+	    return c->vis;
+	}
+	if (c->used < lru->used)
+	    lru = c;
+    }
+    free(lru->vis);
+    lru->poly = poly;
+    lru->p = p;
+    lru->vis = ptVis(config, poly, p);
+    lru->used = ++config->clock;
+    return lru->vis;
+}
+
 int Pobspath(vconfig_t * config, Ppoint_t p0, int poly0, Ppoint_t p1,
 	     int poly1, Ppolyline_t * output_route)
 {
@@ -105,8 +141,20 @@ int Pobspath(vconfig_t * config, Ppoint_t p0, int poly0, Ppoint_t p1,
 #ifdef GASP
     gasp_print_obstacles(config);
 #endif
-    ptvis0 = ptVis(config, poly0, p0);
-    ptvis1 = ptVis(config, poly1, p1);
+    /* The endpoint vectors are only needed if p0 cannot see p1 */
+    if (directVis(p0, poly0, p1, poly1, config)) {
+	ops = malloc(2 * sizeof(Ppoint_t));
+	ops[0] = p0;
+	ops[1] = p1;
+	output_route->pn = 2;
+	output_route->ps = ops;
+#ifdef GASP
+	gasp_print_polyline(output_route);
+#endif
+	return TRUE;
+    }
+    ptvis0 = cachedPtVis(config, poly0, p0);
+    ptvis1 = cachedPtVis(config, poly1, p1);
 
 #ifdef GASP
     gasp_print_point(p0);
@@ -134,9 +182,6 @@ int Pobspath(vconfig_t * config, Ppoint_t p0, int poly0, Ppoint_t p1,
     printDad(dad, config->N + 1);
 #endif
 
-    free(ptvis0);
-    free(ptvis1);
-
     output_route->pn = opn;
     output_route->ps = ops;
 #ifdef GASP
@@ -60,6 +60,10 @@ static elist_t *elist;
 
 static Ppoint_t *ops;
 static int opn, opl;
+#ifdef _OPENMP
+/* dot routes independent edges concurrently, each thread with its own work space */
+#pragma omp threadprivate(jbuf, ops, opn, opl)
+#endif
 
 static int reallyroutespline(Pedge_t *, int,
 			     Ppoint_t *, int, Ppoint_t, Ppoint_t);
@@ -195,6 +199,9 @@ static int reallyroutespline(Pedge_t * edges, int edgen,
 
     static tna_t *tnas;
     static int tnan;
+#ifdef _OPENMP
+#pragma omp threadprivate(tnas, tnan)
+#endif
 
     if (tnan < inpn) {
 	if (!(tnas = realloc(tnas, sizeof(tna_t) * inpn)))
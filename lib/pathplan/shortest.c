@@ -70,6 +70,10 @@ static deque_t dq;
 
 static Ppoint_t *ops;
 static int opn;
+#ifdef _OPENMP
+/* dot routes independent edges concurrently, each thread with its own work space */
+#pragma omp threadprivate(pnls, pnlps, pnln, pnll, tris, trin, tril, dq, ops, opn)
+#endif
 
 static int triangulate(pointnlink_t **, int);
 static int isdiagonal(int, int, pointnlink_t **, int);
@@ -76,6 +76,9 @@ make_polyline(Ppolyline_t line, Ppolyline_t* sline)
 {
     static int isz = 0;
     static Ppoint_t* ispline = 0;
+#ifdef _OPENMP
+#pragma omp threadprivate(isz, ispline)
+#endif
     int i, j;
     int npts = 4 + 3*(line.pn-2);
 
@@ -32,6 +32,29 @@ extern "C" {
 #define	CW			0
 #define	CCW			1
 
+    /* Uniform grid over the barrier edges, edge k running from P[k]
+     * to P[next[k]]. Each edge is listed in every cell its bounding
+     * box meets.
+     */
+    typedef struct {
+	int nx, ny;		/* number of columns and rows */
+	Ppoint_t ll;		/* lower left corner */
+	COORD w, h;		/* cell width and height */
+	COORD eps;		/* slack for rounding in cell lookups */
+	int *cell;		/* edges of cell c are edge[cell[c]..cell[c+1]-1] */
+	int *edge;
+    } vgrid_t;
+
+    /* Visibility vector of a path endpoint, kept for reuse */
+    typedef struct {
+	int poly;
+	Ppoint_t p;
+	COORD *vis;
+	int used;		/* time of last use; 0 if empty */
+    } vcache_t;
+
+#define	VCACHE_SIZE	8
+
     struct vconfig_s {
 	int Npoly;
 	int N;			/* number of points in walk of barriers */
@@ -42,6 +65,11 @@ extern "C" {
 
 	/* this is computed from the above */
 	array2 vis;
+	vgrid_t grid;
+
+	/* endpoint vectors of recent Pobspath calls */
+	vcache_t cache[VCACHE_SIZE];
+	int clock;
     };
 #ifdef _WIN32
 #ifndef PATHPLAN_EXPORTS
@@ -53,6 +81,7 @@ extern "C" {
 	extern COORD *ptVis(vconfig_t *, int, Ppoint_t);
     extern int directVis(Ppoint_t, int, Ppoint_t, int, vconfig_t *);
     extern void visibility(vconfig_t *);
+    extern void freeVisibility(vconfig_t *);
     extern int *makePath(Ppoint_t p, int pp, COORD * pvis,
 			 Ppoint_t q, int qp, COORD * qvis,
 			 vconfig_t * conf);
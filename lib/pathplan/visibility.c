@@ -10,6 +10,10 @@
 
 
 #include <pathplan/vis.h>
+#include <string.h>
+
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
 
 	/* TRANSPARENT means router sees past colinear obstacles */
 #ifdef TRANSPARENT
@@ -224,23 +228,165 @@ static int inCone(int i, int j, Ppoint_t pts[], int nextPt[], int prevPt[])
     return in_cone(pts[prevPt[i]], pts[i], pts[nextPt[i]], pts[j]);
 }
 
+/* cellOf:
+ * Return the index among n cells of size sz starting at lo
+ * of the cell containing v, clamped to the grid.
+ */
+static int cellOf(COORD v, COORD lo, COORD sz, int n)
+{
+    if (!(v > lo))
+	return 0;
+    v = (v - lo) / sz;
+    if (v >= n)
+	return n - 1;
+    return (int) v;
+}
+
+/* mkGrid:
+ * Bucket the barrier edges of conf in a grid of about one cell per edge,
+ * shaped like the bounding box of the barriers.
+ */
+static void mkGrid(vconfig_t * conf)
+{
+    vgrid_t *g = &conf->grid;
+    int V = conf->N;
+    Ppoint_t *pts = conf->P;
+    int *nextPt = conf->next;
+    Ppoint_t ur, p, q;
+    COORD W, H, cols;
+    int i, j, k, i0, i1, j0, j1, n;
+    int *pos;
+
+    g->ll.x = g->ll.y = ur.x = ur.y = 0;
+    for (k = 0; k < V; k++) {
+	p = pts[k];
+	if (k == 0 || p.x < g->ll.x)
+	    g->ll.x = p.x;
+	if (k == 0 || p.y < g->ll.y)
+	    g->ll.y = p.y;
+	if (k == 0 || p.x > ur.x)
+	    ur.x = p.x;
+	if (k == 0 || p.y > ur.y)
+	    ur.y = p.y;
+    }
+    W = ur.x - g->ll.x;
+    H = ur.y - g->ll.y;
+
+    if (W <= 0)
+	cols = 1;
+    else if (H <= 0)
+	cols = V;
+    else
+	cols = ceil(sqrt(V * (W / H)));
+    g->nx = (cols < 1) ? 1 : ((cols > V) ? MAX(V, 1) : (int) cols);
+    g->ny = MAX((V + g->nx - 1) / g->nx, 1);
+    g->w = (W > 0) ? W / g->nx : 1;
+    g->h = (H > 0) ? H / g->ny : 1;
+    g->eps = 1e-9 * (fabs(g->ll.x) + fabs(g->ll.y) + W + H);
+
+    n = g->nx * g->ny;
+    g->cell = calloc(n + 1, sizeof(int));
+    for (k = 0; k < V; k++) {
+	p = pts[k];
+	q = pts[nextPt[k]];
+	i0 = cellOf(MIN(p.x, q.x), g->ll.x, g->w, g->nx);
+	i1 = cellOf(MAX(p.x, q.x), g->ll.x, g->w, g->nx);
+	j0 = cellOf(MIN(p.y, q.y), g->ll.y, g->h, g->ny);
+	j1 = cellOf(MAX(p.y, q.y), g->ll.y, g->h, g->ny);
+	for (j = j0; j <= j1; j++)
+	    for (i = i0; i <= i1; i++)
+		g->cell[j * g->nx + i + 1]++;
+    }
+    for (i = 0; i < n; i++)
+	g->cell[i + 1] += g->cell[i];
+
+    g->edge = malloc(MAX(g->cell[n], 1) * sizeof(int));
+    pos = malloc(n * sizeof(int));
+    memcpy(pos, g->cell, n * sizeof(int));
+    for (k = 0; k < V; k++) {
+	p = pts[k];
+	q = pts[nextPt[k]];
+	i0 = cellOf(MIN(p.x, q.x), g->ll.x, g->w, g->nx);
+	i1 = cellOf(MAX(p.x, q.x), g->ll.x, g->w, g->nx);
+	j0 = cellOf(MIN(p.y, q.y), g->ll.y, g->h, g->ny);
+	j1 = cellOf(MAX(p.y, q.y), g->ll.y, g->h, g->ny);
+	for (j = j0; j <= j1; j++)
+	    for (i = i0; i <= i1; i++)
+		g->edge[pos[j * g->nx + i]++] = k;
+    }
+    free(pos);
+}
+
 /* clear:
  * Return true if no polygon line segment non-trivially intersects
- * the segment [pti,ptj], ignoring segments in [start,end).
+ * the segment [pti,ptj], ignoring segments in [s1,e1) and [s2,e2).
+ *
+ * Only segments in the grid cells near [pti,ptj] are tested. A segment
+ * blocks only if it crosses [pti,ptj] or has an end c with wind() zero
+ * strictly between pti and ptj. In the latter case, c lies between
+ * the two in x, within .0001/|dx| of the line in y, or, if the line is
+ * vertical, between them in y and within .0001/|dy| of it in x.
+ * Searching twice that far allows for rounding in wind().
  */
-static int clear(Ppoint_t pti, Ppoint_t ptj,
-		 int start, int end,
-		 int V, Ppoint_t pts[], int nextPt[], int prevPt[])
+static int clear(vconfig_t * conf, Ppoint_t pti, Ppoint_t ptj,
+		 int s1, int e1, int s2, int e2)
 {
-    int k;
+    vgrid_t *g = &conf->grid;
+    Ppoint_t *pts = conf->P;
+    int *nextPt = conf->next;
+    COORD dx = ptj.x - pti.x;
+    COORD dy = ptj.y - pti.y;
+    COORD xlo, xhi, x0, x1, y0, y1, t, d;
+    int i, i0, i1, j, j0, j1, m, k;
+    int *cell;
+
+    /* a point sees itself */
+    if (dx == 0 && dy == 0)
+	return 1;
 
-    for (k = 0; k < start; k++) {
-	if (INTERSECT(pti, ptj, pts[k], pts[nextPt[k]], pts[prevPt[k]]))
-	    return 0;
-    }
-    for (k = end; k < V; k++) {
-	if (INTERSECT(pti, ptj, pts[k], pts[nextPt[k]], pts[prevPt[k]]))
-	    return 0;
+    xlo = MIN(pti.x, ptj.x) - g->eps;
+    xhi = MAX(pti.x, ptj.x) + g->eps;
+    if (dx == 0) {
+	d = 2e-4 / fabs(dy);
+	xlo -= d;
+	xhi += d;
+    } else
+	d = 2e-4 / fabs(dx);
+
+    i0 = cellOf(xlo, g->ll.x, g->w, g->nx);
+    i1 = cellOf(xhi, g->ll.x, g->w, g->nx);
+    for (i = i0; i <= i1; i++) {
+	if (dx == 0) {
+	    y0 = MIN(pti.y, ptj.y);
+	    y1 = MAX(pti.y, ptj.y);
+	} else {
+	    /* span of the segment over the column, widened by d */
+	    x0 = MAX(xlo, g->ll.x + i * g->w - g->eps);
+	    x1 = MIN(xhi, g->ll.x + (i + 1) * g->w + g->eps);
+	    t = (x0 - pti.x) / dx;
+	    y0 = pti.y + MIN(MAX(t, 0), 1) * dy;
+	    t = (x1 - pti.x) / dx;
+	    y1 = pti.y + MIN(MAX(t, 0), 1) * dy;
+	    if (y0 > y1) {
+		t = y0;
+		y0 = y1;
+		y1 = t;
+	    }
+	    y0 -= d;
+	    y1 += d;
+	}
+	j0 = cellOf(y0 - g->eps, g->ll.y, g->h, g->ny);
+	j1 = cellOf(y1 + g->eps, g->ll.y, g->h, g->ny);
+	for (j = j0; j <= j1; j++) {
+	    cell = g->cell + j * g->nx + i;
+	    for (m = cell[0]; m < cell[1]; m++) {
+		k = g->edge[m];
+		if ((s1 <= k && k < e1) || (s2 <= k && k < e2))
+		    continue;
+		if (INTERSECT(pti, ptj, pts[k], pts[nextPt[k]], pts[conf->prev[k]]))
+		    return 0;
+	    }
+	}
     }
     return 1;
 }
@@ -251,6 +397,9 @@ static int clear(Ppoint_t pti, Ppoint_t ptj,
  * If two nodes cannot see each other, the matrix entry is 0.
  * If two nodes can see each other, the matrix entry is the distance
  * between them.
+ *
+ * The rows are independent, so each pass over earlier vertices only
+ * fills the lower triangle, which is copied to the upper one after.
  */
 static void compVis(vconfig_t * conf, int start)
 {
@@ -262,17 +411,12 @@ static void compVis(vconfig_t * conf, int start)
     int j, i, previ;
     COORD d;
 
+#ifdef _OPENMP
+#pragma omp parallel for private(j, previ) schedule(dynamic, 16)
+#endif
     for (i = start; i < V; i++) {
-	/* add edge between i and previ.
-	 * Note that this works for the cases of polygons of 1 and 2
-	 * vertices, though needless work is done.
-	 */
-	previ = prevPt[i];
-	d = dist(pts[i], pts[previ]);
-	wadj[i][previ] = d;
-	wadj[previ][i] = d;
-
 	/* Check remaining, earlier vertices */
+	previ = prevPt[i];
 	if (previ == i - 1)
 	    j = i - 2;
 	else
@@ -280,14 +424,25 @@ static void compVis(vconfig_t * conf, int start)
 	for (; j >= 0; j--) {
 	    if (inCone(i, j, pts, nextPt, prevPt) &&
 		inCone(j, i, pts, nextPt, prevPt) &&
-		clear(pts[i], pts[j], V, V, V, pts, nextPt, prevPt)) {
+		clear(conf, pts[i], pts[j], V, V, V, V)) {
 		/* if i and j see each other, add edge */
-		d = dist(pts[i], pts[j]);
-		wadj[i][j] = d;
-		wadj[j][i] = d;
+		wadj[i][j] = dist(pts[i], pts[j]);
 	    }
 	}
     }
+
+    for (i = start; i < V; i++) {
+	/* add edge between i and previ.
+	 * Note that this works for the cases of polygons of 1 and 2
+	 * vertices, though needless work is done.
+	 */
+	previ = prevPt[i];
+	d = dist(pts[i], pts[previ]);
+	wadj[i][previ] = d;
+	wadj[previ][i] = d;
+	for (j = 0; j < i; j++)
+	    wadj[j][i] = wadj[i][j];
+    }
 }
 
 /* visibility:
@@ -298,9 +453,23 @@ static void compVis(vconfig_t * conf, int start)
 void visibility(vconfig_t * conf)
 {
     conf->vis = allocArray(conf->N, 2);
+    mkGrid(conf);
     compVis(conf, 0);
 }
 
+/* freeVisibility:
+ * Free the data computed by visibility.
+ */
+void freeVisibility(vconfig_t * conf)
+{
+    if (conf->vis) {
+	free(conf->vis[0]);
+	free(conf->vis);
+    }
+    free(conf->grid.cell);
+    free(conf->grid.edge);
+}
+
 /* polyhit:
  * Given a vconfig_t conf, as above, and a point,
  * return the index of the polygon that contains
@@ -357,7 +526,7 @@ COORD *ptVis(vconfig_t * conf, int pp, Ppoint_t p)
     for (k = 0; k < start; k++) {
 	pk = pts[k];
 	if (in_cone(pts[prevPt[k]], pk, pts[nextPt[k]], p) &&
-	    clear(p, pk, start, end, V, pts, nextPt, prevPt)) {
+	    clear(conf, p, pk, start, end, start, end)) {
 	    /* if p and pk see each other, add edge */
 	    d = dist(p, pk);
 	    vadj[k] = d;
@@ -371,7 +540,7 @@ COORD *ptVis(vconfig_t * conf, int pp, Ppoint_t p)
     for (k = end; k < V; k++) {
 	pk = pts[k];
 	if (in_cone(pts[prevPt[k]], pk, pts[nextPt[k]], p) &&
-	    clear(p, pk, start, end, V, pts, nextPt, prevPt)) {
+	    clear(conf, p, pk, start, end, start, end)) {
 	    /* if p and pk see each other, add edge */
 	    d = dist(p, pk);
 	    vadj[k] = d;
@@ -392,11 +561,6 @@ COORD *ptVis(vconfig_t * conf, int pp, Ppoint_t p)
  */
 int directVis(Ppoint_t p, int pp, Ppoint_t q, int qp, vconfig_t * conf)
 {
-    int V = conf->N;
-    Ppoint_t *pts = conf->P;
-    int *nextPt = conf->next;
-    /* int*   prevPt = conf->prev; */
-    int k;
     int s1, e1;
     int s2, e2;
 
@@ -427,17 +591,5 @@ int directVis(Ppoint_t p, int pp, Ppoint_t q, int qp, vconfig_t * conf)
 	e2 = conf->start[pp + 1];
     }
 
-    for (k = 0; k < s1; k++) {
-	if (INTERSECT(p, q, pts[k], pts[nextPt[k]], pts[prevPt[k]]))
-	    return 0;
-    }
-    for (k = e1; k < s2; k++) {
-	if (INTERSECT(p, q, pts[k], pts[nextPt[k]], pts[prevPt[k]]))
-	    return 0;
-    }
-    for (k = e2; k < V; k++) {
-	if (INTERSECT(p, q, pts[k], pts[nextPt[k]], pts[prevPt[k]]))
-	    return 0;
-    }
-    return 1;
+    return clear(conf, p, q, s1, e1, s2, e2);
 }
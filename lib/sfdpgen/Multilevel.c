@@ -15,6 +15,10 @@
 #include <assert.h>
 #include <common/arith.h>
 
+/* with OpenMP, rounds of the locally dominant matching with at least this
+   many unmatched nodes are run in parallel */
+#define MATCHING_PARALLEL_NODES 4096
+
 
 Multilevel_control Multilevel_control_new(int scheme, int mode){
   Multilevel_control ctrl;
@@ -321,6 +325,115 @@ static void maximal_independent_edge_set_heavest_edge_pernode(SparseMatrix A, in
 
 
 
+/* edge_hash:
+ * A fixed scrambling of the end nodes of edge {i,j}.
+ */
+static unsigned int edge_hash(int i, int j){
+  unsigned int h = (unsigned int) MIN(i, j)*0x9e3779b1u ^ (unsigned int) MAX(i, j)*0x85ebca6bu;
+
+  h ^= h >> 16;
+  h *= 0x7feb352du;
+  h ^= h >> 15;
+  return h;
+}
+
+/* heavier_edge:
+ * Whether edge {i,j} of weight w comes before edge {i,k} of weight wk:
+ * heavier first, then by edge_hash, then by the end nodes. This orders
+ * all edges, so ties cannot leave two nodes pointing past each other.
+ * Ordering equal weights by node number instead would make chains of
+ * picks along the node order, as in a grid, each costing a round.
+ */
+static int heavier_edge(int i, int j, real w, int k, real wk){
+  unsigned int hj, hk;
+
+  if (w != wk) return w > wk;
+  hj = edge_hash(i, j);
+  hk = edge_hash(i, k);
+  if (hj != hk) return hj > hk;
+  if (MIN(i, j) != MIN(i, k)) return MIN(i, j) < MIN(i, k);
+  return MAX(i, j) < MAX(i, k);
+}
+
+/* maximal_independent_edge_set_heavest_edge_locally_dominant:
+ * Heavy edge matching by handshakes. In each round every unmatched node
+ * picks its heaviest edge to another unmatched node, and nodes that pick
+ * each other are matched. With symmetric weights the heaviest such edge
+ * left is picked from both ends, so each round matches at least one pair,
+ * and the rounds stop when no unmatched node has an unmatched neighbor.
+ * Weights summed in a different order for (i,j) and (j,i), or NaN, can
+ * make the picks a cycle instead; the rounds then stop at the first one
+ * matching nothing, leaving its nodes unmatched.
+ * A round reads only the matching of the previous one, so with OpenMP
+ * its nodes are processed in parallel, and the matching does not depend
+ * on the number of threads.
+ */
+static void maximal_independent_edge_set_heavest_edge_locally_dominant(SparseMatrix A, int **matching, int *nmatch){
+  int i, ii, j, *ia, *ja, m, n, *match, *cand, *active, nactive;
+  real *a;
+
+  assert(A);
+  assert(SparseMatrix_known_strucural_symmetric(A));
+  ia = A->ia;
+  ja = A->ja;
+  m = A->m;
+  n = A->n;
+  assert(n == m);
+  assert(A->type == MATRIX_TYPE_REAL);
+  a = (real*) A->a;
+
+  *matching = match = N_GNEW(m,int);
+  cand = N_GNEW(m,int);
+  active = N_GNEW(m,int);
+  for (i = 0; i < m; i++) {
+    match[i] = i;
+    active[i] = i;
+  }
+  nactive = m;
+  *nmatch = n;
+
+  while (nactive > 0){
+#ifdef _OPENMP
+#pragma omp parallel for private(i, j) if (nactive >= MATCHING_PARALLEL_NODES)
+#endif
+    for (ii = 0; ii < nactive; ii++){
+      int best = -1;
+      real abest = 0;
+      i = active[ii];
+      for (j = ia[i]; j < ia[i+1]; j++){
+	if (i == ja[j] || match[ja[j]] != ja[j]) continue;
+	if (best < 0 || heavier_edge(i, ja[j], a[j], best, abest)){
+	  best = ja[j];
+	  abest = a[j];
+	}
+      }
+      cand[i] = best;
+    }
+#ifdef _OPENMP
+#pragma omp parallel for private(i) if (nactive >= MATCHING_PARALLEL_NODES)
+#endif
+    for (ii = 0; ii < nactive; ii++){
+      i = active[ii];
+      if (cand[i] >= 0 && cand[cand[i]] == i) match[i] = cand[i];
+    }
+    /* nodes left with an unmatched neighbor go on to the next round */
+    for (ii = 0, j = 0; ii < nactive; ii++){
+      i = active[ii];
+      if (match[i] != i) {
+	if (i < match[i]) (*nmatch)--;
+      } else if (cand[i] >= 0) {
+	active[j++] = i;
+      }
+    }
+    /* without progress the picks form a cycle; leave those nodes unmatched */
+    if (j == nactive) break;
+    nactive = j;
+  }
+
+  FREE(cand);
+  FREE(active);
+}
+
 #define node_degree(i) (ia[(i)+1] - ia[(i)])
 
 static void maximal_independent_edge_set_heavest_edge_pernode_leaves_first(SparseMatrix A, int randomize, int **cluster, int **clusterp, int *ncluster){
@@ -948,6 +1061,26 @@ static SparseMatrix DistanceMatrix_restrict_filtering(int *mask, int is_C, int i
   return NULL;
 }
 
+/* prolongation_by_cluster:
+ * The n x nc prolongation matrix with a 1 in column cid[i] of row i,
+ * for nodes each in one cluster. Built directly in compressed row form,
+ * it equals what SparseMatrix_from_coordinate_arrays gives.
+ */
+static SparseMatrix prolongation_by_cluster(int n, int nc, int *cid){
+  SparseMatrix P = SparseMatrix_new(n, nc, n, MATRIX_TYPE_REAL, FORMAT_CSR);
+  real *a = (real*) P->a;
+  int i;
+
+  for (i = 0; i < n; i++){
+    P->ia[i] = i;
+    P->ja[i] = cid[i];
+    a[i] = 1.;
+  }
+  P->ia[n] = n;
+  P->nz = n;
+  return P;
+}
+
 static void Multilevel_coarsen_internal(SparseMatrix A, SparseMatrix *cA, SparseMatrix D, SparseMatrix *cD,
 					real *node_wgt, real **cnode_wgt,
 					SparseMatrix *P, SparseMatrix *R, Multilevel_control ctrl, int *coarsen_scheme_used){
@@ -957,6 +1090,7 @@ static void Multilevel_coarsen_internal(SparseMatrix A, SparseMatrix *cA, Sparse
   SparseMatrix B = NULL;
   int *vset = NULL, nvset, ncov, j;
   int *cluster=NULL, *clusterp=NULL, ncluster;
+  int *cid = NULL;
 
   assert(A->m == A->n);
   *cA = NULL;
@@ -1033,20 +1167,17 @@ static void Multilevel_coarsen_internal(SparseMatrix A, SparseMatrix *cA, Sparse
 #endif
       goto RETURN;
     }
-    irn = N_GNEW(n,int);
-    jcn = N_GNEW(n,int);
-    val = N_GNEW(n,real);
+    cid = N_GNEW(n,int);
     nzc = 0; 
     for (i = 0; i < ncluster; i++){
       for (j = clusterp[i]; j < clusterp[i+1]; j++){
 	assert(clusterp[i+1] > clusterp[i]);
-	irn[nzc] = cluster[j];
-	jcn[nzc] = i;
-	val[nzc++] = 1.;
+	cid[cluster[j]] = i;
+	nzc++;
      }
     }
     assert(nzc == n);
-    *P = SparseMatrix_from_coordinate_arrays(nzc, n, nc, irn, jcn, (void *) val, MATRIX_TYPE_REAL, sizeof(real));
+    *P = prolongation_by_cluster(n, nc, cid);
     *R = SparseMatrix_transpose(*P);
 
     *cD = DistanceMatrix_restrict_cluster(ncluster, clusterp, cluster, *P, *R, D);
@@ -1077,6 +1208,9 @@ static void Multilevel_coarsen_internal(SparseMatrix A, SparseMatrix *cA, Sparse
   case COARSEN_INDEPENDENT_EDGE_SET_HEAVEST_EDGE_PERNODE_DEGREE_SCALED:
     if (ctrl->coarsen_scheme == COARSEN_INDEPENDENT_EDGE_SET_HEAVEST_EDGE_PERNODE_DEGREE_SCALED) 
       maximal_independent_edge_set_heavest_edge_pernode_scaled(A, ctrl->randomize, &matching, &nmatch);
+  case COARSEN_INDEPENDENT_EDGE_SET_HEAVEST_EDGE_LOCALLY_DOMINANT:
+    if (ctrl->coarsen_scheme == COARSEN_INDEPENDENT_EDGE_SET_HEAVEST_EDGE_LOCALLY_DOMINANT)
+      maximal_independent_edge_set_heavest_edge_locally_dominant(A, &matching, &nmatch);
     nc = nmatch;
     if ((ctrl->coarsen_mode == COARSEN_MODE_GENTLE && nc > ctrl->min_coarsen_factor*n) || nc == n || nc < ctrl->minsize) {
 #ifdef DEBUG_PRINT
@@ -1085,23 +1219,17 @@ static void Multilevel_coarsen_internal(SparseMatrix A, SparseMatrix *cA, Sparse
 #endif
       goto RETURN;
     }
-    irn = N_GNEW(n,int);
-    jcn = N_GNEW(n,int);
-    val = N_GNEW(n,real);
+    cid = N_GNEW(n,int);
     nzc = 0; nc = 0;
     for (i = 0; i < n; i++){
       if (matching[i] >= 0){
 	if (matching[i] == i){
-	  irn[nzc] = i;
-	  jcn[nzc] = nc;
-	  val[nzc++] = 1.;
+	  cid[i] = nc;
+	  nzc++;
 	} else {
-	  irn[nzc] = i;
-	  jcn[nzc] = nc;
-	  val[nzc++] = 1;
-	  irn[nzc] = matching[i];
-	  jcn[nzc] = nc;
-	  val[nzc++] = 1;
+	  cid[i] = nc;
+	  cid[matching[i]] = nc;
+	  nzc += 2;
 	  matching[matching[i]] = -1;
 	}
 	nc++;
@@ -1110,7 +1238,7 @@ static void Multilevel_coarsen_internal(SparseMatrix A, SparseMatrix *cA, Sparse
     }
     assert(nc == nmatch);
     assert(nzc == n);
-    *P = SparseMatrix_from_coordinate_arrays(nzc, n, nc, irn, jcn, (void *) val, MATRIX_TYPE_REAL, sizeof(real));
+    *P = prolongation_by_cluster(n, nc, cid);
     *R = SparseMatrix_transpose(*P);
     *cA = SparseMatrix_multiply3(*R, A, *P); 
     /*
@@ -1195,6 +1323,7 @@ static void Multilevel_coarsen_internal(SparseMatrix A, SparseMatrix *cA, Sparse
   if (irn) FREE(irn);
   if (jcn) FREE(jcn);
   if (val) FREE(val);
+  if (cid) FREE(cid);
   if (B) SparseMatrix_delete(B);
 
   if(cluster) FREE(cluster);
@@ -338,6 +338,7 @@ StressMajorizationSmoother StressMajorizationSmoother2_new(SparseMatrix A, int d
   sm->scheme = SM_SCHEME_NORMAL;
   sm->tol_cg = 0.01;
   sm->maxit_cg = (int)sqrt((double) A->m);
+  sm->solve_method = SOLVE_METHOD_CG;
 
   lambda = sm->lambda = N_GNEW(m,real);
   for (i = 0; i < m; i++) sm->lambda[i] = lambda0;
@@ -540,6 +541,7 @@ StressMajorizationSmoother SparseStressMajorizationSmoother_new(SparseMatrix A,
   sm->D = A;
   sm->tol_cg = 0.01;
   sm->maxit_cg = (int)sqrt((double) A->m);
+  sm->solve_method = SOLVE_METHOD_CG;
 
   lambda = sm->lambda = MALLOC(sizeof(real)*m);
   for (i = 0; i < m; i++) sm->lambda[i] = lambda0;
@@ -796,15 +798,19 @@ static void uniform_stress_augment_rhs(int m, int dim, real *x, real *y, real al
   }
 }
 
-static real uniform_stress_solve(SparseMatrix Lw, real alpha, int dim, real *x0, real *rhs, real tol, int maxit, int *flag){
-  Operator Ax;
-  Operator Precon;
+static real uniform_stress_solve(SparseMatrix Lw, real alpha, Operator Precon, int dim, real *x0, real *rhs, real tol, int maxit, int *flag){
+  /* Precon: the multigrid preconditioner, or NULL for the diagonal one */
+  Operator Ax, Diag = NULL;
+  real res;
 
   Ax = Operator_uniform_stress_matmul(Lw, alpha);
-  Precon = Operator_uniform_stress_diag_precon_new(Lw, alpha);
+  if (!Precon) Precon = Diag = Operator_uniform_stress_diag_precon_new(Lw, alpha);
 
-  return cg(Ax, Precon, Lw->m, dim, x0, rhs, tol, maxit, flag);
+  res = cg(Ax, Precon, Lw->m, dim, x0, rhs, tol, maxit, flag);
 
+  Operator_uniform_stress_matmul_delete(Ax);
+  if (Diag) Operator_diag_precon_delete(Diag);
+  return res;
 }
 
 real StressMajorizationSmoother_smooth(StressMajorizationSmoother sm, int dim, real *x, int maxit_sm, real tol) {
@@ -812,6 +818,7 @@ real StressMajorizationSmoother_smooth(StressMajorizationSmoother sm, int dim, r
   int i, j, k, m, *id, *jd, *iw, *jw, idiag, flag = 0, iter = 0;
   real *w, *dd, *d, *y = NULL, *x0 = NULL, *x00 = NULL, diag, diff = 1, *lambda = sm->lambda, alpha = 0., M = 0.;
   SparseMatrix Lc = NULL;
+  Operator Ax = NULL, Precon = NULL;
   real dij, dist;
 
 
@@ -845,6 +852,12 @@ real StressMajorizationSmoother_smooth(StressMajorizationSmoother sm, int dim, r
     M = ((real*) (sm->data))[1];
   }
 
+  /* Lw is the same in every iteration, so is its multigrid hierarchy */
+  if (sm->solve_method == SOLVE_METHOD_CG_AMG){
+    if (sm->scheme != SM_SCHEME_UNIFORM_STRESS) Ax = Operator_matmul_new(Lw);
+    Precon = Operator_amg_precon_new(Lw, alpha*m);
+  }
+
   while (iter++ < maxit_sm && diff > tol){
 #ifdef GVIEWER
     if (Gviewer) {
@@ -969,7 +982,9 @@ real StressMajorizationSmoother_smooth(StressMajorizationSmoother sm, int dim, r
 #endif
 
     if (sm->scheme == SM_SCHEME_UNIFORM_STRESS){
-      uniform_stress_solve(Lw, alpha, dim, x, y, sm->tol_cg, sm->maxit_cg, &flag);
+      uniform_stress_solve(Lw, alpha, Precon, dim, x, y, sm->tol_cg, sm->maxit_cg, &flag);
+    } else if (Precon){
+      cg(Ax, Precon, m, dim, x, y, sm->tol_cg, sm->maxit_cg, &flag);
     } else {
       SparseMatrix_solve(Lw, dim, x, y,  sm->tol_cg, sm->maxit_cg, SOLVE_METHOD_CG, &flag);
       //SparseMatrix_solve(Lw, dim, x, y,  sm->tol_cg, 1, SOLVE_METHOD_JACOBI, &flag);
@@ -1000,6 +1015,8 @@ real StressMajorizationSmoother_smooth(StressMajorizationSmoother sm, int dim, r
 
  RETURN:
   SparseMatrix_delete(Lwdd);
+  Operator_matmul_delete(Ax);
+  Operator_amg_precon_delete(Precon);
   if (Lc) {
     SparseMatrix_delete(Lc);
     SparseMatrix_delete(Lw);
@@ -1051,6 +1068,7 @@ TriangleSmoother TriangleSmoother_new(SparseMatrix A, int dim, real lambda0, rea
   sm->scheme = SM_SCHEME_NORMAL;
   sm->tol_cg = 0.01;
   sm->maxit_cg = (int)sqrt((double) A->m);
+  sm->solve_method = SOLVE_METHOD_CG;
 
   lambda = sm->lambda = N_GNEW(m,real);
   for (i = 0; i < m; i++) sm->lambda[i] = lambda0;
@@ -1284,6 +1302,7 @@ void post_process_smoothing(int dim, SparseMatrix A, spring_electrical_control c
       } else {
         sm = TriangleSmoother_new(A, dim, 0, x, TRUE);
       }
+      sm->solve_method = ctrl->solve_method;
       TriangleSmoother_smooth(sm, dim, x);
       TriangleSmoother_delete(sm);
     }
@@ -1306,6 +1325,7 @@ void post_process_smoothing(int dim, SparseMatrix A, spring_electrical_control c
 
       for (k = 0; k < 1; k++){
 	sm = StressMajorizationSmoother2_new(A, dim, 0.05, x, dist_scheme);
+	sm->solve_method = ctrl->solve_method;
 	StressMajorizationSmoother_smooth(sm, dim, x, 50, 0.001);
 	StressMajorizationSmoother_delete(sm);
       }
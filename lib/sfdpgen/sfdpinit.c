@@ -18,9 +18,11 @@
 #include <assert.h>
 #include <ctype.h>
 #include <sfdpgen/spring_electrical.h>
+#include <sfdpgen/Multilevel.h>
 #include <neatogen/overlap.h>
 #include <sfdpgen/uniform_stress.h>
 #include <sfdpgen/stress_model.h>
+#include <sfdpgen/sparse_solve.h>
 #include <cgraph/strcasecmp.h>
 
 static void sfdp_init_edge(edge_t * e)
@@ -118,7 +120,7 @@ static void sfdpLayout(graph_t * g, spring_electrical_control ctrl,
 	multilevel_spring_electrical_embedding(Ndim, A, D, ctrl, NULL, sizes, pos, n_edge_label_nodes, edge_label_nodes, &flag);
 	break;
     case METHOD_UNIFORM_STRESS:
-	uniform_stress(Ndim, A, pos, &flag);
+	uniform_stress(Ndim, A, pos, ctrl->solve_method, &flag);
 	break;
     case METHOD_STRESS:{
 	int maxit = 200;
@@ -143,7 +145,7 @@ static void sfdpLayout(graph_t * g, spring_electrical_control ctrl,
 	    D = DD;
 	}
 
-	stress_model(Ndim, A, D, &pos, TRUE, maxit, tol, &flag);
+	stress_model(Ndim, A, D, &pos, TRUE, maxit, tol, ctrl->solve_method, &flag);
 	}
 	break;
     }
@@ -275,6 +277,30 @@ late_quadtree_scheme (graph_t* g, Agsym_t* sym, int dflt)
     return rv;
 }
 
+/* late_coarsening:
+ * "fast" selects the matching computed in parallel with OpenMP;
+ * anything else, including "normal", keeps the default scheme.
+ */
+static int
+late_coarsening (graph_t* g, Agsym_t* sym, int dflt)
+{
+    if (sym && !strcasecmp(agxget(g, sym), "fast"))
+	return COARSEN_INDEPENDENT_EDGE_SET_HEAVEST_EDGE_LOCALLY_DOMINANT;
+    return dflt;
+}
+
+/* late_solver:
+ * "amg" preconditions the conjugate gradient solves of stress
+ * majorization by algebraic multigrid; anything else, including "cg",
+ * keeps the diagonal preconditioner.
+ */
+static int
+late_solver (graph_t* g, Agsym_t* sym, int dflt)
+{
+    if (sym && !strcasecmp(agxget(g, sym), "amg"))
+	return SOLVE_METHOD_CG_AMG;
+    return dflt;
+}
 
 /* tuneControl:
  * Use user values to reset control
@@ -298,7 +324,9 @@ tuneControl (graph_t* g, spring_electrical_control ctrl)
     ctrl->K = late_double(g, agfindgraphattr(g, "K"), -1.0, 0.0);
     ctrl->p = -1.0*late_double(g, agfindgraphattr(g, "repulsiveforce"), -AUTOP, 0.0);
     ctrl->multilevels = late_int(g, agfindgraphattr(g, "levels"), INT_MAX, 0);
+    ctrl->multilevel_coarsen_scheme = late_coarsening(g, agfindgraphattr(g, "coarsening"), ctrl->multilevel_coarsen_scheme);
     ctrl->smoothing = late_smooth(g, agfindgraphattr(g, "smoothing"), SMOOTHING_NONE);
+    ctrl->solve_method = late_solver(g, agfindgraphattr(g, "solver"), SOLVE_METHOD_CG);
     ctrl->tscheme = late_quadtree_scheme(g, agfindgraphattr(g, "quadtree"), QUAD_TREE_NORMAL);
     /* ctrl->method = late_mode(g, agfindgraphattr(g, "mode"), METHOD_SPRING_ELECTRICAL); */
     ctrl->method = METHOD_SPRING_ELECTRICAL;
@@ -12,6 +12,7 @@
 #include <string.h>
 #include <sfdpgen/sparse_solve.h>
 #include <sfdpgen/sfdpinternal.h>
+#include <sfdpgen/Multilevel.h>
 #include <common/memory.h>
 #include <common/logic.h>
 #include <math.h>
@@ -29,6 +30,7 @@ struct uniform_stress_matmul_data{
 
 void Operator_uniform_stress_matmul_delete(Operator o){
   FREE(o->data);
+  FREE(o);
 }
 
 static real *Operator_uniform_stress_matmul_apply(Operator o, real *x, real *y){
@@ -69,7 +71,7 @@ static real *Operator_matmul_apply(Operator o, real *x, real *y){
   return y;
 }
 
-static Operator Operator_matmul_new(SparseMatrix A){
+Operator Operator_matmul_new(SparseMatrix A){
   Operator o;
 
   o = GNEW(struct Operator_struct);
@@ -79,7 +81,7 @@ static Operator Operator_matmul_new(SparseMatrix A){
 }
 
 
-static void Operator_matmul_delete(Operator o){
+void Operator_matmul_delete(Operator o){
   if (o) FREE(o);  
 }
 
@@ -151,9 +153,170 @@ static Operator Operator_diag_precon_new(SparseMatrix A){
   return o;
 }
 
-static void Operator_diag_precon_delete(Operator o){
-  if (o->data) FREE(o->data);
-  if (o) FREE(o);
+void Operator_diag_precon_delete(Operator o){
+  if (!o) return;
+  FREE(o->data);
+  FREE(o);
+}
+
+/* Algebraic multigrid preconditioner. The levels are those Multilevel_new
+   builds on the graph of the off-diagonal entries of A, with the heavy edge
+   matching of sfdp taken in node order, so the random number generator is
+   left alone; the coarse matrices are the Galerkin products P^T A P. A V-cycle smooths with a forward
+   Gauss-Seidel sweep before the coarse correction and a backward one after,
+   so it is symmetric, as CG needs. */
+
+#define AMG_COARSEST_SWEEPS 10
+
+struct amg_level {
+  SparseMatrix A;
+  SparseMatrix P;/* prolongation from the next level. NULL on the coarsest */
+  SparseMatrix R;/* transpose of P */
+  real *diag;
+  real *x, *b, *r;/* work vectors */
+};
+
+struct amg_data {
+  int nlevels;
+  struct amg_level *levels;
+};
+
+static void gauss_seidel(SparseMatrix A, real *diag, real *x, real *b, int forward){
+  int i, ii, j, m = A->m, *ia = A->ia, *ja = A->ja;
+  real *a = (real*) A->a, s;
+
+  for (ii = 0; ii < m; ii++){
+    i = forward ? ii : m - 1 - ii;
+    if (diag[i] == 0) continue;
+    s = b[i];
+    for (j = ia[i]; j < ia[i+1]; j++){
+      if (ja[j] != i) s -= a[j]*x[ja[j]];
+    }
+    x[i] = s/diag[i];
+  }
+}
+
+static void amg_vcycle(struct amg_level *lev, int nlevels, real *x, real *b){
+  struct amg_level *next = lev + 1;
+  int i, k, m = lev->A->m;
+  real *r = lev->r;
+
+  for (i = 0; i < m; i++) x[i] = 0;
+
+  if (nlevels == 1){
+    for (k = 0; k < AMG_COARSEST_SWEEPS; k++){
+      gauss_seidel(lev->A, lev->diag, x, b, TRUE);
+      gauss_seidel(lev->A, lev->diag, x, b, FALSE);
+    }
+    return;
+  }
+
+  gauss_seidel(lev->A, lev->diag, x, b, TRUE);
+  SparseMatrix_multiply_vector(lev->A, x, &r, FALSE);
+  for (i = 0; i < m; i++) r[i] = b[i] - r[i];
+  SparseMatrix_multiply_vector(lev->R, r, &(next->b), FALSE);
+  amg_vcycle(next, nlevels - 1, next->x, next->b);
+  SparseMatrix_multiply_vector(lev->P, next->x, &r, FALSE);
+  for (i = 0; i < m; i++) x[i] += r[i];
+  gauss_seidel(lev->A, lev->diag, x, b, FALSE);
+}
+
+static real* Operator_amg_precon_apply(Operator o, real *x, real *y){
+  struct amg_data *d = (struct amg_data*) o->data;
+
+  amg_vcycle(d->levels, d->nlevels, y, x);
+  return y;
+}
+
+Operator Operator_amg_precon_new(SparseMatrix A, real shift){
+  Operator o;
+  struct amg_data *d;
+  struct amg_level *lev;
+  Multilevel grid, g;
+  Multilevel_control mctrl;
+  SparseMatrix W;
+  int i, j, l, m, *ia, *ja;
+  real *a;
+
+  assert(A->type == MATRIX_TYPE_REAL);
+
+  /* the graph to coarsen, weighted by |a_ij| */
+  W = SparseMatrix_remove_diagonal(SparseMatrix_copy(A));
+  a = (real*) W->a;
+  for (i = 0; i < W->nz; i++) a[i] = fabs(a[i]);
+
+  mctrl = Multilevel_control_new(COARSEN_INDEPENDENT_EDGE_SET_HEAVEST_EDGE_PERNODE_LEAVES_FIRST, COARSEN_MODE_GENTLE);
+  mctrl->randomize = FALSE;
+  grid = Multilevel_new(W, NULL, NULL, mctrl);
+
+  d = GNEW(struct amg_data);
+  d->nlevels = 0;
+  for (g = grid; g; g = g->next) d->nlevels++;
+  d->levels = lev = N_GNEW(d->nlevels, struct amg_level);
+
+  lev[0].A = SparseMatrix_copy(A);
+  if (shift != 0){
+    ia = lev[0].A->ia; ja = lev[0].A->ja; a = (real*) lev[0].A->a;
+    for (i = 0; i < A->m; i++){
+      for (j = ia[i]; j < ia[i+1]; j++){
+	if (ja[j] == i) a[j] += shift;
+      }
+    }
+  }
+
+  for (l = 0, g = grid; g; l++, g = g->next){
+    m = lev[l].A->m;
+    lev[l].P = lev[l].R = NULL;
+    lev[l].x = lev[l].b = lev[l].r = NULL;
+    if (g->next){
+      lev[l].P = g->next->P;
+      g->next->P = NULL;
+      lev[l].R = SparseMatrix_transpose(lev[l].P);
+      lev[l+1].A = SparseMatrix_multiply3(lev[l].R, lev[l].A, lev[l].P);
+      lev[l].r = N_GNEW(m, real);
+    }
+    if (l > 0){
+      lev[l].x = N_GNEW(m, real);
+      lev[l].b = N_GNEW(m, real);
+    }
+    lev[l].diag = N_GNEW(m, real);
+    ia = lev[l].A->ia; ja = lev[l].A->ja; a = (real*) lev[l].A->a;
+    for (i = 0; i < m; i++){
+      lev[l].diag[i] = 0;
+      for (j = ia[i]; j < ia[i+1]; j++){
+	if (ja[j] == i) lev[l].diag[i] += a[j];
+      }
+    }
+  }
+
+  Multilevel_delete(grid);
+  Multilevel_control_delete(mctrl);
+  SparseMatrix_delete(W);
+
+  o = GNEW(struct Operator_struct);
+  o->data = (void*) d;
+  o->Operator_apply = Operator_amg_precon_apply;
+  return o;
+}
+
+void Operator_amg_precon_delete(Operator o){
+  struct amg_data *d;
+  int l;
+
+  if (!o) return;
+  d = (struct amg_data*) o->data;
+  for (l = 0; l < d->nlevels; l++){
+    SparseMatrix_delete(d->levels[l].A);
+    SparseMatrix_delete(d->levels[l].P);
+    SparseMatrix_delete(d->levels[l].R);
+    FREE(d->levels[l].diag);
+    FREE(d->levels[l].x);
+    FREE(d->levels[l].b);
+    FREE(d->levels[l].r);
+  }
+  FREE(d->levels);
+  FREE(d);
+  FREE(o);
 }
 
 static real conjugate_gradient(Operator A, Operator precon, int n, real *x, real *rhs, real tol, int maxit, int *flag){
@@ -304,6 +467,13 @@ real SparseMatrix_solve(SparseMatrix A, int dim, real *x0, real *rhs, real tol,
     Operator_matmul_delete(Ax);
     Operator_diag_precon_delete(precond);
     break;
+  case SOLVE_METHOD_CG_AMG:
+    Ax =  Operator_matmul_new(A);
+    precond = Operator_amg_precon_new(A, 0);
+    res = cg(Ax, precond, n, dim, x0, rhs, tol, maxit, flag);
+    Operator_matmul_delete(Ax);
+    Operator_amg_precon_delete(precond);
+    break;
   case SOLVE_METHOD_JACOBI:{
     jacobi(A, dim, x0, rhs, maxit, flag);
     break;
@@ -14,7 +14,7 @@
 
 #include <sparse/SparseMatrix.h>
 
-enum {SOLVE_METHOD_CG, SOLVE_METHOD_JACOBI};
+enum {SOLVE_METHOD_CG, SOLVE_METHOD_JACOBI, SOLVE_METHOD_CG_AMG};
 
 typedef struct Operator_struct *Operator;
 
@@ -29,7 +29,21 @@ real SparseMatrix_solve(SparseMatrix A, int dim, real *x0, real *rhs, real tol,
 
 Operator Operator_uniform_stress_matmul(SparseMatrix A, real alpha);
 
+void Operator_uniform_stress_matmul_delete(Operator o);
+
 Operator Operator_uniform_stress_diag_precon_new(SparseMatrix A, real alpha);
 
+void Operator_diag_precon_delete(Operator o);
+
+Operator Operator_matmul_new(SparseMatrix A);
+
+void Operator_matmul_delete(Operator o);
+
+/* a V-cycle of algebraic multigrid on A + shift*I, for use as the precond of cg.
+   The hierarchy is built once, so the operator pays off over repeated solves with A */
+Operator Operator_amg_precon_new(SparseMatrix A, real shift);
+
+void Operator_amg_precon_delete(Operator o);
+
 #endif
  
@@ -12,9 +12,10 @@
 
 #include <sparse/SparseMatrix.h>
 #include <sfdpgen/spring_electrical.h>
-#include <sparse/QuadTree.h>
+#include <sparse/FlatQuadTree.h>
 #include <sfdpgen/Multilevel.h>
 #include <sfdpgen/post_process.h>
+#include <sfdpgen/sparse_solve.h>
 #include <neatogen/overlap.h>
 #include <common/types.h>
 #include <common/memory.h>
@@ -57,6 +58,7 @@ spring_electrical_control spring_electrical_control_new(){
   ctrl->beautify_leaves = FALSE;
   ctrl->use_node_weights = FALSE;
   ctrl->smoothing = SMOOTHING_NONE;
+  ctrl->solve_method = SOLVE_METHOD_CG;
   ctrl->overlap = 0;
   ctrl->do_shrinking = 1;
   ctrl->tscheme = QUAD_TREE_HYBRID;
@@ -482,19 +484,121 @@ void force_print(FILE *fp, int n, int dim, real *x, real *force){
 }
 
 
+/* Force kernels for the inner loops of the embeddings. Coordinates stay interleaved,
+   x[i*dim+k]: with dim 2 or 3 a node's coordinates share a cache line, and the neighbors
+   and supernodes of a node are scattered anyway. The kernels are written out for dim 2
+   and 3 so that the coordinate loops disappear, and the sum over supernodes runs in
+   SE_LANES independent partial sums that the compiler can keep in vector registers of
+   any width. The partial sums are combined in a fixed order, so results do not depend on
+   the instruction set the code is compiled for.
+ */
+#define SE_LANES 4
+
+static void attractive_force(int dim, real *x, int i, int *ia, int *ja, real CRK, real *f){
+  /* f -= sum over neighbors j of C^((2-p)/3)/K ||x_i-x_j|| (x_i - x_j), in row order */
+  int j, k;
+  real *xi = &(x[i*dim]), *xj, d0, d1, d2, dist;
+
+  if (dim == 2){
+    for (j = ia[i]; j < ia[i+1]; j++){
+      if (ja[j] == i) continue;
+      xj = &(x[ja[j]*2]);
+      d0 = xi[0] - xj[0];
+      d1 = xi[1] - xj[1];
+      dist = sqrt(d0*d0 + d1*d1);
+      f[0] -= CRK*d0*dist;
+      f[1] -= CRK*d1*dist;
+    }
+  } else if (dim == 3){
+    for (j = ia[i]; j < ia[i+1]; j++){
+      if (ja[j] == i) continue;
+      xj = &(x[ja[j]*3]);
+      d0 = xi[0] - xj[0];
+      d1 = xi[1] - xj[1];
+      d2 = xi[2] - xj[2];
+      dist = sqrt(d0*d0 + d1*d1 + d2*d2);
+      f[0] -= CRK*d0*dist;
+      f[1] -= CRK*d1*dist;
+      f[2] -= CRK*d2*dist;
+    }
+  } else {
+    for (j = ia[i]; j < ia[i+1]; j++){
+      if (ja[j] == i) continue;
+      dist = distance(x, dim, i, ja[j]);
+      for (k = 0; k < dim; k++){
+	f[k] -= CRK*(xi[k] - x[ja[j]*dim+k])*dist;
+      }
+    }
+  }
+}
+
+static void supernode_force(int dim, int nsuper, real *xi, real *center, real *supernode_wgts, real *distances,
+			    real p, real KP, real *f){
+  /* f += repulsive force on a node at xi from nsuper supernodes */
+  int j, k, l;
+  real acc[3*SE_LANES], dist, s, *c;
+
+  if (p != -1 || dim > 3){
+    for (j = 0; j < nsuper; j++){
+      dist = MAX(distances[j], MINDIST);
+      for (k = 0; k < dim; k++){
+	if (p == -1){
+	  f[k] += supernode_wgts[j]*KP*(xi[k] - center[j*dim+k])/(dist*dist);
+	} else {
+	  f[k] += supernode_wgts[j]*KP*(xi[k] - center[j*dim+k])/pow(dist, 1.- p);
+	}
+      }
+    }
+    return;
+  }
+
+  for (l = 0; l < dim*SE_LANES; l++) acc[l] = 0;
+  if (dim == 2){
+    for (j = 0; j + SE_LANES <= nsuper; j += SE_LANES){
+      for (l = 0; l < SE_LANES; l++){
+	c = &(center[(j+l)*2]);
+	dist = MAX(distances[j+l], MINDIST);
+	s = supernode_wgts[j+l]*KP/(dist*dist);
+	acc[l] += s*(xi[0] - c[0]);
+	acc[SE_LANES+l] += s*(xi[1] - c[1]);
+      }
+    }
+  } else {
+    for (j = 0; j + SE_LANES <= nsuper; j += SE_LANES){
+      for (l = 0; l < SE_LANES; l++){
+	c = &(center[(j+l)*3]);
+	dist = MAX(distances[j+l], MINDIST);
+	s = supernode_wgts[j+l]*KP/(dist*dist);
+	acc[l] += s*(xi[0] - c[0]);
+	acc[SE_LANES+l] += s*(xi[1] - c[1]);
+	acc[2*SE_LANES+l] += s*(xi[2] - c[2]);
+      }
+    }
+  }
+  for (l = 0; j < nsuper; j++, l++){
+    c = &(center[j*dim]);
+    dist = MAX(distances[j], MINDIST);
+    s = supernode_wgts[j]*KP/(dist*dist);
+    for (k = 0; k < dim; k++) acc[k*SE_LANES+l] += s*(xi[k] - c[k]);
+  }
+  for (k = 0; k < dim; k++){
+    for (l = 0; l < SE_LANES; l++) f[k] += acc[k*SE_LANES+l];
+  }
+}
+
 void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrical_control ctrl, real *node_weights, real *x, int *flag){
   /* x is a point to a 1D array, x[i*dim+j] gives the coordinate of the i-th node at dimension j.  */
   SparseMatrix A = A0;
   int m, n;
-  int i, j, k;
+  int i, k;
   real p = ctrl->p, K = ctrl->K, C = ctrl->C, CRK, tol = ctrl->tol, maxiter = ctrl->maxiter, cool = ctrl->cool, step = ctrl->step, KP;
   int *ia = NULL, *ja = NULL;
   real *xold = NULL;
-  real *f = NULL, dist, F, Fnorm = 0, Fnorm0;
+  real *f = NULL, F, Fnorm = 0, Fnorm0;
   int iter = 0;
   int adaptive_cooling = ctrl->adaptive_cooling;
-  QuadTree qt = NULL;
-  real counts[4], *force = NULL;
+  FlatQuadTree qt = NULL;
+  real counts[4], *force = NULL, *fnode = NULL;
 #ifdef TIME
   clock_t start, end, start0;
   real qtree_cpu = 0, qtree_cpu0 = 0, qtree_new_cpu = 0, qtree_new_cpu0 = 0;
@@ -535,6 +639,7 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
 
   xold = MALLOC(sizeof(real)*dim*n);
   force = MALLOC(sizeof(real)*dim*n);
+  fnode = MALLOC(sizeof(real)*n);
 
   do {
 #ifdef TIME
@@ -564,9 +669,9 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
     start = clock();
 #endif
     if (ctrl->use_node_weights){
-      qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x, node_weights);
+      qt = FlatQuadTree_new_from_point_list(dim, n, max_qtree_level, x, node_weights);
     } else {
-      qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x, NULL);
+      qt = FlatQuadTree_new_from_point_list(dim, n, max_qtree_level, x, NULL);
     }
 
 #ifdef TIME
@@ -578,7 +683,7 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
     start = clock();
 #endif
 
-    QuadTree_get_repulsive_force(qt, force, x, ctrl->bh, p, KP, counts, flag);
+    FlatQuadTree_get_repulsive_force(qt, force, x, ctrl->bh, p, KP, counts, flag);
 
     assert(!(*flag));
 
@@ -588,28 +693,30 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
 #endif
 
     /* attractive force   C^((2-p)/3) ||x_i-x_j||/K * (x_j - x_i) */
+#ifdef _OPENMP
+#pragma omp parallel for private(f) schedule(dynamic, 256)
+#endif
     for (i = 0; i < n; i++){
       f = &(force[i*dim]);
-      for (j = ia[i]; j < ia[i+1]; j++){
-	if (ja[j] == i) continue;
-	dist = distance(x, dim, i, ja[j]);
-	for (k = 0; k < dim; k++){
-	  f[k] -= CRK*(x[i*dim+k] - x[ja[j]*dim+k])*dist;
-	}
-      }
+      attractive_force(dim, x, i, ia, ja, CRK, f);
     }
 
 
-    /* move */
+    /* move. Force norms are summed afterwards in node order, to keep Fnorm
+       independent of the number of threads */
+#ifdef _OPENMP
+#pragma omp parallel for private(f, k, F)
+#endif
     for (i = 0; i < n; i++){
       f = &(force[i*dim]);
       F = 0.;
       for (k = 0; k < dim; k++) F += f[k]*f[k];
       F = sqrt(F);
-      Fnorm += F;
+      fnode[i] = F;
       if (F > 0) for (k = 0; k < dim; k++) f[k] /= F;
       for (k = 0; k < dim; k++) x[i*dim+k] += step*f[k];
     }/* done vertex i */
+    for (i = 0; i < n; i++) Fnorm += fnode[i];
 
 
 
@@ -617,7 +724,7 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
 #ifdef TIME
       start = clock();
 #endif
-      QuadTree_delete(qt);
+      FlatQuadTree_delete(qt);
 #ifdef TIME
       end = clock();
       qtree_new_cpu += ((real) (end - start)) / CLOCKS_PER_SEC;
@@ -674,6 +781,7 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
   if (xold) FREE(xold);
   if (A != A0) SparseMatrix_delete(A);
   if (force) FREE(force);
+  if (fnode) FREE(fnode);
 
 }
 
@@ -690,7 +798,7 @@ static void spring_electrical_embedding_slow(int dim, SparseMatrix A0, spring_el
   real *f = NULL, dist, F, Fnorm = 0, Fnorm0;
   int iter = 0;
   int adaptive_cooling = ctrl->adaptive_cooling;
-  QuadTree qt = NULL;
+  FlatQuadTree qt = NULL;
   int USE_QT = FALSE;
   int nsuper = 0, nsupermax = 10;
   real *center = NULL, *supernode_wgts = NULL, *distances = NULL, nsuper_avg, counts = 0, counts_avg = 0;
@@ -767,9 +875,9 @@ static void spring_electrical_embedding_slow(int dim, SparseMatrix A0, spring_el
     if (USE_QT) {
       max_qtree_level = oned_optimizer_get(qtree_level_optimizer);
       if (ctrl->use_node_weights){
-	qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x, node_weights);
+	qt = FlatQuadTree_new_from_point_list(dim, n, max_qtree_level, x, node_weights);
       } else {
-	qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x, NULL);
+	qt = FlatQuadTree_new_from_point_list(dim, n, max_qtree_level, x, NULL);
       }
     }
 #ifdef TIME
@@ -784,7 +892,7 @@ static void spring_electrical_embedding_slow(int dim, SparseMatrix A0, spring_el
 #ifdef TIME
 	start = clock();
 #endif
-	QuadTree_get_supernodes(qt, ctrl->bh, &(x[dim*i]), i, &nsuper, &nsupermax,
+	FlatQuadTree_get_supernodes(qt, ctrl->bh, &(x[dim*i]), i, &nsuper, &nsupermax,
 				&center, &supernode_wgts, &distances, &counts, flag);
 #ifdef TIME
 	end = clock();
@@ -793,16 +901,7 @@ static void spring_electrical_embedding_slow(int dim, SparseMatrix A0, spring_el
 	counts_avg += counts;
 	nsuper_avg += nsuper;
 	if (*flag) goto RETURN;
-	for (j = 0; j < nsuper; j++){
-	  dist = MAX(distances[j], MINDIST);
-	  for (k = 0; k < dim; k++){
-	    if (p == -1){
-	      f[k] += supernode_wgts[j]*KP*(x[i*dim+k] - center[j*dim+k])/(dist*dist);
-	    } else {
-	      f[k] += supernode_wgts[j]*KP*(x[i*dim+k] - center[j*dim+k])/pow(dist, 1.- p);
-	    }
-	  }
-	}
+	supernode_force(dim, nsuper, &(x[dim*i]), center, supernode_wgts, distances, p, KP, f);
       } else {
 	if (ctrl->use_node_weights && node_weights){
 	  for (j = 0; j < n; j++){
@@ -838,13 +937,7 @@ static void spring_electrical_embedding_slow(int dim, SparseMatrix A0, spring_el
     for (i = 0; i < n; i++){
       for (k = 0; k < dim; k++) f[k] = 0.;
       /* attractive force   C^((2-p)/3) ||x_i-x_j||/K * (x_j - x_i) */
-      for (j = ia[i]; j < ia[i+1]; j++){
-	if (ja[j] == i) continue;
-	dist = distance(x, dim, i, ja[j]);
-	for (k = 0; k < dim; k++){
-	  f[k] -= CRK*(x[i*dim+k] - x[ja[j]*dim+k])*dist;
-	}
-      }
+      attractive_force(dim, x, i, ia, ja, CRK, f);
       for (k = 0; k < dim; k++) force[i*dim+k] += f[k];
     }
 
@@ -866,7 +959,7 @@ static void spring_electrical_embedding_slow(int dim, SparseMatrix A0, spring_el
     }/* done vertex i */
 
     if (qt) {
-      QuadTree_delete(qt);
+      FlatQuadTree_delete(qt);
       nsuper_avg /= n;
       counts_avg /= n;
 #ifdef TIME
@@ -940,6 +1033,50 @@ static void spring_electrical_embedding_slow(int dim, SparseMatrix A0, spring_el
 
 
 
+static void supernode_forces(int dim, int n, FlatQuadTree qt, real bh, real p, real KP, real *x, real *force,
+			     real *nsuper_avg, real *counts_avg, int *flag){
+  /* repulsive force on each node from the supernodes of qt, in force[i*dim+k]. A node only
+     reads the tree and its own coordinates and writes its own entry of force, so blocks of
+     nodes go to different threads. The supernode statistics are sums of integers and come
+     out the same whatever the number of threads. */
+  int i, err = 0;
+  real nsum = 0, csum = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel reduction(+:nsum,csum)
+#endif
+  {
+    int k, nsuper = 0, nsupermax = 10, lflag = 0;
+    real *center = NULL, *supernode_wgts = NULL, *distances = NULL, counts = 0, *f;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 256)
+#endif
+    for (i = 0; i < n; i++){
+      f = &(force[i*dim]);
+      for (k = 0; k < dim; k++) f[k] = 0.;
+      FlatQuadTree_get_supernodes(qt, bh, &(x[dim*i]), i, &nsuper, &nsupermax,
+			      &center, &supernode_wgts, &distances, &counts, &lflag);
+      csum += counts;
+      nsum += nsuper;
+      if (lflag){
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+	err = lflag;
+	continue;
+      }
+      supernode_force(dim, nsuper, &(x[dim*i]), center, supernode_wgts, distances, p, KP, f);
+    }
+    if (center) FREE(center);
+    if (supernode_wgts) FREE(supernode_wgts);
+    if (distances) FREE(distances);
+  }
+  *nsuper_avg = nsum;
+  *counts_avg = csum;
+  *flag = err;
+}
+
 void spring_electrical_embedding(int dim, SparseMatrix A0, spring_electrical_control ctrl, real *node_weights, real *x, int *flag){
   /* x is a point to a 1D array, x[i*dim+j] gives the coordinate of the i-th node at dimension j.  */
   SparseMatrix A = A0;
@@ -951,10 +1088,9 @@ void spring_electrical_embedding(int dim, SparseMatrix A0, spring_electrical_con
   real *f = NULL, dist, F, Fnorm = 0, Fnorm0;
   int iter = 0;
   int adaptive_cooling = ctrl->adaptive_cooling;
-  QuadTree qt = NULL;
+  FlatQuadTree qt = NULL;
   int USE_QT = FALSE;
-  int nsuper = 0, nsupermax = 10;
-  real *center = NULL, *supernode_wgts = NULL, *distances = NULL, nsuper_avg, counts = 0, counts_avg = 0;
+  real *force = NULL, nsuper_avg, counts_avg = 0;
 #ifdef TIME
   clock_t start, end, start0, start2;
   real qtree_cpu = 0, qtree_cpu0 = 0;
@@ -972,9 +1108,7 @@ void spring_electrical_embedding(int dim, SparseMatrix A0, spring_electrical_con
   if (n >= ctrl->quadtree_size) {
     USE_QT = TRUE;
     qtree_level_optimizer = oned_optimizer_new(max_qtree_level);
-    center = MALLOC(sizeof(real)*nsupermax*dim);
-    supernode_wgts = MALLOC(sizeof(real)*nsupermax);
-    distances = MALLOC(sizeof(real)*nsupermax);
+    force = MALLOC(sizeof(real)*dim*n);
   }
   *flag = 0;
   if (m != n) {
@@ -1050,54 +1184,34 @@ void spring_electrical_embedding(int dim, SparseMatrix A0, spring_electrical_con
 
       max_qtree_level = oned_optimizer_get(qtree_level_optimizer);
       if (ctrl->use_node_weights){
-	qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x, node_weights);
+	qt = FlatQuadTree_new_from_point_list(dim, n, max_qtree_level, x, node_weights);
       } else {
-	qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x, NULL);
+	qt = FlatQuadTree_new_from_point_list(dim, n, max_qtree_level, x, NULL);
       }
 
-	
+
+      /* repulsive force K^(1 - p)/||x_i-x_j||^(1 - p) (x_i - x_j) from the supernodes */
+#ifdef TIME
+      start = clock();
+#endif
+      supernode_forces(dim, n, qt, ctrl->bh, p, KP, x, force, &nsuper_avg, &counts_avg, flag);
+#ifdef TIME
+      end = clock();
+      qtree_cpu += ((real) (end - start)) / CLOCKS_PER_SEC;
+#endif
+      if (*flag) goto RETURN;
     }
 #ifdef TIME
     start2 = clock();
 #endif
 
     for (i = 0; i < n; i++){
-      for (k = 0; k < dim; k++) f[k] = 0.;
+      for (k = 0; k < dim; k++) f[k] = USE_QT ? force[i*dim+k] : 0.;
       /* attractive force   C^((2-p)/3) ||x_i-x_j||/K * (x_j - x_i) */
-      for (j = ia[i]; j < ia[i+1]; j++){
-	if (ja[j] == i) continue;
-	dist = distance(x, dim, i, ja[j]);
-	for (k = 0; k < dim; k++){
-	  f[k] -= CRK*(x[i*dim+k] - x[ja[j]*dim+k])*dist;
-	}
-      }
+      attractive_force(dim, x, i, ia, ja, CRK, f);
 
       /* repulsive force K^(1 - p)/||x_i-x_j||^(1 - p) (x_i - x_j) */
-      if (USE_QT){
-#ifdef TIME
-	start = clock();
-#endif
-	QuadTree_get_supernodes(qt, ctrl->bh, &(x[dim*i]), i, &nsuper, &nsupermax,
-				&center, &supernode_wgts, &distances, &counts, flag);
-
-#ifdef TIME
-	end = clock();
-	qtree_cpu += ((real) (end - start)) / CLOCKS_PER_SEC;
-#endif
-	counts_avg += counts;
-	nsuper_avg += nsuper;
-	if (*flag) goto RETURN;
-	for (j = 0; j < nsuper; j++){
-	  dist = MAX(distances[j], MINDIST);
-	  for (k = 0; k < dim; k++){
-	    if (p == -1){
-	      f[k] += supernode_wgts[j]*KP*(x[i*dim+k] - center[j*dim+k])/(dist*dist);
-	    } else {
-	      f[k] += supernode_wgts[j]*KP*(x[i*dim+k] - center[j*dim+k])/pow(dist, 1.- p);
-	    }
-	  }
-	}
-      } else {
+      if (!USE_QT){
 	if (ctrl->use_node_weights && node_weights){
 	  for (j = 0; j < n; j++){
 	    if (j == i) continue;
@@ -1138,7 +1252,7 @@ void spring_electrical_embedding(int dim, SparseMatrix A0, spring_electrical_con
     }/* done vertex i */
 
     if (qt) {
-      QuadTree_delete(qt);
+      FlatQuadTree_delete(qt);
       nsuper_avg /= n;
       counts_avg /= n;
 #ifdef TIME
@@ -1203,9 +1317,7 @@ void spring_electrical_embedding(int dim, SparseMatrix A0, spring_electrical_con
   if (xold) FREE(xold);
   if (A != A0) SparseMatrix_delete(A);
   if (f) FREE(f);
-  if (center) FREE(center);
-  if (supernode_wgts) FREE(supernode_wgts);
-  if (distances) FREE(distances);
+  if (force) FREE(force);
 
 }
 
@@ -1280,7 +1392,7 @@ static void spring_maxent_embedding(int dim, SparseMatrix A0, SparseMatrix D, sp
   real *f = NULL, dist, F, Fnorm = 0, Fnorm0;
   int iter = 0;
   int adaptive_cooling = ctrl->adaptive_cooling;
-  QuadTree qt = NULL;
+  FlatQuadTree qt = NULL;
   int USE_QT = FALSE;
   int nsuper = 0, nsupermax = 10;
   real *center = NULL, *supernode_wgts = NULL, *distances = NULL, nsuper_avg, counts = 0;
@@ -1368,9 +1480,9 @@ static void spring_maxent_embedding(int dim, SparseMatrix A0, SparseMatrix D, sp
 
     if (USE_QT) {
       if (ctrl->use_node_weights){
-	qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x, node_weights);
+	qt = FlatQuadTree_new_from_point_list(dim, n, max_qtree_level, x, node_weights);
       } else {
-	qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x, NULL);
+	qt = FlatQuadTree_new_from_point_list(dim, n, max_qtree_level, x, NULL);
       }
     }
 
@@ -1441,7 +1553,7 @@ static void spring_maxent_embedding(int dim, SparseMatrix A0, SparseMatrix D, sp
 
       /* repulsive force ||x_i-x_j||^(1 - p) (x_i - x_j) */
       if (USE_QT){
-	QuadTree_get_supernodes(qt, ctrl->bh, &(x[dim*i]), i, &nsuper, &nsupermax,
+	FlatQuadTree_get_supernodes(qt, ctrl->bh, &(x[dim*i]), i, &nsuper, &nsupermax,
 				&center, &supernode_wgts, &distances, &counts, flag);
 	nsuper_avg += nsuper;
 	if (*flag) goto RETURN;
@@ -1495,7 +1607,7 @@ static void spring_maxent_embedding(int dim, SparseMatrix A0, SparseMatrix D, sp
 
     }/* done vertex i */
 
-    if (qt) QuadTree_delete(qt);
+    if (qt) FlatQuadTree_delete(qt);
     nsuper_avg /= n;
 #ifdef DEBUG_PRINT
     stress /= (double) A->nz;
@@ -1541,7 +1653,7 @@ void spring_electrical_spring_embedding(int dim, SparseMatrix A0, SparseMatrix D
   real *f = NULL, dist, F, Fnorm = 0, Fnorm0;
   int iter = 0;
   int adaptive_cooling = ctrl->adaptive_cooling;
-  QuadTree qt = NULL;
+  FlatQuadTree qt = NULL;
   int USE_QT = FALSE;
   int nsuper = 0, nsupermax = 10;
   real *center = NULL, *supernode_wgts = NULL, *distances = NULL, nsuper_avg, counts = 0;
@@ -1605,9 +1717,9 @@ void spring_electrical_spring_embedding(int dim, SparseMatrix A0, SparseMatrix D
 
     if (USE_QT) {
       if (ctrl->use_node_weights){
-	qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x, node_weights);
+	qt = FlatQuadTree_new_from_point_list(dim, n, max_qtree_level, x, node_weights);
       } else {
-	qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x, NULL);
+	qt = FlatQuadTree_new_from_point_list(dim, n, max_qtree_level, x, NULL);
       }
     }
 
@@ -1615,13 +1727,7 @@ void spring_electrical_spring_embedding(int dim, SparseMatrix A0, SparseMatrix D
       for (k = 0; k < dim; k++) f[k] = 0.;
       /* attractive force   C^((2-p)/3) ||x_i-x_j||/K * (x_j - x_i) */
 
-      for (j = ia[i]; j < ia[i+1]; j++){
-	if (ja[j] == i) continue;
-	dist = distance(x, dim, i, ja[j]);
-	for (k = 0; k < dim; k++){
-	  f[k] -= CRK*(x[i*dim+k] - x[ja[j]*dim+k])*dist;
-	}
-      }
+      attractive_force(dim, x, i, ia, ja, CRK, f);
 
       for (j = id[i]; j < id[i+1]; j++){
 	if (jd[j] == i) continue;
@@ -1638,20 +1744,11 @@ void spring_electrical_spring_embedding(int dim, SparseMatrix A0, SparseMatrix D
 
       /* repulsive force K^(1 - p)/||x_i-x_j||^(1 - p) (x_i - x_j) */
       if (USE_QT){
-	QuadTree_get_supernodes(qt, ctrl->bh, &(x[dim*i]), i, &nsuper, &nsupermax,
+	FlatQuadTree_get_supernodes(qt, ctrl->bh, &(x[dim*i]), i, &nsuper, &nsupermax,
 				&center, &supernode_wgts, &distances, &counts, flag);
 	nsuper_avg += nsuper;
 	if (*flag) goto RETURN;
-	for (j = 0; j < nsuper; j++){
-	  dist = MAX(distances[j], MINDIST);
-	  for (k = 0; k < dim; k++){
-	    if (p == -1){
-	      f[k] += supernode_wgts[j]*KP*(x[i*dim+k] - center[j*dim+k])/(dist*dist);
-	    } else {
-	      f[k] += supernode_wgts[j]*KP*(x[i*dim+k] - center[j*dim+k])/pow(dist, 1.- p);
-	    }
-	  }
-	}
+	supernode_force(dim, nsuper, &(x[dim*i]), center, supernode_wgts, distances, p, KP, f);
       } else {
 	if (ctrl->use_node_weights && node_weights){
 	  for (j = 0; j < n; j++){
@@ -1692,7 +1789,7 @@ void spring_electrical_spring_embedding(int dim, SparseMatrix A0, SparseMatrix D
 
     }/* done vertex i */
 
-    if (qt) QuadTree_delete(qt);
+    if (qt) FlatQuadTree_delete(qt);
     nsuper_avg /= n;
 #ifdef DEBUG_PRINT
     if (Verbose && 0) {
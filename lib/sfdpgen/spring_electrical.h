@@ -47,6 +47,7 @@ struct spring_electrical_control_struct {
   int beautify_leaves;
   int use_node_weights;
   int smoothing;
+  int solve_method;/* how the stress majorization smoothers solve their linear systems: SOLVE_METHOD_CG or SOLVE_METHOD_CG_AMG */
   int overlap;
   int do_shrinking;
   int tscheme; /* octree scheme. 0 (no octree), 1 (normal), 2 (fast) */
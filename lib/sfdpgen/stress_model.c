@@ -2,9 +2,10 @@
 #include <sparse/SparseMatrix.h>
 #include <sfdpgen/spring_electrical.h>
 #include <sfdpgen/post_process.h>
+#include <sfdpgen/sparse_solve.h>
 #include <sfdpgen/stress_model.h>
 
-static void stress_model_core(int dim, SparseMatrix B, real **x, int edge_len_weighted, int maxit_sm, real tol, int *flag){
+static void stress_model_core(int dim, SparseMatrix B, real **x, int edge_len_weighted, int maxit_sm, real tol, int solve_method, int *flag){
   int m;
   SparseStressMajorizationSmoother sm;
   real lambda = 0;
@@ -45,6 +46,7 @@ static void stress_model_core(int dim, SparseMatrix B, real **x, int edge_len_we
 
   sm->tol_cg = 0.1; /* we found that there is no need to solve the Laplacian accurately */
   sm->scheme = SM_SCHEME_STRESS;
+  sm->solve_method = solve_method;
   SparseStressMajorizationSmoother_smooth(sm, dim, *x, maxit_sm, tol);
   for (i = 0; i < dim*m; i++) {
     (*x)[i] /= sm->scaling;
@@ -67,6 +69,7 @@ struct stress_model_data {
   int edge_len_weighted;
   int maxit_sm;
   real tol;
+  int solve_method;
   int *flag;
 };
 
@@ -74,15 +77,15 @@ void stress_model_gv(void* data){
   struct stress_model_data* d;
 
   d = (struct stress_model_data*) data;
-  return stress_model_core(d->dim, d->D, d->x, d->edge_len_weighted, d->maxit_sm, d->tol, d->flag);
+  return stress_model_core(d->dim, d->D, d->x, d->edge_len_weighted, d->maxit_sm, d->tol, d->solve_method, d->flag);
 }
-void stress_model(int dim, SparseMatrix A, SparseMatrix D, real **x, int edge_len_weighted, int maxit_sm, real tol, int *flag){
-  struct stress_model_data data = {dim, D, x, edge_len_weighted, maxit_sm, tol, flag};
+void stress_model(int dim, SparseMatrix A, SparseMatrix D, real **x, int edge_len_weighted, int maxit_sm, real tol, int solve_method, int *flag){
+  struct stress_model_data data = {dim, D, x, edge_len_weighted, maxit_sm, tol, solve_method, flag};
 
   int argcc = 1;
   char **argvv;
 
-  if (!Gviewer) return stress_model_core(dim, D, x, edge_len_weighted, maxit_sm, tol, flag);
+  if (!Gviewer) return stress_model_core(dim, D, x, edge_len_weighted, maxit_sm, tol, solve_method, flag);
   argcc = 1;
   argvv = malloc(sizeof(char*)*argcc);
   argvv[0] = malloc(sizeof(char));
@@ -95,8 +98,8 @@ void stress_model(int dim, SparseMatrix A, SparseMatrix D, real **x, int edge_le
 
 }
 #else
-void stress_model(int dim, SparseMatrix A, SparseMatrix D, real **x, int edge_len_weighted, int maxit_sm, real tol, int *flag){
-  stress_model_core(dim, D, x, edge_len_weighted, maxit_sm, tol, flag);
+void stress_model(int dim, SparseMatrix A, SparseMatrix D, real **x, int edge_len_weighted, int maxit_sm, real tol, int solve_method, int *flag){
+  stress_model_core(dim, D, x, edge_len_weighted, maxit_sm, tol, solve_method, flag);
 }
 #endif
 
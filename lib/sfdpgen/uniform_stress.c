@@ -44,6 +44,7 @@ UniformStressSmoother UniformStressSmoother_new(int dim, SparseMatrix A, real *x
   sm->data_deallocator = FREE;
   sm->tol_cg = 0.01;
   sm->maxit_cg = (int)sqrt((double) A->m);
+  sm->solve_method = SOLVE_METHOD_CG;
 
   /* Lw and Lwd have diagonals */
   sm->Lw = SparseMatrix_new(m, m, A->nz + m, MATRIX_TYPE_REAL, FORMAT_CSR);
@@ -123,7 +124,7 @@ static SparseMatrix get_distance_matrix(SparseMatrix A, real scaling){
 
 extern void scale_to_box(real xmin, real ymin, real xmax, real ymax, int n, int dim, real *x);
 
-void uniform_stress(int dim, SparseMatrix A, real *x, int *flag){
+void uniform_stress(int dim, SparseMatrix A, real *x, int solve_method, int *flag){
   UniformStressSmoother sm;
   real lambda0 = 10.1, M = 100, scaling = 1.;
   int maxit = 300, samepoint = TRUE, i, k, n = A->m;
@@ -159,18 +160,22 @@ void uniform_stress(int dim, SparseMatrix A, real *x, int *flag){
   assert(SparseMatrix_is_symmetric(B, FALSE));
 
   sm = UniformStressSmoother_new(dim, B, x, 1000000*lambda0, M, flag);
+  sm->solve_method = solve_method;
   UniformStressSmoother_smooth(sm, dim, x, maxit);
   UniformStressSmoother_delete(sm);
 
   sm = UniformStressSmoother_new(dim, B, x, 10000*lambda0, M, flag);
+  sm->solve_method = solve_method;
   UniformStressSmoother_smooth(sm, dim, x, maxit);
   UniformStressSmoother_delete(sm);
 
   sm = UniformStressSmoother_new(dim, B, x, 100*lambda0, M, flag);
+  sm->solve_method = solve_method;
   UniformStressSmoother_smooth(sm, dim, x, maxit);
   UniformStressSmoother_delete(sm);
 
   sm = UniformStressSmoother_new(dim, B, x, lambda0, M, flag);
+  sm->solve_method = solve_method;
   UniformStressSmoother_smooth(sm, dim, x, maxit);
   UniformStressSmoother_delete(sm);
 
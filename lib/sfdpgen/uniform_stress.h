@@ -21,6 +21,6 @@ void UniformStressSmoother_delete(UniformStressSmoother sm);
 
 UniformStressSmoother UniformStressSmoother_new(int dim, SparseMatrix A, real *x, real alpha, real M, int *flag);
 
-void uniform_stress(int dim, SparseMatrix A, real *x, int *flag);
+void uniform_stress(int dim, SparseMatrix A, real *x, int solve_method, int *flag);
 
 #endif
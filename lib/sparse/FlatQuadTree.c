@@ -0,0 +1,595 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+#include <sparse/general.h>
+#include <sparse/QuadTree.h>
+#include <sparse/FlatQuadTree.h>
+#include <math.h>
+#include <string.h>
+
+static FlatQuadTree FlatQuadTree_alloc(int dim, int max_level){
+  FlatQuadTree qt;
+
+  qt = MALLOC(sizeof(struct FlatQuadTree_struct));
+  qt->dim = dim;
+  qt->max_level = max_level;
+  qt->n = 0;
+  qt->ncells = 0;
+  qt->maxcells = 0;
+  qt->center = NULL;
+  qt->width = NULL;
+  qt->average = NULL;
+  qt->total_weight = NULL;
+  qt->npoints = NULL;
+  qt->start = NULL;
+  qt->next = NULL;
+  qt->quadrant = NULL;
+  qt->coord = NULL;
+  qt->weight = NULL;
+  qt->id = NULL;
+  qt->force = NULL;
+  return qt;
+}
+
+static void FlatQuadTree_set_size(FlatQuadTree qt, int maxcells){
+  int dim = qt->dim;
+
+  qt->maxcells = maxcells;
+  qt->center = REALLOC(qt->center, sizeof(real)*maxcells*dim);
+  qt->width = REALLOC(qt->width, sizeof(real)*maxcells);
+  qt->average = REALLOC(qt->average, sizeof(real)*maxcells*dim);
+  qt->total_weight = REALLOC(qt->total_weight, sizeof(real)*maxcells);
+  qt->npoints = REALLOC(qt->npoints, sizeof(int)*maxcells);
+  qt->start = REALLOC(qt->start, sizeof(int)*maxcells);
+  qt->next = REALLOC(qt->next, sizeof(int)*maxcells);
+  qt->quadrant = REALLOC(qt->quadrant, sizeof(int)*maxcells);
+}
+
+void FlatQuadTree_delete(FlatQuadTree qt){
+  if (!qt) return;
+  FREE(qt->center);
+  FREE(qt->width);
+  FREE(qt->average);
+  FREE(qt->total_weight);
+  FREE(qt->npoints);
+  FREE(qt->start);
+  FREE(qt->next);
+  FREE(qt->quadrant);
+  FREE(qt->coord);
+  FREE(qt->weight);
+  FREE(qt->id);
+  FREE(qt->force);
+  FREE(qt);
+}
+
+static int FlatQuadTree_get_quadrant(int dim, real *center, real *coord){
+  /* same numbering as QuadTree: bit i of the quadrant is set if coord[i] >= center[i] */
+  int d = 0, i;
+
+  for (i = dim - 1; i >= 0; i--){
+    if (coord[i] - center[i] < 0){
+      d = 2*d;
+    } else {
+      d = 2*d+1;
+    }
+  }
+  return d;
+}
+
+/* state shared by the cells of one build */
+typedef struct {
+  real *coord, *weight;
+  int *idx;/* point indices. The points of a cell arrive in idx order, and are left in Morton order */
+  int *tmp;
+  real *cbuf;/* center of the cell being built at each level */
+  int *count;/* bucket counts at each level */
+  int splitlevel;
+  int *jobs;/* when building the top levels only: the cells at splitlevel, still to be filled */
+  int njobs, maxjobs;
+} flat_build_t;
+
+static void flat_build_init(flat_build_t *b, int dim, int max_level, real *coord, real *weight, int *idx, int *tmp){
+  b->coord = coord;
+  b->weight = weight;
+  b->idx = idx;
+  b->tmp = tmp;
+  b->cbuf = MALLOC(sizeof(real)*dim*(max_level + 2));
+  b->count = MALLOC(sizeof(int)*((1<<dim) + 1)*(max_level + 1));
+  b->splitlevel = -1;
+  b->jobs = NULL;
+  b->njobs = b->maxjobs = 0;
+}
+
+static void flat_build_free(flat_build_t *b){
+  FREE(b->cbuf);
+  FREE(b->count);
+  FREE(b->jobs);
+}
+
+static void FlatQuadTree_build(FlatQuadTree qt, flat_build_t *b, int a, int m, int quadrant, real width, int level){
+  /* add the cell holding points idx[a..a+m-1], whose center is at b->cbuf[level*dim], and its
+     subtree. Cell statistics follow QuadTree_add exactly: a cell's average is updated point by
+     point in arrival order, and when the second point opens a cell, it goes into a child ahead
+     of the first. Leaves at max_level list their points last in first out.
+   */
+  int dim = qt->dim, nq = 1<<dim, c, i, j, k, q, *idx = b->idx, *count;
+  real *center = &(b->cbuf[level*dim]), *child, *avg, w, *x;
+
+  if (qt->ncells >= qt->maxcells) FlatQuadTree_set_size(qt, qt->ncells + MAX(64, qt->ncells/2));
+  c = qt->ncells++;
+  memcpy(&(qt->center[c*dim]), center, sizeof(real)*dim);
+  qt->width[c] = width;
+  qt->quadrant[c] = quadrant;
+  qt->start[c] = a;
+  qt->npoints[c] = m;
+  qt->next[c] = c + 1;
+
+  if (b->splitlevel >= 0 && level >= b->splitlevel){
+    if (b->njobs >= b->maxjobs){
+      b->maxjobs = b->njobs + MAX(64, b->njobs/2);
+      b->jobs = REALLOC(b->jobs, sizeof(int)*(b->maxjobs));
+    }
+    b->jobs[b->njobs++] = c;
+    return;
+  }
+
+  avg = &(qt->average[c*dim]);
+  for (k = 0; k < dim; k++) avg[k] = 0;
+  qt->total_weight[c] = 0;
+  for (j = 0; j < m; j++){
+    w = b->weight ? b->weight[idx[a+j]] : 1;
+    x = &(b->coord[idx[a+j]*dim]);
+    if (j == 0){
+      qt->total_weight[c] = w;
+      for (k = 0; k < dim; k++) avg[k] = x[k];
+    } else if (level < qt->max_level){
+      qt->total_weight[c] += w;
+      for (k = 0; k < dim; k++) avg[k] = (avg[k]*j + x[k])/(j + 1);
+    } else {
+      qt->total_weight[c] += w;
+      for (k = 0; k < dim; k++) avg[k] = (avg[k]*(j + 1) + x[k])/(j + 2);
+    }
+  }
+
+  if (level >= qt->max_level){
+    for (i = a, j = a + m - 1; i < j; i++, j--){
+      k = idx[i]; idx[i] = idx[j]; idx[j] = k;
+    }
+    return;
+  }
+  if (m <= 1) return;
+
+  /* stable bucket sort by quadrant, with the first two points swapped */
+  k = idx[a]; idx[a] = idx[a+1]; idx[a+1] = k;
+  count = &(b->count[level*(nq + 1)]);
+  for (q = 0; q <= nq; q++) count[q] = 0;
+  for (j = a; j < a + m; j++) count[FlatQuadTree_get_quadrant(dim, center, &(b->coord[idx[j]*dim])) + 1]++;
+  for (q = 0; q < nq; q++) count[q+1] += count[q];
+  for (j = a; j < a + m; j++){
+    q = FlatQuadTree_get_quadrant(dim, center, &(b->coord[idx[j]*dim]));
+    b->tmp[a + count[q]++] = idx[j];
+  }
+  memcpy(&(idx[a]), &(b->tmp[a]), sizeof(int)*m);
+
+  /* count[q] is now the end of bucket q */
+  child = &(b->cbuf[(level + 1)*dim]);
+  for (q = 0, j = 0; q < nq; j = count[q], q++){
+    if (count[q] == j) continue;
+    for (k = 0, i = q; k < dim; k++){/* as in QuadTree_new_in_quadrant */
+      child[k] = center[k];
+      if (i%2 == 0){
+	child[k] -= width/2;
+      } else {
+	child[k] += width/2;
+      }
+      i = (i - i%2)/2;
+    }
+    FlatQuadTree_build(qt, b, a + j, count[q] - j, q, width/2, level + 1);
+  }
+  qt->next[c] = qt->ncells;
+}
+
+FlatQuadTree FlatQuadTree_new_from_point_list(int dim, int n, int max_level, real *coord, real *weight){
+  /* form the quadtree of a list of coordinates of n points, as QuadTree_new_from_point_list.
+     coord: of length n*dim, point i sits at [i*dim, i*dim+dim - 1]
+     weight: node weight of lentgth n. If NULL, unit weight assumed.
+     The levels above QT_SPLIT_LEVEL are built first, then the subtrees below are built in
+     parallel and spliced in. The tree does not depend on how it is split.
+  */
+  FlatQuadTree qt, top, *sub;
+  flat_build_t b;
+  real width, xmin, xmax;
+  int i, k, *idx, *tmp, *offset, total;
+
+  qt = FlatQuadTree_alloc(dim, max_level);
+  qt->n = n;
+  idx = MALLOC(sizeof(int)*MAX(n, 1));
+  tmp = MALLOC(sizeof(int)*MAX(n, 1));
+  for (i = 0; i < n; i++) idx[i] = i;
+
+  /* the root, as in QuadTree_new_from_point_list */
+  top = FlatQuadTree_alloc(dim, max_level);
+  flat_build_init(&b, dim, max_level, coord, weight, idx, tmp);
+  width = 0;
+  for (k = 0; k < dim; k++){
+    xmin = xmax = n > 0 ? coord[k] : 0;
+    for (i = 1; i < n; i++){
+      xmin = MIN(xmin, coord[i*dim+k]);
+      xmax = MAX(xmax, coord[i*dim+k]);
+    }
+    b.cbuf[k] = (xmin + xmax)*0.5;
+    if (k == 0 || xmax - xmin > width) width = xmax - xmin;
+  }
+  if (width == 0) width = 0.00001;/* if we only have one point, width = 0! */
+  width *= 0.52;
+
+  b.splitlevel = (n >= QT_PARALLEL_MIN) ? QT_SPLIT_LEVEL(dim) : 0;
+  FlatQuadTree_build(top, &b, 0, n, 0, width, 0);
+
+  /* the subtrees below the split */
+  sub = MALLOC(sizeof(FlatQuadTree)*MAX(b.njobs, 1));
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (b.njobs > 1)
+#endif
+  for (i = 0; i < b.njobs; i++){
+    flat_build_t bi;
+    int c = b.jobs[i];
+
+    flat_build_init(&bi, dim, max_level, coord, weight, idx, tmp);
+    memcpy(&(bi.cbuf[b.splitlevel*dim]), &(top->center[c*dim]), sizeof(real)*dim);
+    sub[i] = FlatQuadTree_alloc(dim, max_level);
+    FlatQuadTree_build(sub[i], &bi, top->start[c], top->npoints[c], top->quadrant[c], top->width[c], b.splitlevel);
+    flat_build_free(&bi);
+  }
+
+  /* splice: cell c of the top tree becomes cell offset[c] */
+  offset = MALLOC(sizeof(int)*(top->ncells + 1));
+  for (i = 0, k = 0, total = 0; i < top->ncells; i++){
+    offset[i] = total;
+    if (k < b.njobs && b.jobs[k] == i){
+      total += sub[k++]->ncells;
+    } else {
+      total++;
+    }
+  }
+  offset[top->ncells] = total;
+  FlatQuadTree_set_size(qt, total);
+  qt->ncells = total;
+  for (i = 0, k = 0; i < top->ncells; i++){
+    FlatQuadTree src = top;
+    int from = i, len = 1, to = offset[i], j;
+
+    if (k < b.njobs && b.jobs[k] == i){
+      src = sub[k++];
+      from = 0;
+      len = src->ncells;
+    }
+    memcpy(&(qt->center[to*dim]), &(src->center[from*dim]), sizeof(real)*dim*len);
+    memcpy(&(qt->average[to*dim]), &(src->average[from*dim]), sizeof(real)*dim*len);
+    memcpy(&(qt->width[to]), &(src->width[from]), sizeof(real)*len);
+    memcpy(&(qt->total_weight[to]), &(src->total_weight[from]), sizeof(real)*len);
+    memcpy(&(qt->npoints[to]), &(src->npoints[from]), sizeof(int)*len);
+    memcpy(&(qt->start[to]), &(src->start[from]), sizeof(int)*len);
+    memcpy(&(qt->quadrant[to]), &(src->quadrant[from]), sizeof(int)*len);
+    if (src == top){
+      qt->next[to] = offset[top->next[i]];
+    } else {
+      for (j = 0; j < len; j++) qt->next[to+j] = src->next[j] + to;
+    }
+  }
+  FREE(offset);
+  for (i = 0; i < b.njobs; i++) FlatQuadTree_delete(sub[i]);
+  FREE(sub);
+  flat_build_free(&b);
+  FlatQuadTree_delete(top);
+
+  /* the points, in Morton order */
+  qt->coord = MALLOC(sizeof(real)*dim*MAX(n, 1));
+  qt->weight = MALLOC(sizeof(real)*MAX(n, 1));
+  qt->id = idx;
+#ifdef _OPENMP
+#pragma omp parallel for private(k) if (n >= QT_PARALLEL_MIN)
+#endif
+  for (i = 0; i < n; i++){
+    for (k = 0; k < dim; k++) qt->coord[i*dim+k] = coord[idx[i]*dim+k];
+    qt->weight[i] = weight ? weight[idx[i]] : 1;
+  }
+  FREE(tmp);
+  return qt;
+}
+
+static void check_or_realloc_arrays(int dim, int *nsuper, int *nsupermax, real **center, real **supernode_wgts, real **distances){
+
+  if (*nsuper >= *nsupermax) {
+    *nsupermax = *nsuper + MAX(10, (int) 0.2*(*nsuper));
+    *center = REALLOC(*center, sizeof(real)*(*nsupermax)*dim);
+    *supernode_wgts = REALLOC(*supernode_wgts, sizeof(real)*(*nsupermax));
+    *distances = REALLOC(*distances, sizeof(real)*(*nsupermax));
+  }
+}
+
+void FlatQuadTree_get_supernodes(FlatQuadTree qt, real bh, real *point, int nodeid, int *nsuper,
+				 int *nsupermax, real **center, real **supernode_wgts, real **distances, real *counts, int *flag){
+  /* same as QuadTree_get_supernodes. The depth first walk needs no stack: a cell that is
+     far enough away, or a leaf, is followed by the cell after its subtree */
+  int dim = qt->dim, nq = 1<<dim, c, i, j;
+  real dist;
+
+  *counts = 1;
+  *nsuper = 0;
+  *flag = 0;
+  *nsupermax = 10;
+  if (!*center) *center = MALLOC(sizeof(real)*(*nsupermax)*dim);
+  if (!*supernode_wgts) *supernode_wgts = MALLOC(sizeof(real)*(*nsupermax));
+  if (!*distances) *distances = MALLOC(sizeof(real)*(*nsupermax));
+
+  c = 0;
+  while (c < qt->ncells){
+    if (qt->next[c] == c + 1){
+      for (j = qt->start[c]; j < qt->start[c] + qt->npoints[c]; j++){
+	check_or_realloc_arrays(dim, nsuper, nsupermax, center, supernode_wgts, distances);
+	if (qt->id[j] == nodeid) continue;
+	for (i = 0; i < dim; i++) (*center)[dim*(*nsuper)+i] = qt->coord[j*dim+i];
+	(*supernode_wgts)[*nsuper] = qt->weight[j];
+	(*distances)[*nsuper] = point_distance(point, &(qt->coord[j*dim]), dim);
+	(*nsuper)++;
+      }
+      c++;
+      continue;
+    }
+    dist = point_distance(&(qt->center[c*dim]), point, dim);
+    if (qt->width[c] < bh*dist){
+      check_or_realloc_arrays(dim, nsuper, nsupermax, center, supernode_wgts, distances);
+      for (i = 0; i < dim; i++) (*center)[dim*(*nsuper)+i] = qt->average[c*dim+i];
+      (*supernode_wgts)[*nsuper] = qt->total_weight[c];
+      (*distances)[*nsuper] = point_distance(&(qt->average[c*dim]), point, dim);
+      (*nsuper)++;
+      c = qt->next[c];
+    } else {
+      (*counts) += nq;/* QuadTree counts a visit to each quadrant, empty or not */
+      c++;
+    }
+  }
+}
+
+#define IS_LEAF(qt, c) ((qt)->next[c] == (c) + 1)
+
+static void FlatQuadTree_repulsive_force_interact(FlatQuadTree qt, int c1, int c2, real *x, real *force, real bh, real p, real KP, real *counts){
+  /* same as QuadTree_repulsive_force_interact, on cells c1 and c2 */
+  int dim = qt->dim, k, j1, j2, i1, i2, d, d1, d2;
+  real *x1, *x2, dist, wgt1, wgt2, f, *f1, *f2, w1, w2;
+
+  dist = point_distance(&(qt->average[c1*dim]), &(qt->average[c2*dim]), dim);
+  if (qt->width[c1] + qt->width[c2] < bh*dist){
+    counts[0]++;
+    x1 = &(qt->average[c1*dim]);
+    w1 = qt->total_weight[c1];
+    f1 = &(qt->force[c1*dim]);
+    x2 = &(qt->average[c2*dim]);
+    w2 = qt->total_weight[c2];
+    f2 = &(qt->force[c2*dim]);
+    assert(dist > 0);
+    for (k = 0; k < dim; k++){
+      if (p == -1){
+	f = w1*w2*KP*(x1[k] - x2[k])/(dist*dist);
+      } else {
+	f = w1*w2*KP*(x1[k] - x2[k])/pow(dist, 1.- p);
+      }
+      f1[k] += f;
+      f2[k] -= f;
+    }
+    return;
+  }
+
+  if (IS_LEAF(qt, c1) && IS_LEAF(qt, c2)){
+    for (j1 = qt->start[c1]; j1 < qt->start[c1] + qt->npoints[c1]; j1++){
+      x1 = &(qt->coord[j1*dim]);
+      wgt1 = qt->weight[j1];
+      i1 = qt->id[j1];
+      f1 = &(force[i1*dim]);
+      for (j2 = qt->start[c2]; j2 < qt->start[c2] + qt->npoints[c2]; j2++){
+	x2 = &(qt->coord[j2*dim]);
+	wgt2 = qt->weight[j2];
+	i2 = qt->id[j2];
+	f2 = &(force[i2*dim]);
+	if ((c1 == c2 && i2 < i1) || i1 == i2) continue;
+	counts[1]++;
+	dist = distance_cropped(x, dim, i1, i2);
+	for (k = 0; k < dim; k++){
+	  if (p == -1){
+	    f = wgt1*wgt2*KP*(x1[k] - x2[k])/(dist*dist);
+	  } else {
+	    f = wgt1*wgt2*KP*(x1[k] - x2[k])/pow(dist, 1.- p);
+	  }
+	  f1[k] += f;
+	  f2[k] -= f;
+	}
+      }
+    }
+    return;
+  }
+
+  if (c1 == c2){
+    for (d1 = c1 + 1; d1 < qt->next[c1]; d1 = qt->next[d1]){
+      for (d2 = d1; d2 < qt->next[c1]; d2 = qt->next[d2]){
+	FlatQuadTree_repulsive_force_interact(qt, d1, d2, x, force, bh, p, KP, counts);
+      }
+    }
+    return;
+  }
+
+  /* split the one with bigger box, or one not at the last level */
+  if (qt->width[c1] > qt->width[c2] && !IS_LEAF(qt, c1)){
+    d = c1;
+  } else if (qt->width[c2] > qt->width[c1] && !IS_LEAF(qt, c2)){
+    d = c2;
+  } else if (!IS_LEAF(qt, c1)){
+    d = c1;
+  } else {
+    assert(!IS_LEAF(qt, c2));
+    d = c2;
+  }
+  for (d1 = d + 1; d1 < qt->next[d]; d1 = qt->next[d1]){
+    FlatQuadTree_repulsive_force_interact(qt, d1, d == c1 ? c2 : c1, x, force, bh, p, KP, counts);
+  }
+}
+
+static void FlatQuadTree_repulsive_force_accumulate(FlatQuadTree qt, int c, real *force, real *counts){
+  /* push down forces on cell c into the node level */
+  int dim = qt->dim, j, k, d;
+  real wgt = qt->total_weight[c], wgt2, *f = &(qt->force[c*dim]), *f2;
+
+  assert(wgt > 0);
+  counts[2]++;
+  if (IS_LEAF(qt, c)){
+    for (j = qt->start[c]; j < qt->start[c] + qt->npoints[c]; j++){
+      f2 = &(force[qt->id[j]*dim]);
+      wgt2 = qt->weight[j]/wgt;
+      for (k = 0; k < dim; k++) f2[k] += wgt2*f[k];
+    }
+    return;
+  }
+  for (d = c + 1; d < qt->next[c]; d = qt->next[d]){
+    f2 = &(qt->force[d*dim]);
+    wgt2 = qt->total_weight[d]/wgt;
+    for (k = 0; k < dim; k++) f2[k] += wgt2*f[k];
+    FlatQuadTree_repulsive_force_accumulate(qt, d, force, counts);
+  }
+}
+
+static void FlatQuadTree_accumulate_top(FlatQuadTree qt, int c, real *force, real *counts, int level, int maxlevel,
+					int *cells, int *ncells){
+  /* FlatQuadTree_repulsive_force_accumulate down to depth maxlevel, listing the cells there */
+  int dim = qt->dim, k, d;
+  real wgt = qt->total_weight[c], wgt2, *f = &(qt->force[c*dim]), *f2;
+
+  if (level >= maxlevel || IS_LEAF(qt, c)){
+    cells[(*ncells)++] = c;
+    return;
+  }
+  assert(wgt > 0);
+  counts[2]++;
+  for (d = c + 1; d < qt->next[c]; d = qt->next[d]){
+    f2 = &(qt->force[d*dim]);
+    wgt2 = qt->total_weight[d]/wgt;
+    for (k = 0; k < dim; k++) f2[k] += wgt2*f[k];
+    FlatQuadTree_accumulate_top(qt, d, force, counts, level + 1, maxlevel, cells, ncells);
+  }
+}
+
+typedef struct {
+  int c1, c2;
+  int phase;
+  real counts[2];
+} flat_pair_t;
+
+static void flat_pair_add(flat_pair_t **pairs, int *npairs, int *maxpairs, int c1, int c2, int phase){
+  if (*npairs >= *maxpairs){
+    *maxpairs = *npairs + MAX(64, *npairs/2);
+    *pairs = REALLOC(*pairs, sizeof(flat_pair_t)*(*maxpairs));
+  }
+  (*pairs)[*npairs].c1 = c1;
+  (*pairs)[*npairs].c2 = c2;
+  (*pairs)[*npairs].phase = phase;
+  (*npairs)++;
+}
+
+static void FlatQuadTree_self_pairs(FlatQuadTree qt, int c, int level, int maxlevel, flat_pair_t **pairs, int *npairs, int *maxpairs){
+  /* the schedule of QuadTree_self_pairs: self interactions at depth maxlevel in phase 0, then
+     the children of each cell above in round robin rounds, one phase per round */
+  int nq = 1<<(qt->dim), i, j, r, s, a, b, d, phase0, *kids;
+
+  if (level >= maxlevel || IS_LEAF(qt, c)){
+    flat_pair_add(pairs, npairs, maxpairs, c, c, 0);
+    return;
+  }
+  kids = MALLOC(sizeof(int)*nq);
+  for (i = 0; i < nq; i++) kids[i] = -1;
+  for (d = c + 1; d < qt->next[c]; d = qt->next[d]){
+    kids[qt->quadrant[d]] = d;
+    FlatQuadTree_self_pairs(qt, d, level + 1, maxlevel, pairs, npairs, maxpairs);
+  }
+
+  phase0 = 1 + (maxlevel - level - 1)*(nq - 1);
+  for (r = 0; r < nq - 1; r++){
+    for (s = 0; s < nq/2; s++){
+      if (s == 0){
+	a = r; b = nq - 1;
+      } else {
+	a = (r + s)%(nq - 1); b = (r - s + nq - 1)%(nq - 1);
+      }
+      i = MIN(a, b); j = MAX(a, b);
+      if (kids[i] >= 0 && kids[j] >= 0) flat_pair_add(pairs, npairs, maxpairs, kids[i], kids[j], phase0 + r);
+    }
+  }
+  FREE(kids);
+}
+
+void FlatQuadTree_get_repulsive_force(FlatQuadTree qt, real *force, real *x, real bh, real p, real KP, real *counts, int *flag){
+  /* same as QuadTree_get_repulsive_force, with the same phases and so the same result */
+  int n = qt->n, dim = qt->dim, i, k, maxlevel, nphases, *start, *next, *cells, ncells = 0;
+  flat_pair_t *pairs = NULL, *sorted;
+  int npairs = 0, maxpairs = 0;
+  real *ccounts;
+
+  for (i = 0; i < 4; i++) counts[i] = 0;
+  *flag = 0;
+  for (i = 0; i < dim*n; i++) force[i] = 0;
+  if (!qt->force) qt->force = MALLOC(sizeof(real)*dim*qt->ncells);
+  for (i = 0; i < dim*qt->ncells; i++) qt->force[i] = 0;
+
+  maxlevel = (n >= QT_PARALLEL_MIN) ? QT_SPLIT_LEVEL(dim) : 0;
+
+  FlatQuadTree_self_pairs(qt, 0, 0, maxlevel, &pairs, &npairs, &maxpairs);
+  nphases = 1 + maxlevel*((1<<dim) - 1);
+  start = MALLOC(sizeof(int)*(nphases + 1));
+  next = MALLOC(sizeof(int)*nphases);
+  for (i = 0; i <= nphases; i++) start[i] = 0;
+  for (i = 0; i < npairs; i++) start[pairs[i].phase + 1]++;
+  for (i = 0; i < nphases; i++) start[i+1] += start[i];
+  for (i = 0; i < nphases; i++) next[i] = start[i];
+  sorted = MALLOC(sizeof(flat_pair_t)*MAX(npairs, 1));
+  for (i = 0; i < npairs; i++) sorted[next[pairs[i].phase]++] = pairs[i];
+  FREE(next);
+  FREE(pairs);
+  pairs = sorted;
+
+  for (k = 0; k < nphases; k++){
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (maxlevel > 0)
+#endif
+    for (i = start[k]; i < start[k+1]; i++){
+      pairs[i].counts[0] = pairs[i].counts[1] = 0;
+      FlatQuadTree_repulsive_force_interact(qt, pairs[i].c1, pairs[i].c2, x, force, bh, p, KP, pairs[i].counts);
+    }
+  }
+  for (i = 0; i < npairs; i++){
+    counts[0] += pairs[i].counts[0];
+    counts[1] += pairs[i].counts[1];
+  }
+
+  cells = MALLOC(sizeof(int)*qt->ncells);
+  FlatQuadTree_accumulate_top(qt, 0, force, counts, 0, maxlevel, cells, &ncells);
+  ccounts = MALLOC(sizeof(real)*3*MAX(ncells, 1));
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (maxlevel > 0)
+#endif
+  for (i = 0; i < ncells; i++){
+    ccounts[3*i+2] = 0;
+    FlatQuadTree_repulsive_force_accumulate(qt, cells[i], force, &(ccounts[3*i]));
+  }
+  for (i = 0; i < ncells; i++) counts[2] += ccounts[3*i+2];
+
+  FREE(ccounts);
+  FREE(cells);
+  FREE(start);
+  FREE(pairs);
+  for (i = 0; i < 4; i++) counts[i] /= n;
+}
@@ -0,0 +1,53 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+#ifndef FLAT_QUAD_TREE_H
+#define FLAT_QUAD_TREE_H
+
+#include <sparse/general.h>
+
+typedef struct FlatQuadTree_struct *FlatQuadTree;
+
+struct FlatQuadTree_struct {
+  /* the quadtree QuadTree_new_from_point_list would build, stored in arrays instead of
+     linked cells. Points are sorted in Morton (Z-)order, so the points of each cell are
+     contiguous. Cells are kept in depth first order, children in quadrant order, so the
+     subtree of cell i is cells i..next[i]-1, and a cell is a leaf iff next[i] == i + 1.
+     Queries visit cells and points in the same order as their QuadTree counterparts and
+     give the same results. */
+  int dim;
+  int max_level;
+  int n;/* number of points */
+  int ncells;
+  int maxcells;/* allocated length of the cell arrays */
+  real *center;/* center of the bounding box of cell i is center[i*dim..i*dim+dim-1] */
+  real *width;/* center +/- width gives the lower/upper bound of a cell */
+  real *average;/* average coordinates of the points of a cell, dim per cell */
+  real *total_weight;
+  int *npoints;/* number of points in a cell */
+  int *start;/* the points of cell i are start[i]..start[i]+npoints[i]-1 */
+  int *next;/* first cell after the subtree of a cell */
+  int *quadrant;/* which quadrant of its parent a cell is */
+  real *coord;/* point coordinates in Morton order, dim per point */
+  real *weight;/* point weights in Morton order */
+  int *id;/* index of each point in the list the tree was built from */
+  real *force;/* work space for cell forces, dim per cell */
+};
+
+FlatQuadTree FlatQuadTree_new_from_point_list(int dim, int n, int max_level, real *coord, real *weight);
+
+void FlatQuadTree_delete(FlatQuadTree qt);
+
+void FlatQuadTree_get_supernodes(FlatQuadTree qt, real bh, real *point, int nodeid, int *nsuper,
+				 int *nsupermax, real **center, real **supernode_wgts, real **distances, real *counts, int *flag);
+
+void FlatQuadTree_get_repulsive_force(FlatQuadTree qt, real *force, real *x, real bh, real p, real KP, real *counts, int *flag);
+
+#endif
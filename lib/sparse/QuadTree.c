@@ -272,6 +272,55 @@ static void QuadTree_repulsive_force_interact(QuadTree qt1, QuadTree qt2, real *
   }
 }
 
+typedef struct {
+  QuadTree qt1, qt2;
+  int phase;
+  real counts[2];
+} qt_pair_t;
+
+static void qt_pair_add(qt_pair_t **pairs, int *npairs, int *maxpairs, QuadTree qt1, QuadTree qt2, int phase){
+  if (*npairs >= *maxpairs){
+    *maxpairs = *npairs + MAX(64, *npairs/2);
+    *pairs = REALLOC(*pairs, sizeof(qt_pair_t)*(*maxpairs));
+  }
+  (*pairs)[*npairs].qt1 = qt1;
+  (*pairs)[*npairs].qt2 = qt2;
+  (*pairs)[*npairs].phase = phase;
+  (*pairs)[*npairs].counts[0] = (*pairs)[*npairs].counts[1] = 0;
+  (*npairs)++;
+}
+
+static void QuadTree_self_pairs(QuadTree qt, int level, int maxlevel, qt_pair_t **pairs, int *npairs, int *maxpairs){
+  /* list the interactions of qt with itself, down to depth maxlevel, as pairs of cells.
+     Self interactions of the cells at the bottom go into phase 0. The 2^dim children of a
+     cell interact with each other in 2^dim-1 rounds of a round robin tournament, so the
+     pairs of one round are disjoint, and all rounds come after the phases used inside the
+     children. Pairs sharing a phase touch disjoint subtrees.
+   */
+  int i, j, r, s, a, b, nq, phase0;
+
+  if (!qt) return;
+  if (level >= maxlevel || qt->l){
+    qt_pair_add(pairs, npairs, maxpairs, qt, qt, 0);
+    return;
+  }
+  nq = 1<<(qt->dim);
+  for (i = 0; i < nq; i++) QuadTree_self_pairs(qt->qts[i], level + 1, maxlevel, pairs, npairs, maxpairs);
+
+  phase0 = 1 + (maxlevel - level - 1)*(nq - 1);
+  for (r = 0; r < nq - 1; r++){
+    for (s = 0; s < nq/2; s++){
+      if (s == 0){
+	a = r; b = nq - 1;
+      } else {
+	a = (r + s)%(nq - 1); b = (r - s + nq - 1)%(nq - 1);
+      }
+      i = MIN(a, b); j = MAX(a, b);
+      if (qt->qts[i] && qt->qts[j]) qt_pair_add(pairs, npairs, maxpairs, qt->qts[i], qt->qts[j], phase0 + r);
+    }
+  }
+}
+
 static void QuadTree_repulsive_force_accumulate(QuadTree qt, real *force, real *counts){
   /* push down forces on cells into the node level */
   real wgt, wgt2;
@@ -311,6 +360,42 @@ static void QuadTree_repulsive_force_accumulate(QuadTree qt, real *force, real *
 
 }
 
+static void QuadTree_repulsive_force_accumulate_top(QuadTree qt, real *force, real *counts, int level, int maxlevel,
+						    QuadTree **cells, int *ncells, int *maxcells){
+  /* same as QuadTree_repulsive_force_accumulate, but stops at depth maxlevel and
+     lists the cells there, to be pushed down later */
+  real wgt, wgt2;
+  real *f, *f2;
+  int i, k, dim;
+  QuadTree qt2;
+
+  if (level >= maxlevel || qt->l){
+    if (*ncells >= *maxcells){
+      *maxcells = *ncells + MAX(64, *ncells/2);
+      *cells = REALLOC(*cells, sizeof(QuadTree)*(*maxcells));
+    }
+    (*cells)[(*ncells)++] = qt;
+    return;
+  }
+
+  dim = qt->dim;
+  wgt = qt->total_weight;
+  f = get_or_alloc_force_qt(qt, dim);
+  assert(wgt > 0);
+  counts[2]++;
+
+  for (i = 0; i < 1<<dim; i++){
+    qt2 = qt->qts[i];
+    if (!qt2) continue;
+    assert(qt2->n > 0);
+    f2 = get_or_alloc_force_qt(qt2, dim);
+    wgt2 = qt2->total_weight;
+    wgt2 = wgt2/wgt;
+    for (k = 0; k < dim; k++) f2[k] += wgt2*f[k];
+    QuadTree_repulsive_force_accumulate_top(qt2, force, counts, level + 1, maxlevel, cells, ncells, maxcells);
+  }
+}
+
 void QuadTree_get_repulsive_force(QuadTree qt, real *force, real *x, real bh, real p, real KP, real *counts, int *flag){
   /* get repulsice force by a more efficient algortihm: we consider two cells, if they are well separated, we
      calculate the overall repulsive force on the cell level, if not well separated, we divide one of the cell.
@@ -328,7 +413,12 @@ void QuadTree_get_repulsive_force(QuadTree qt, real *force, real *x, real bh, re
      .  counts[2]: number of total cells in the quadtree
      . Al normalized by dividing by number of nodes
   */
-  int n = qt->n, dim = qt->dim, i;
+  int n = qt->n, dim = qt->dim, i, k, maxlevel;
+  qt_pair_t *pairs = NULL;
+  int npairs = 0, maxpairs = 0, nphases, *start;
+  QuadTree *cells = NULL;
+  int ncells = 0, maxcells = 0;
+  real *ccounts;
 
   for (i = 0; i < 4; i++) counts[i] = 0;
 
@@ -336,11 +426,60 @@ void QuadTree_get_repulsive_force(QuadTree qt, real *force, real *x, real bh, re
 
   for (i = 0; i < dim*n; i++) force[i] = 0;
 
-  QuadTree_repulsive_force_interact(qt, qt, x, force, bh, p, KP, counts);
-  QuadTree_repulsive_force_accumulate(qt, force, counts);
+  maxlevel = (n >= QT_PARALLEL_MIN) ? QT_SPLIT_LEVEL(dim) : 0;
+
+  /* interactions, one phase at a time, sorted into phases by counting */
+  QuadTree_self_pairs(qt, 0, maxlevel, &pairs, &npairs, &maxpairs);
+  nphases = 1 + maxlevel*((1<<dim) - 1);
+  start = MALLOC(sizeof(int)*(nphases + 1));
+  for (i = 0; i <= nphases; i++) start[i] = 0;
+  for (i = 0; i < npairs; i++) start[pairs[i].phase + 1]++;
+  for (i = 0; i < nphases; i++) start[i+1] += start[i];
+  {
+    qt_pair_t *sorted = MALLOC(sizeof(qt_pair_t)*MAX(npairs, 1));
+    int *next = MALLOC(sizeof(int)*nphases);
+    for (i = 0; i < nphases; i++) next[i] = start[i];
+    for (i = 0; i < npairs; i++) sorted[next[pairs[i].phase]++] = pairs[i];
+    FREE(next);
+    FREE(pairs);
+    pairs = sorted;
+  }
+  for (k = 0; k < nphases; k++){
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (maxlevel > 0)
+#endif
+    for (i = start[k]; i < start[k+1]; i++){
+      QuadTree_repulsive_force_interact(pairs[i].qt1, pairs[i].qt2, x, force, bh, p, KP, pairs[i].counts);
+    }
+  }
+  for (i = 0; i < npairs; i++){
+    counts[0] += pairs[i].counts[0];
+    counts[1] += pairs[i].counts[1];
+  }
+
+  /* push cell forces down: the top levels here, the subtrees below in parallel */
+  QuadTree_repulsive_force_accumulate_top(qt, force, counts, 0, maxlevel, &cells, &ncells, &maxcells);
+  ccounts = MALLOC(sizeof(real)*3*MAX(ncells, 1));
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (maxlevel > 0)
+#endif
+  for (i = 0; i < ncells; i++){
+    ccounts[3*i+2] = 0;
+    QuadTree_repulsive_force_accumulate(cells[i], force, &(ccounts[3*i]));
+  }
+  for (i = 0; i < ncells; i++) counts[2] += ccounts[3*i+2];
+
+  FREE(ccounts);
+  FREE(cells);
+  FREE(start);
+  FREE(pairs);
   for (i = 0; i < 4; i++) counts[i] /= n;
 
 }
+#ifdef _OPENMP
+static void QuadTree_add_points(QuadTree q, int n, real *coord, real *weight);
+#endif
+
 QuadTree QuadTree_new_from_point_list(int dim, int n, int max_level, real *coord, real *weight){
   /* form a new QuadTree data structure from a list of coordinates of n points
      coord: of length n*dim, point i sits at [i*dim, i*dim+dim - 1]
@@ -379,6 +518,11 @@ QuadTree QuadTree_new_from_point_list(int dim, int n, int max_level, real *coord
   width *= 0.52;
   qt = QuadTree_new(dim, center, width, max_level);
 
+#ifdef _OPENMP
+  if (n >= QT_PARALLEL_MIN){
+    QuadTree_add_points(qt, n, coord, weight);
+  } else
+#endif
   if (weight){
     for (i = 0; i < n; i++){
       qt = QuadTree_add(qt, &(coord[i*dim]), weight[i], i);
@@ -554,6 +698,101 @@ QuadTree QuadTree_add(QuadTree q, real *coord, real weight, int id){
   
 }
 
+#ifdef _OPENMP
+typedef struct {
+  QuadTree q;
+  int *idx;/* points to add to q, in this order */
+  int n;
+  int level;
+} qt_fill_t;
+
+static void QuadTree_split_points(QuadTree q, int *idx, int *tmp, int n, real *coord, real *weight, int level, int maxlevel,
+				  qt_fill_t **fills, int *nfills, int *maxfills){
+  /* make the top levels of the tree that adding points idx[0..n-1] to the empty cell q one
+     at a time would make, and list the cells at depth maxlevel with the points that end up
+     in them. When the second point opens a cell, it goes into a child before the first one
+     does; apart from that, a child receives its points in the order of idx.
+   */
+  int dim = q->dim, nq = 1<<dim, i, j, k, ii, *count;
+  real w, *x;
+
+  if (n == 0) return;
+  if (level >= maxlevel || level >= q->max_level || n == 1){
+    if (*nfills >= *maxfills){
+      *maxfills = *nfills + MAX(64, *nfills/2);
+      *fills = REALLOC(*fills, sizeof(qt_fill_t)*(*maxfills));
+    }
+    (*fills)[*nfills].q = q;
+    (*fills)[*nfills].idx = idx;
+    (*fills)[*nfills].n = n;
+    (*fills)[*nfills].level = level;
+    (*nfills)++;
+    return;
+  }
+
+  q->average = MALLOC(sizeof(real)*dim);
+  for (j = 0; j < n; j++){
+    w = weight ? weight[idx[j]] : 1;
+    x = &(coord[idx[j]*dim]);
+    if (j == 0){
+      q->total_weight = w;
+      for (i = 0; i < dim; i++) q->average[i] = x[i];
+    } else {
+      q->total_weight += w;
+      for (i = 0; i < dim; i++) q->average[i] = ((q->average[i])*j + x[i])/(j + 1);
+    }
+  }
+  q->n = n;
+  q->qts = MALLOC(sizeof(QuadTree)*nq);
+  for (i = 0; i < nq; i++) q->qts[i] = NULL;
+
+  /* stable bucket sort by quadrant, with the first two points swapped */
+  k = idx[0]; idx[0] = idx[1]; idx[1] = k;
+  count = MALLOC(sizeof(int)*(nq + 1));
+  for (i = 0; i <= nq; i++) count[i] = 0;
+  for (j = 0; j < n; j++) count[QuadTree_get_quadrant(dim, q->center, &(coord[idx[j]*dim])) + 1]++;
+  for (i = 0; i < nq; i++) count[i+1] += count[i];
+  for (j = 0; j < n; j++){
+    ii = QuadTree_get_quadrant(dim, q->center, &(coord[idx[j]*dim]));
+    tmp[count[ii]++] = idx[j];
+  }
+  for (j = 0; j < n; j++) idx[j] = tmp[j];
+
+  /* count[i] is now the end of bucket i */
+  for (i = 0, j = 0; i < nq; j = count[i], i++){
+    if (count[i] == j) continue;
+    q->qts[i] = QuadTree_new_in_quadrant(dim, q->center, (q->width)/2, q->max_level, i);
+    QuadTree_split_points(q->qts[i], &(idx[j]), &(tmp[j]), count[i] - j, coord, weight, level + 1, maxlevel,
+			  fills, nfills, maxfills);
+  }
+  FREE(count);
+}
+
+static void QuadTree_add_points(QuadTree q, int n, real *coord, real *weight){
+  /* add points 0..n-1 to the empty tree q, filling the subtrees below QT_SPLIT_LEVEL in
+     parallel. The result is the same tree QuadTree_add makes point by point. */
+  int *idx, *tmp, i, j, nfills = 0, maxfills = 0;
+  qt_fill_t *fills = NULL;
+
+  idx = MALLOC(sizeof(int)*n);
+  tmp = MALLOC(sizeof(int)*n);
+  for (i = 0; i < n; i++) idx[i] = i;
+  QuadTree_split_points(q, idx, tmp, n, coord, weight, 0, QT_SPLIT_LEVEL(q->dim), &fills, &nfills, &maxfills);
+
+#pragma omp parallel for private(j) schedule(dynamic)
+  for (i = 0; i < nfills; i++){
+    for (j = 0; j < fills[i].n; j++){
+      QuadTree_add_internal(fills[i].q, &(coord[fills[i].idx[j]*q->dim]), weight ? weight[fills[i].idx[j]] : 1,
+			    fills[i].idx[j], fills[i].level);
+    }
+  }
+
+  FREE(fills);
+  FREE(tmp);
+  FREE(idx);
+}
+#endif
+
 static void draw_polygon(FILE *fp, int dim, real *center, real width){
   /* pliot the enclosing square */
   if (dim < 2 || dim > 3) return;
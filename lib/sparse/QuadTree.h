@@ -16,6 +16,15 @@
 
 typedef struct QuadTree_struct *QuadTree;
 
+/* Trees of at least QT_PARALLEL_MIN points are processed in parallel from
+   QT_SPLIT_LEVEL(dim) levels below the root down: cells at that depth, and the
+   pairs of cells the interaction sweep produces above it, own disjoint subtrees
+   and can be handled by different threads. The split depth depends on dim only,
+   never on the number of threads, so the order in which forces are summed is
+   fixed. FlatQuadTree uses the same split, and so the same order. */
+#define QT_SPLIT_LEVEL(dim) ((dim) >= 3 ? 3 : 4)
+#define QT_PARALLEL_MIN 5000
+
 struct QuadTree_struct {
   /* a data structure containing coordinates of n items, their average is in "average".
      The current level is a square or cube of width "width", which is subdivided into 
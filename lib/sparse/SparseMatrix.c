@@ -8,7 +8,9 @@
  * Contributors: Details at https://graphviz.org
  *************************************************************************/
 
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <assert.h>
@@ -21,6 +23,9 @@
 #include <sparse/LinkedList.h>
 #include <sparse/PriorityQueue.h>
 #endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 static size_t size_of_matrix_type(int type){
   int size = 0;
@@ -48,6 +53,154 @@ static size_t size_of_matrix_type(int type){
   return size;
 }
 
+/* threads of the parallel kernels: > 0 if set, 0 for the default,
+   -1 until GV_THREADS has been read */
+static int Nthreads = -1;
+
+void SparseMatrix_set_threads(int nthreads){
+  Nthreads = MAX(nthreads, 0);
+}
+
+int SparseMatrix_get_threads(void){
+#ifdef _OPENMP
+  if (Nthreads < 0) {
+    char *s = getenv("GV_THREADS");
+    Nthreads = s ? MAX(atoi(s), 0) : 0;
+  }
+  return Nthreads > 0 ? Nthreads : omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+#ifdef _OPENMP
+/* kernels run in parallel on matrices with at least this many rows, for
+   products, or entries, for the others */
+#define PARALLEL_MIN_ROWS 4096
+#define PARALLEL_MIN_NZ 65536
+
+/* kernel_threads:
+ * Threads for a kernel of the given size, 1 if it is too small to gain
+ * from more or if called from a parallel region.
+ */
+static int kernel_threads(int size, int min){
+  if (size < min || omp_in_parallel()) return 1;
+  return SparseMatrix_get_threads();
+}
+
+/* new_by_row_counts:
+ * A new m x n CSR matrix with count[i+1] entries in row i, with ia set.
+ * Frees count. Returns NULL if the entries overflow an int.
+ */
+static SparseMatrix new_by_row_counts(int m, int n, int *count, int type){
+  SparseMatrix A;
+  size_t nz;
+  int i;
+
+  count[0] = 0;
+  for (i = 0, nz = 0; i < m; i++){
+    nz += (size_t) count[i+1];
+    if (nz > INT_MAX) {
+#ifdef DEBUG_PRINT
+      fprintf(stderr,"overflow in SparseMatrix_multiply !!!\n");
+#endif
+      FREE(count);
+      return NULL;
+    }
+    count[i+1] = (int) nz;
+  }
+  A = SparseMatrix_new(m, n, (int) nz, type, FORMAT_CSR);
+  if (A) {
+    memcpy(A->ia, count, sizeof(int)*((size_t) m + 1));
+    A->nz = (int) nz;
+  }
+  FREE(count);
+  return A;
+}
+
+/* bucket_parallel:
+ * Stable counting sort of the entries 0..nz-1 by key[k], in 0..nkeys-1,
+ * each thread counting and placing one contiguous block of entries.
+ * Sets ptr[0..nkeys] to the starts of the buckets and returns dest,
+ * dest[k] being the position of entry k in the sorted order. Entries
+ * of a bucket stay in the order of k, as with a serial counting sort.
+ */
+static int *bucket_parallel(int nz, int *key, int nkeys, int *ptr, int nt){
+  int *dest = MALLOC(sizeof(int)*((size_t) MAX(nz, 1)));
+  int *count = MALLOC(sizeof(int)*((size_t) nt)*((size_t) MAX(nkeys, 1)));
+
+#pragma omp parallel num_threads(nt)
+  {
+    int nthreads = omp_get_num_threads(), t = omp_get_thread_num();
+    int lo = (int) ((long long) nz*t/nthreads), hi = (int) ((long long) nz*(t+1)/nthreads);
+    int *cnt = count + ((size_t) t)*((size_t) nkeys);
+    int b, k;
+
+    for (b = 0; b < nkeys; b++) cnt[b] = 0;
+    for (k = lo; k < hi; k++) cnt[key[k]]++;
+#pragma omp barrier
+#pragma omp single
+    {
+      int s, c, pos = 0;
+      for (b = 0; b < nkeys; b++){
+	ptr[b] = pos;
+	for (s = 0; s < nthreads; s++){
+	  c = count[((size_t) s)*((size_t) nkeys) + (size_t) b];
+	  count[((size_t) s)*((size_t) nkeys) + (size_t) b] = pos;
+	  pos += c;
+	}
+      }
+      ptr[nkeys] = pos;
+    }
+    for (k = lo; k < hi; k++) dest[k] = cnt[key[k]]++;
+  }
+  FREE(count);
+  return dest;
+}
+
+/* permute_entries:
+ * Copy the values of the nz entries of src to dst, entry k going to
+ * dest[k]. Nothing to do for pattern matrices.
+ */
+static void permute_entries(int type, int nz, int *dest, void *src, void *dst, int nt){
+  int k;
+
+  switch (type){
+  case MATRIX_TYPE_REAL:{
+    real *a = (real*) src, *b = (real*) dst;
+#pragma omp parallel for num_threads(nt) schedule(static)
+    for (k = 0; k < nz; k++) b[dest[k]] = a[k];
+    break;
+  }
+  case MATRIX_TYPE_COMPLEX:{
+    real *a = (real*) src, *b = (real*) dst;
+#pragma omp parallel for num_threads(nt) schedule(static)
+    for (k = 0; k < nz; k++){
+      b[2*dest[k]] = a[2*k];
+      b[2*dest[k]+1] = a[2*k+1];
+    }
+    break;
+  }
+  case MATRIX_TYPE_INTEGER:{
+    int *a = (int*) src, *b = (int*) dst;
+#pragma omp parallel for num_threads(nt) schedule(static)
+    for (k = 0; k < nz; k++) b[dest[k]] = a[k];
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+/* plain_type:
+ * Whether the parallel copying kernels handle matrices of this type.
+ */
+static int plain_type(int type){
+  return type == MATRIX_TYPE_REAL || type == MATRIX_TYPE_COMPLEX
+    || type == MATRIX_TYPE_INTEGER || type == MATRIX_TYPE_PATTERN;
+}
+#endif
+
 SparseMatrix SparseMatrix_sort(SparseMatrix A){
   SparseMatrix B;
   B = SparseMatrix_transpose(A);
@@ -63,6 +216,30 @@ SparseMatrix SparseMatrix_make_undirected(SparseMatrix A){
   SparseMatrix_set_undirected(B);
   return SparseMatrix_remove_upper(B);
 }
+#ifdef _OPENMP
+/* transpose_parallel:
+ * The transpose of A, bucketing its entries by column in parallel.
+ */
+static SparseMatrix transpose_parallel(SparseMatrix A, int nt){
+  int *ia = A->ia, *ja = A->ja, *jb, *dest, nz = A->nz, m = A->m, i;
+  SparseMatrix B;
+
+  B = SparseMatrix_new(A->n, m, nz, A->type, FORMAT_CSR);
+  if (!B) return NULL;
+  B->nz = nz;
+  jb = B->ja;
+  dest = bucket_parallel(nz, ja, A->n, B->ia, nt);
+#pragma omp parallel for num_threads(nt) schedule(static)
+  for (i = 0; i < m; i++){
+    int j;
+    for (j = ia[i]; j < ia[i+1]; j++) jb[dest[j]] = i;
+  }
+  permute_entries(A->type, nz, dest, A->a, B->a, nt);
+  FREE(dest);
+  return B;
+}
+#endif
+
 SparseMatrix SparseMatrix_transpose(SparseMatrix A){
   if (!A) return NULL;
 
@@ -72,6 +249,11 @@ SparseMatrix SparseMatrix_transpose(SparseMatrix A){
 
   assert(A->format == FORMAT_CSR);/* only implemented for CSR right now */
 
+#ifdef _OPENMP
+  int nt = kernel_threads(nz, PARALLEL_MIN_NZ);
+  if (nt > 1 && plain_type(type)) return transpose_parallel(A, nt);
+#endif
+
   B = SparseMatrix_new(n, m, nz, type, format);
   B->nz = nz;
   ib = B->ia;
@@ -822,6 +1004,37 @@ SparseMatrix SparseMatrix_from_coordinate_format_not_compacted(SparseMatrix A, i
 
 }
 
+#ifdef _OPENMP
+/* from_coordinate_arrays_parallel:
+ * SparseMatrix_from_coordinate_arrays_internal without summing repeated
+ * entries, bucketing the entries by row in parallel.
+ */
+static SparseMatrix from_coordinate_arrays_parallel(int nz, int m, int n, int *irn, int *jcn, void *val0, int type, size_t sz, int nt){
+  SparseMatrix A;
+  int *ja, *dest, k, bad = 0;
+
+#pragma omp parallel for num_threads(nt) schedule(static) reduction(+:bad)
+  for (k = 0; k < nz; k++){
+    if (irn[k] < 0 || irn[k] >= m || jcn[k] < 0 || jcn[k] >= n) bad++;
+  }
+  if (bad) {
+    assert(0);
+    return NULL;
+  }
+  A = SparseMatrix_general_new(m, n, nz, type, sz, FORMAT_CSR);
+  assert(A);
+  if (!A) return NULL;
+  ja = A->ja;
+  dest = bucket_parallel(nz, irn, m, A->ia, nt);
+#pragma omp parallel for num_threads(nt) schedule(static)
+  for (k = 0; k < nz; k++) ja[dest[k]] = jcn[k];
+  permute_entries(type, nz, dest, val0, A->a, nt);
+  FREE(dest);
+  A->nz = nz;
+  return A;
+}
+#endif
+
 static SparseMatrix SparseMatrix_from_coordinate_arrays_internal(int nz, int m, int n, int *irn, int *jcn, void *val0, int type, size_t sz, int sum_repeated){
   /* convert a sparse matrix in coordinate form to one in compressed row form.
      nz: number of entries
@@ -840,6 +1053,14 @@ static SparseMatrix SparseMatrix_from_coordinate_arrays_internal(int nz, int m,
   assert(m > 0 && n > 0 && nz >= 0);
 
   if (m <=0 || n <= 0 || nz < 0) return NULL;
+#ifdef _OPENMP
+  int nt = kernel_threads(nz, PARALLEL_MIN_NZ);
+  if (nt > 1 && plain_type(type)) {
+    A = from_coordinate_arrays_parallel(nz, m, n, irn, jcn, val0, type, sz, nt);
+    if (A && sum_repeated) A = SparseMatrix_sum_repeat_entries(A, sum_repeated);
+    return A;
+  }
+#endif
   A = SparseMatrix_general_new(m, n, nz, type, sz, FORMAT_CSR);
   assert(A);
   if (!A) return NULL;
@@ -960,6 +1181,77 @@ SparseMatrix SparseMatrix_from_coordinate_arrays_not_compacted(int nz, int m, in
   return SparseMatrix_from_coordinate_arrays_internal(nz, m, n, irn, jcn, val0, type, sz, what_to_sum);
 }
 
+#ifdef _OPENMP
+/* add_parallel:
+ * A + B for real or pattern matrices, by rows in parallel. A first pass
+ * counts the entries of each row, a second fills each row with them in
+ * the order of the serial code.
+ */
+static SparseMatrix add_parallel(SparseMatrix A, SparseMatrix B, int nt){
+  int m = A->m, n = A->n;
+  int *ia = A->ia, *ja = A->ja, *ib = B->ia, *jb = B->ja, *ic, *count;
+  real *a = (real*) A->a, *b = (real*) B->a;
+  SparseMatrix C;
+
+  count = MALLOC(sizeof(int)*((size_t) m + 1));
+#pragma omp parallel num_threads(nt)
+  {
+    int *mask = MALLOC(sizeof(int)*((size_t) MAX(n, 1)));
+    int i, j;
+
+    for (j = 0; j < n; j++) mask[j] = -1;
+#pragma omp for schedule(static)
+    for (i = 0; i < m; i++){
+      int cnt = ia[i+1] - ia[i];
+      for (j = ia[i]; j < ia[i+1]; j++) mask[ja[j]] = i;
+      for (j = ib[i]; j < ib[i+1]; j++){
+	if (mask[jb[j]] != i) cnt++;
+      }
+      count[i+1] = cnt;
+    }
+    FREE(mask);
+  }
+
+  C = new_by_row_counts(m, n, count, A->type);
+  if (!C) return NULL;
+  ic = C->ia;
+
+#pragma omp parallel num_threads(nt)
+  {
+    int *mask = MALLOC(sizeof(int)*((size_t) MAX(n, 1)));
+    int *pos = MALLOC(sizeof(int)*((size_t) MAX(n, 1)));
+    int *jc = C->ja;
+    real *c = (real*) C->a;
+    int i, j, nz;
+
+    for (j = 0; j < n; j++) mask[j] = -1;
+#pragma omp for schedule(static)
+    for (i = 0; i < m; i++){
+      nz = ic[i];
+      for (j = ia[i]; j < ia[i+1]; j++){
+	mask[ja[j]] = i;
+	pos[ja[j]] = nz;
+	jc[nz] = ja[j];
+	if (c) c[nz] = a[j];
+	nz++;
+      }
+      for (j = ib[i]; j < ib[i+1]; j++){
+	if (mask[jb[j]] != i){
+	  jc[nz] = jb[j];
+	  if (c) c[nz] = b[j];
+	  nz++;
+	} else if (c) {
+	  c[pos[jb[j]]] += b[j];
+	}
+      }
+    }
+    FREE(mask);
+    FREE(pos);
+  }
+  return C;
+}
+#endif
+
 SparseMatrix SparseMatrix_add(SparseMatrix A, SparseMatrix B){
   int m, n;
   SparseMatrix C = NULL;
@@ -974,6 +1266,13 @@ SparseMatrix SparseMatrix_add(SparseMatrix A, SparseMatrix B){
   n = A->n;
   if (m != B->m || n != B->n) return NULL;
 
+#ifdef _OPENMP
+  if (A->type == MATRIX_TYPE_REAL || A->type == MATRIX_TYPE_PATTERN) {
+    int nt = kernel_threads(A->nz + B->nz, PARALLEL_MIN_NZ);
+    if (nt > 1) return add_parallel(A, B, nt);
+  }
+#endif
+
   nzmax = A->nz + B->nz;/* just assume that no entries overlaps for speed */
 
   C = SparseMatrix_new(m, n, nzmax, A->type, FORMAT_CSR);
@@ -1224,6 +1523,9 @@ void SparseMatrix_multiply_vector(SparseMatrix A, real *v, real **res, int trans
   m = A->m;
   n = A->n;
   u = *res;
+#ifdef _OPENMP
+  int nt = kernel_threads(A->nz, PARALLEL_MIN_NZ);
+#endif
 
   switch (A->type){
   case MATRIX_TYPE_REAL:
@@ -1231,6 +1533,9 @@ void SparseMatrix_multiply_vector(SparseMatrix A, real *v, real **res, int trans
     if (v){
       if (!transposed){
 	if (!u) u = MALLOC(sizeof(real)*((size_t)m));
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nt) if(nt > 1) schedule(static) private(j)
+#endif
 	for (i = 0; i < m; i++){
 	  u[i] = 0.;
 	  for (j = ia[i]; j < ia[i+1]; j++){
@@ -1250,6 +1555,9 @@ void SparseMatrix_multiply_vector(SparseMatrix A, real *v, real **res, int trans
       /* v is assumed to be all 1's */
       if (!transposed){
 	if (!u) u = MALLOC(sizeof(real)*((size_t)m));
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nt) if(nt > 1) schedule(static) private(j)
+#endif
 	for (i = 0; i < m; i++){
 	  u[i] = 0.;
 	  for (j = ia[i]; j < ia[i+1]; j++){
@@ -1272,6 +1580,9 @@ void SparseMatrix_multiply_vector(SparseMatrix A, real *v, real **res, int trans
     if (v){
       if (!transposed){
 	if (!u) u = MALLOC(sizeof(real)*((size_t)m));
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nt) if(nt > 1) schedule(static) private(j)
+#endif
 	for (i = 0; i < m; i++){
 	  u[i] = 0.;
 	  for (j = ia[i]; j < ia[i+1]; j++){
@@ -1291,6 +1602,9 @@ void SparseMatrix_multiply_vector(SparseMatrix A, real *v, real **res, int trans
       /* v is assumed to be all 1's */
       if (!transposed){
 	if (!u) u = MALLOC(sizeof(real)*((size_t)m));
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nt) if(nt > 1) schedule(static) private(j)
+#endif
 	for (i = 0; i < m; i++){
 	  u[i] = 0.;
 	  for (j = ia[i]; j < ia[i+1]; j++){
@@ -1395,6 +1709,77 @@ SparseMatrix SparseMatrix_multiply_by_scaler(SparseMatrix A, real s){
 }
 
 
+#ifdef _OPENMP
+/* multiply_parallel:
+ * A*B for real or pattern matrices, by rows in parallel, as
+ * multiply3_real_parallel.
+ */
+static SparseMatrix multiply_parallel(SparseMatrix A, SparseMatrix B, int nt){
+  int m = A->m, n = B->n;
+  int *ia = A->ia, *ja = A->ja, *ib = B->ia, *jb = B->ja, *ic, *count;
+  real *a = (real*) A->a, *b = (real*) B->a;
+  SparseMatrix C;
+
+  count = MALLOC(sizeof(int)*((size_t) m + 1));
+#pragma omp parallel num_threads(nt)
+  {
+    int *mask = MALLOC(sizeof(int)*((size_t) MAX(n, 1)));
+    int i, j, k;
+
+    for (k = 0; k < n; k++) mask[k] = -1;
+#pragma omp for schedule(dynamic, 256)
+    for (i = 0; i < m; i++){
+      int cnt = 0;
+      for (j = ia[i]; j < ia[i+1]; j++){
+	for (k = ib[ja[j]]; k < ib[ja[j]+1]; k++){
+	  if (mask[jb[k]] != i){
+	    mask[jb[k]] = i;
+	    cnt++;
+	  }
+	}
+      }
+      count[i+1] = cnt;
+    }
+    FREE(mask);
+  }
+
+  C = new_by_row_counts(m, n, count, A->type);
+  if (!C) return NULL;
+  ic = C->ia;
+
+#pragma omp parallel num_threads(nt)
+  {
+    int *mask = MALLOC(sizeof(int)*((size_t) MAX(n, 1)));
+    int *pos = MALLOC(sizeof(int)*((size_t) MAX(n, 1)));
+    int *jc = C->ja;
+    real *c = (real*) C->a;
+    int i, j, k, nz;
+
+    for (k = 0; k < n; k++) mask[k] = -1;
+#pragma omp for schedule(dynamic, 256)
+    for (i = 0; i < m; i++){
+      nz = ic[i];
+      for (j = ia[i]; j < ia[i+1]; j++){
+	for (k = ib[ja[j]]; k < ib[ja[j]+1]; k++){
+	  if (mask[jb[k]] != i){
+	    mask[jb[k]] = i;
+	    pos[jb[k]] = nz;
+	    jc[nz] = jb[k];
+	    if (c) c[nz] = a[j]*b[k];
+	    nz++;
+	  } else if (c) {
+	    c[pos[jb[k]]] += a[j]*b[k];
+	  }
+	}
+      }
+    }
+    FREE(mask);
+    FREE(pos);
+  }
+  return C;
+}
+#endif
+
 SparseMatrix SparseMatrix_multiply(SparseMatrix A, SparseMatrix B){
   int m;
   SparseMatrix C = NULL;
@@ -1413,6 +1798,13 @@ SparseMatrix SparseMatrix_multiply(SparseMatrix A, SparseMatrix B){
     return NULL;
   }
   type = A->type;
+
+#ifdef _OPENMP
+  if (type == MATRIX_TYPE_REAL || type == MATRIX_TYPE_PATTERN) {
+    int nt = kernel_threads(m, PARALLEL_MIN_ROWS);
+    if (nt > 1) return multiply_parallel(A, B, nt);
+  }
+#endif
   
   mask = MALLOC(sizeof(int)*((size_t)(B->n)));
   if (!mask) return NULL;
@@ -1561,6 +1953,84 @@ SparseMatrix SparseMatrix_multiply(SparseMatrix A, SparseMatrix B){
 
 
 
+#ifdef _OPENMP
+/* multiply3_real_parallel:
+ * A*B*C for real matrices, by rows in parallel. A first pass counts the
+ * entries of each row, a second fills each row from its offset in D.
+ * Each row gets its entries, and sums them, in the same order as the
+ * serial code, so the result is identical to it.
+ */
+static SparseMatrix multiply3_real_parallel(SparseMatrix A, SparseMatrix B, SparseMatrix C, int nt){
+  int m = A->m, n = C->n;
+  int *ia = A->ia, *ja = A->ja, *ib = B->ia, *jb = B->ja, *ic = C->ia, *jc = C->ja, *id;
+  real *a = (real*) A->a, *b = (real*) B->a, *c = (real*) C->a;
+  SparseMatrix D = NULL;
+  int *count;
+
+  count = MALLOC(sizeof(int)*((size_t) m + 1));
+#pragma omp parallel num_threads(nt)
+  {
+    int *mask = MALLOC(sizeof(int)*((size_t) MAX(n, 1)));
+    int j, k, l, ii;
+
+    for (k = 0; k < n; k++) mask[k] = -1;
+#pragma omp for schedule(dynamic, 256)
+    for (ii = 0; ii < m; ii++){
+      int cnt = 0;
+      for (j = ia[ii]; j < ia[ii+1]; j++){
+	for (l = ib[ja[j]]; l < ib[ja[j]+1]; l++){
+	  for (k = ic[jb[l]]; k < ic[jb[l]+1]; k++){
+	    if (mask[jc[k]] != ii){
+	      mask[jc[k]] = ii;
+	      cnt++;
+	    }
+	  }
+	}
+      }
+      count[ii+1] = cnt;
+    }
+    FREE(mask);
+  }
+
+  D = new_by_row_counts(m, n, count, MATRIX_TYPE_REAL);
+  if (!D) return NULL;
+  id = D->ia;
+
+#pragma omp parallel num_threads(nt)
+  {
+    int *mask = MALLOC(sizeof(int)*((size_t) MAX(n, 1)));
+    int *pos = MALLOC(sizeof(int)*((size_t) MAX(n, 1)));
+    int *jd = D->ja;
+    real *d = (real*) D->a;
+    int j, k, l, ii, nzi;
+
+    for (k = 0; k < n; k++) mask[k] = -1;
+#pragma omp for schedule(dynamic, 256)
+    for (ii = 0; ii < m; ii++){
+      nzi = id[ii];
+      for (j = ia[ii]; j < ia[ii+1]; j++){
+	for (l = ib[ja[j]]; l < ib[ja[j]+1]; l++){
+	  for (k = ic[jb[l]]; k < ic[jb[l]+1]; k++){
+	    if (mask[jc[k]] != ii){
+	      mask[jc[k]] = ii;
+	      pos[jc[k]] = nzi;
+	      jd[nzi] = jc[k];
+	      d[nzi] = a[j]*b[l]*c[k];
+	      nzi++;
+	    } else {
+	      d[pos[jc[k]]] += a[j]*b[l]*c[k];
+	    }
+	  }
+	}
+      }
+    }
+    FREE(mask);
+    FREE(pos);
+  }
+  return D;
+}
+#endif
+
 SparseMatrix SparseMatrix_multiply3(SparseMatrix A, SparseMatrix B, SparseMatrix C){
   int m;
   SparseMatrix D = NULL;
@@ -1581,6 +2051,13 @@ SparseMatrix SparseMatrix_multiply3(SparseMatrix A, SparseMatrix B, SparseMatrix
     return NULL;
   }
   type = A->type;
+
+#ifdef _OPENMP
+  if (type == MATRIX_TYPE_REAL) {
+    int nt = kernel_threads(m, PARALLEL_MIN_ROWS);
+    if (nt > 1) return multiply3_real_parallel(A, B, C, nt);
+  }
+#endif
   
   mask = MALLOC(sizeof(int)*((size_t)(C->n)));
   if (!mask) return NULL;
@@ -1746,6 +2223,84 @@ SparseMatrix SparseMatrix_multiply3(SparseMatrix A, SparseMatrix B, SparseMatrix
 
 }
 
+#ifdef _OPENMP
+/* sum_repeat_entries_parallel:
+ * SparseMatrix_sum_repeat_entries for real or pattern matrices, by rows
+ * in parallel. Rows are compacted into new arrays, as they cannot be
+ * moved down in place concurrently, with the entries and sums in the
+ * order of the serial code.
+ */
+static SparseMatrix sum_repeat_entries_parallel(SparseMatrix A, int nt){
+  int m = A->m, n = A->n;
+  int *ia = A->ia, *ja = A->ja, *count;
+  real *a = (real*) A->a;
+  SparseMatrix B;
+
+  count = MALLOC(sizeof(int)*((size_t) m + 1));
+#pragma omp parallel num_threads(nt)
+  {
+    int *mask = MALLOC(sizeof(int)*((size_t) MAX(n, 1)));
+    int i, j;
+
+    for (j = 0; j < n; j++) mask[j] = -1;
+#pragma omp for schedule(static)
+    for (i = 0; i < m; i++){
+      int cnt = 0;
+      for (j = ia[i]; j < ia[i+1]; j++){
+	if (mask[ja[j]] != i){
+	  mask[ja[j]] = i;
+	  cnt++;
+	}
+      }
+      count[i+1] = cnt;
+    }
+    FREE(mask);
+  }
+
+  B = new_by_row_counts(m, n, count, A->type);
+  if (!B) return NULL;
+
+#pragma omp parallel num_threads(nt)
+  {
+    int *mask = MALLOC(sizeof(int)*((size_t) MAX(n, 1)));
+    int *pos = MALLOC(sizeof(int)*((size_t) MAX(n, 1)));
+    int *jb = B->ja, *ib = B->ia;
+    real *b = (real*) B->a;
+    int i, j, nz;
+
+    for (j = 0; j < n; j++) mask[j] = -1;
+#pragma omp for schedule(static)
+    for (i = 0; i < m; i++){
+      nz = ib[i];
+      for (j = ia[i]; j < ia[i+1]; j++){
+	if (mask[ja[j]] != i){
+	  mask[ja[j]] = i;
+	  pos[ja[j]] = nz;
+	  jb[nz] = ja[j];
+	  if (b) b[nz] = a[j];
+	  nz++;
+	} else if (b) {
+	  b[pos[ja[j]]] += a[j];
+	}
+      }
+    }
+    FREE(mask);
+    FREE(pos);
+  }
+
+  FREE(A->ia);
+  FREE(A->ja);
+  FREE(A->a);
+  A->ia = B->ia;
+  A->ja = B->ja;
+  A->a = B->a;
+  A->nz = B->nz;
+  A->nzmax = B->nzmax;
+  FREE(B);
+  return A;
+}
+#endif
+
 /* For complex matrix:
    if what_to_sum = SUM_REPEATED_REAL_PART, we find entries {i,j,x + i y} and sum the x's if {i,j,Round(y)} are the same
    if what_to_sum = SUM_REPEATED_REAL_PART, we find entries {i,j,x + i y} and sum the y's if {i,j,Round(x)} are the same
@@ -1770,6 +2325,13 @@ SparseMatrix SparseMatrix_sum_repeat_entries(SparseMatrix A, int what_to_sum){
 
   if (what_to_sum == SUM_REPEATED_NONE) return A;
 
+#ifdef _OPENMP
+  if (type == MATRIX_TYPE_REAL || type == MATRIX_TYPE_PATTERN) {
+    int nt = kernel_threads(A->nz, PARALLEL_MIN_NZ);
+    if (nt > 1) return sum_repeat_entries_parallel(A, nt);
+  }
+#endif
+
   mask = MALLOC(sizeof(int)*((size_t)n));
   for (i = 0; i < n; i++) mask[i] = -1;
 
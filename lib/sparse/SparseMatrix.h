@@ -64,6 +64,12 @@ void SparseMatrix_export_binary_fp(FILE *f, SparseMatrix A);/* export binary int
 
 void SparseMatrix_delete(SparseMatrix A);
 
+/* Number of threads of the kernels run in parallel when built with OpenMP.
+   nthreads > 0 sets it; 0 restores the default, GV_THREADS from the
+   environment if it is set, else that of OpenMP. Results do not depend on it. */
+void SparseMatrix_set_threads(int nthreads);
+int SparseMatrix_get_threads(void);
+
 SparseMatrix SparseMatrix_add(SparseMatrix A, SparseMatrix B);
 SparseMatrix SparseMatrix_multiply(SparseMatrix A, SparseMatrix B);
 SparseMatrix SparseMatrix_multiply3(SparseMatrix A, SparseMatrix B, SparseMatrix C);
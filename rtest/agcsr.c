@@ -0,0 +1,123 @@
+// test that agcsr snapshots describe the graph and are rebuilt after the
+// graph changes (see test_regression.py:test_agcsr())
+
+// force assertions on
+#ifdef NDEBUG
+  #undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+int main(void) {
+
+  Agraph_t *g = agopen("g", Agdirected, NULL);
+  assert(g != NULL);
+
+  Agnode_t *a = agnode(g, "a", 1);
+  Agnode_t *b = agnode(g, "b", 1);
+  Agnode_t *c = agnode(g, "c", 1);
+  Agedge_t *ab = agedge(g, a, b, NULL, 1);
+  Agedge_t *bc = agedge(g, b, c, NULL, 1);
+  Agedge_t *ac = agedge(g, a, c, NULL, 1);
+
+  // a snapshot of a -> b, b -> c, a -> c
+  Agcsr_t *csr = agcsr(g);
+  assert(csr != NULL);
+  assert(csr->nnodes == 3);
+  assert(csr->nedges == 3);
+  assert(csr->nodes[0] == a && csr->nodes[1] == b && csr->nodes[2] == c);
+  assert(agcsrindex(csr, a) == 0);
+  assert(agcsrindex(csr, b) == 1);
+  assert(agcsrindex(csr, c) == 2);
+
+  // a's out-edges come first, in agfstout order
+  assert(csr->out_start[0] == 0 && csr->out_start[1] == 2);
+  assert(csr->out_edge[0] == ab && csr->out_node[0] == 1);
+  assert(csr->out_edge[1] == ac && csr->out_node[1] == 2);
+  assert(csr->out_start[2] == 3 && csr->out_start[3] == 3);
+  assert(csr->out_edge[2] == bc && csr->out_node[2] == 2);
+
+  // c has two in-edges and no out-edges
+  assert(csr->in_start[3] - csr->in_start[2] == 2);
+  assert(csr->in_start[1] - csr->in_start[0] == 0);
+
+  // without changes, the same snapshot is handed back
+  uint64_t stamp = csr->stamp;
+  assert(agcsr(g) == csr);
+
+  // adding a node invalidates the snapshot
+  Agnode_t *d = agnode(g, "d", 1);
+  csr = agcsr(g);
+  assert(csr->stamp != stamp);
+  assert(csr->nnodes == 4);
+  assert(csr->nedges == 3);
+  assert(agcsrindex(csr, d) == 3);
+  stamp = csr->stamp;
+
+  // so does adding an edge
+  Agedge_t *cd = agedge(g, c, d, NULL, 1);
+  csr = agcsr(g);
+  assert(csr->stamp != stamp);
+  assert(csr->nedges == 4);
+  assert(csr->out_start[3] - csr->out_start[2] == 1);
+  assert(csr->out_edge[csr->out_start[2]] == cd);
+  assert(csr->out_node[csr->out_start[2]] == 3);
+  stamp = csr->stamp;
+
+  // and deleting an edge
+  assert(agdeledge(g, ac) == 0);
+  csr = agcsr(g);
+  assert(csr->stamp != stamp);
+  assert(csr->nedges == 3);
+  assert(csr->out_start[1] - csr->out_start[0] == 1);
+  assert(csr->out_edge[0] == ab);
+
+  // a subgraph's snapshot only covers its own nodes and edges
+  Agraph_t *sg = agsubg(g, "s", 1);
+  assert(agsubnode(sg, a, 1) == a);
+  assert(agsubnode(sg, b, 1) == b);
+  Agcsr_t *scsr = agcsr(sg);
+  assert(scsr->nnodes == 2);
+  assert(scsr->nedges == 0);
+  assert(agcsrindex(scsr, a) == 0);
+  assert(agcsrindex(scsr, c) == -1);
+  stamp = scsr->stamp;
+
+  // adding an edge to the subgraph invalidates its snapshot
+  assert(agsubedge(sg, ab, 1) == ab);
+  scsr = agcsr(sg);
+  assert(scsr->stamp != stamp);
+  assert(scsr->nedges == 1);
+  assert(scsr->out_edge[0] == ab);
+
+  // deleting a node through the root invalidates both snapshots
+  stamp = scsr->stamp;
+  assert(agdelnode(g, b) == 0);
+  scsr = agcsr(sg);
+  assert(scsr->stamp != stamp);
+  assert(scsr->nnodes == 1);
+  assert(scsr->nedges == 0);
+  csr = agcsr(g);
+  assert(csr->nnodes == 3);
+  assert(csr->nedges == 1);
+  assert(agcsrindex(csr, a) == 0);
+  assert(agcsrindex(csr, c) == 1);
+  assert(agcsrindex(csr, d) == 2);
+  assert(csr->in_start[3] - csr->in_start[2] == 1);
+  assert(AGMKOUT(csr->in_edge[csr->in_start[2]]) == cd);
+  assert(csr->in_node[csr->in_start[2]] == 1);
+
+  // releasing a snapshot is allowed, and a new one can be taken after it
+  agcsrfree(sg);
+  agcsrfree(g);
+  agcsrfree(g);
+  csr = agcsr(g);
+  assert(csr->nnodes == 3);
+
+  assert(agclose(g) == 0);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+// test that a graph opened with the AgArenaDisc memory discipline can be
+// built, edited and closed (see test_regression.py:test_arena_disc())
+
+// force assertions on
+#ifdef NDEBUG
+  #undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NNODES 2000
+
+// build a graph under the given discipline, edit it, then close it
+static void exercise(Agdisc_t *disc) {
+
+  Agraph_t *g = agopen("g", Agdirected, disc);
+  assert(g != NULL);
+
+  // attributes go through the same heap as the graph objects
+  Agsym_t *color = agattr(g, AGNODE, "color", "black");
+  assert(color != NULL);
+  assert(agattr(g, AGEDGE, "weight", "1") != NULL);
+
+  // enough nodes and edges to need several arena slabs
+  Agnode_t *nodes[NNODES];
+  for (int i = 0; i < NNODES; i++) {
+    char name[32];
+    snprintf(name, sizeof(name), "n%d", i);
+    nodes[i] = agnode(g, name, 1);
+    assert(nodes[i] != NULL);
+    if (i % 3 == 0)
+      agxset(nodes[i], color, "red");
+  }
+  for (int i = 1; i < NNODES; i++) {
+    assert(agedge(g, nodes[i - 1], nodes[i], NULL, 1) != NULL);
+    assert(agedge(g, nodes[i], nodes[i / 2], NULL, 1) != NULL);
+  }
+  assert(agnnodes(g) == NNODES);
+  assert(agnedges(g) == 2 * (NNODES - 1));
+
+  // a record larger than a quarter slab takes the large-block path
+  void *big = agbindrec(g, "big", 64 * 1024, FALSE);
+  assert(big != NULL);
+
+  // subgraphs, including nested ones
+  Agraph_t *sg = agsubg(g, "cluster_a", 1);
+  assert(sg != NULL);
+  for (int i = 0; i < NNODES; i += 2)
+    assert(agsubnode(sg, nodes[i], 1) == nodes[i]);
+  Agraph_t *ssg = agsubg(sg, "inner", 1);
+  assert(ssg != NULL);
+  assert(agsubnode(ssg, nodes[0], 1) == nodes[0]);
+  assert(agsubnode(ssg, nodes[2], 1) == nodes[2]);
+  Agraph_t *other = agsubg(g, "other", 1);
+  assert(other != NULL);
+  assert(agsubnode(other, nodes[1], 1) == nodes[1]);
+  assert(agnnodes(sg) == NNODES / 2);
+
+  // edges between its nodes, kept in the subgraph's own dictionaries
+  int subedges = 0;
+  for (int i = 4; i < NNODES; i += 4) {
+    Agedge_t *e = agedge(g, nodes[i], nodes[i / 2], NULL, 0);
+    assert(e != NULL);
+    assert(agsubedge(sg, e, 1) == e);
+    subedges++;
+  }
+  assert(agnedges(sg) == subedges);
+
+  // delete some edges
+  int deleted = 0;
+  for (int i = 1; i < NNODES; i += 7) {
+    Agedge_t *e = agedge(g, nodes[i - 1], nodes[i], NULL, 0);
+    assert(e != NULL);
+    assert(agdeledge(g, e) == 0);
+    deleted++;
+  }
+  assert(agnedges(g) == 2 * (NNODES - 1) - deleted);
+  assert(agedge(g, nodes[0], nodes[1], NULL, 0) == NULL);
+
+  // delete the last node, which takes its edges with it
+  assert(agdelnode(g, nodes[NNODES - 1]) == 0);
+  assert(agnnodes(g) == NNODES - 1);
+  assert(agnode(g, "n1999", 0) == NULL);
+  assert(agnode(g, "n1998", 0) == nodes[NNODES - 2]);
+
+  // deleting a node also drops its edges from the subgraph
+  assert(agdelnode(g, nodes[4]) == 0);
+  assert(agnnodes(g) == NNODES - 2);
+  assert(agnnodes(sg) == NNODES / 2 - 1);
+  assert(agnedges(sg) == subedges - 2);
+
+  // delete a nested subgraph and a top-level one
+  assert(agdelete(sg, ssg) == 0);
+  assert(agsubg(sg, "inner", 0) == NULL);
+  assert(agdelete(g, other) == 0);
+  assert(agsubg(g, "other", 0) == NULL);
+  assert(agsubg(g, "cluster_a", 0) == sg);
+
+  // objects created after deletions are usable
+  Agnode_t *late = agnode(g, "late", 1);
+  assert(late != NULL);
+  assert(agedge(g, late, nodes[0], NULL, 1) != NULL);
+  assert(agnnodes(g) == NNODES - 1);
+  assert(strcmp(agxget(nodes[3], color), "red") == 0);
+  assert(strcmp(agxget(late, color), "black") == 0);
+
+  assert(agclose(g) == 0);
+}
+
+int main(void) {
+
+  // the default discipline, as a baseline for the same operations
+  exercise(&AgDefaultDisc);
+
+  exercise(&AgArenaDisc);
+
+  return EXIT_SUCCESS;
+}
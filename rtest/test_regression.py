@@ -796,6 +796,43 @@ def test_package_version():
     ret, _, _ = run_c(c_src)
     assert ret == 0
 
+def test_agcsr():
+    '''
+    agcsr snapshots should match the graph and be rebuilt after it changes
+    '''
+
+    # FIXME: Remove skip when
+    # https://gitlab.com/graphviz/graphviz/-/issues/1777 is fixed
+    if os.getenv('build_system') == 'msbuild':
+      pytest.skip('Windows MSBuild release does not contain any header files (#1777)')
+
+    # find co-located test source
+    c_src = (Path(__file__).parent / 'agcsr.c').resolve()
+    assert c_src.exists(), 'missing test case'
+
+    # run the test
+    ret, _, _ = run_c(c_src, link=['cgraph'])
+    assert ret == 0
+
+def test_arena_disc():
+    '''
+    a graph using the AgArenaDisc memory discipline should support creating
+    and deleting nodes, edges and subgraphs
+    '''
+
+    # FIXME: Remove skip when
+    # https://gitlab.com/graphviz/graphviz/-/issues/1777 is fixed
+    if os.getenv('build_system') == 'msbuild':
+      pytest.skip('Windows MSBuild release does not contain any header files (#1777)')
+
+    # find co-located test source
+    c_src = (Path(__file__).parent / 'arena.c').resolve()
+    assert c_src.exists(), 'missing test case'
+
+    # run the test
+    ret, _, _ = run_c(c_src, link=['cgraph'])
+    assert ret == 0
+
 def test_user_shapes():
     '''
     Graphviz should understand how to embed a custom SVG image as a node’s shape